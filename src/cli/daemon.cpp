@@ -0,0 +1,676 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <iostream>
+#include "daemon.h"
+
+#ifdef _WIN32
+
+int RunDaemon(const std::filesystem::path&, u32) {
+    std::cerr << "Error: Daemon mode needs Unix domain sockets and is not available on Windows\n";
+    return 1;
+}
+
+int RunClient(const std::filesystem::path&, const std::vector<std::string>&) {
+    std::cerr << "Error: Daemon mode needs Unix domain sockets and is not available on Windows\n";
+    return 1;
+}
+
+#else
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <cstring>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <queue>
+#include <thread>
+#include <fmt/format.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "common/logging/log.h"
+#include "common/parallel_for.h"
+#include "common/path_util.h"
+#include "core/file_format/game_library.h"
+#include "core/file_format/pfsc.h"
+#include "core/file_format/pkg.h"
+#include "progress.h"
+
+namespace {
+
+constexpr auto WatchInterval = std::chrono::milliseconds(250);
+constexpr auto AcceptInterval = 200; // Milliseconds between checks for a shutdown request.
+constexpr size_t MaxRequestSize = 8192;
+constexpr timeval ClientTimeout{.tv_sec = 10, .tv_usec = 0}; // For each send or receive.
+constexpr size_t MaxFinishedJobs = 256; // Oldest finished jobs are forgotten beyond this.
+constexpr size_t MaxConnections = 64;    // Further clients are turned away with an error.
+
+enum class JobType { Extract, List, Verify };
+enum class JobState { Queued, Running, Done, Failed, Cancelled };
+
+std::string_view ToString(JobType type) {
+    switch (type) {
+    case JobType::Extract:
+        return "extract";
+    case JobType::List:
+        return "list";
+    case JobType::Verify:
+        return "verify";
+    }
+    return "";
+}
+
+std::string_view ToString(JobState state) {
+    switch (state) {
+    case JobState::Queued:
+        return "queued";
+    case JobState::Running:
+        return "running";
+    case JobState::Done:
+        return "done";
+    case JobState::Failed:
+        return "failed";
+    case JobState::Cancelled:
+        return "cancelled";
+    }
+    return "";
+}
+
+bool IsFinished(JobState state) {
+    return state != JobState::Queued && state != JobState::Running;
+}
+
+struct Job {
+    u64 id = 0;
+    JobType type = JobType::Extract;
+    int priority = 0;
+    std::filesystem::path pkg_path;
+    std::filesystem::path out_dir;
+
+    ExtractProgress progress; // Also counts the bytes read by list and verify jobs.
+    std::atomic<u64> bytes_total{0};
+    std::atomic<u32> files_total{0};
+    std::atomic<u32> failed{0};
+    std::atomic<JobState> state{JobState::Queued};
+
+    std::mutex mutex; // Guards error and output.
+    std::string error;
+    std::vector<std::string> output; // JSON lines returned by a result request.
+
+    void AddOutput(std::string line) {
+        std::scoped_lock lock{mutex};
+        output.push_back(std::move(line));
+    }
+};
+
+std::string FormatStatus(Job& job) {
+    std::string line = fmt::format(
+        "{{\"job\":{},\"type\":\"{}\",\"state\":\"{}\",\"pkg\":\"{}\",\"priority\":{},"
+        "\"bytes_done\":{},\"bytes_total\":{},\"files_done\":{},\"files_total\":{},\"failed\":{}",
+        job.id, ToString(job.type), ToString(job.state),
+        EscapeJson(Common::FS::PathToUTF8String(job.pkg_path)), job.priority,
+        job.progress.bytes_written.load(), job.bytes_total.load(), job.progress.files_done.load(),
+        job.files_total.load(), job.failed.load());
+    {
+        std::scoped_lock lock{job.mutex};
+        if (!job.error.empty()) {
+            line += fmt::format(",\"error\":\"{}\"", EscapeJson(job.error));
+        }
+    }
+    line += "}\n";
+    return line;
+}
+
+std::string FormatError(std::string_view message) {
+    return fmt::format("{{\"error\":\"{}\"}}\n", EscapeJson(message));
+}
+
+bool OpenPkg(PKG& pkg, const std::filesystem::path& pkg_path, bool mount, std::string& error) {
+    return pkg.Open(pkg_path, error) && (!mount || pkg.Mount(pkg_path, error));
+}
+
+/// Extracts the whole PKG the way the single file mode does, below a folder named after the title.
+bool RunExtractJob(Job& job, u32 num_threads, std::string& error) {
+    PKG pkg;
+    if (!OpenPkg(pkg, job.pkg_path, false, error)) {
+        return false;
+    }
+    auto out_dir = job.out_dir;
+    if (out_dir.filename() != pkg.GetTitleID()) {
+        out_dir /= std::string(pkg.GetTitleID());
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(out_dir, ec);
+    if (ec) {
+        error = fmt::format("Failed to create {}: {}", Common::FS::PathToUTF8String(out_dir),
+                            ec.message());
+        return false;
+    }
+    if (!pkg.Extract(job.pkg_path, out_dir, error)) {
+        return false;
+    }
+
+    std::vector<int> indices(pkg.GetNumberOfFiles());
+    std::iota(indices.begin(), indices.end(), 0);
+    job.bytes_total = pkg.GetTotalSize(indices);
+    job.files_total = pkg.CountFiles(indices);
+    job.failed = pkg.ExtractFiles(indices, num_threads, &job.progress);
+    if (job.failed == 0 && !job.progress.cancel &&
+        !WriteExtractManifest(out_dir, job.progress.bytes_written, job.progress.files_done)) {
+        LOG_WARNING(Loader, "Failed to write the extraction manifest of {}",
+                    Common::FS::PathToUTF8String(out_dir));
+    }
+    job.AddOutput(fmt::format("{{\"path\":\"{}\"}}\n",
+                              EscapeJson(Common::FS::PathToUTF8String(out_dir))));
+    return true;
+}
+
+/// Lists the files and directories of the PFS image without extracting anything.
+bool RunListJob(Job& job, std::string& error) {
+    PKG pkg;
+    if (!OpenPkg(pkg, job.pkg_path, true, error)) {
+        return false;
+    }
+    const int count = static_cast<int>(pkg.GetNumberOfFiles());
+    job.files_total = count;
+    for (int i = 0; i < count && !job.progress.cancel; i++) {
+        const bool is_dir = pkg.IsDirectory(i);
+        if (!is_dir && !pkg.IsFile(i)) {
+            continue;
+        }
+        job.AddOutput(fmt::format("{{\"path\":\"{}\",\"size\":{},\"dir\":{}}}\n",
+                                  EscapeJson(pkg.GetRelativePath(i)),
+                                  is_dir ? 0 : pkg.GetFileSize(i), is_dir));
+        job.progress.files_done++;
+    }
+    return true;
+}
+
+/// Decrypts and inflates every block of every file, reporting the files that fail to decode.
+bool RunVerifyJob(Job& job, u32 num_threads, std::string& error) {
+    PKG pkg;
+    if (!OpenPkg(pkg, job.pkg_path, true, error)) {
+        return false;
+    }
+    std::vector<int> files;
+    for (int i = 0; i < static_cast<int>(pkg.GetNumberOfFiles()); i++) {
+        if (pkg.IsFile(i)) {
+            files.push_back(i);
+            job.bytes_total += pkg.GetFileSize(i);
+        }
+    }
+    job.files_total = static_cast<u32>(files.size());
+
+    struct VerifyWorker {
+        PfscBlockReader reader;
+        PfscBlock block;
+        std::vector<u8> buffer = std::vector<u8>(PFSC_BLOCK_SIZE);
+    };
+    Common::ParallelFor(
+        files.size(), num_threads, [&](u32) { return VerifyWorker{PfscBlockReader(pkg)}; },
+        [&](VerifyWorker& state, size_t n) {
+            if (job.progress.cancel) {
+                return;
+            }
+            const u64 size = pkg.GetFileSize(files[n]);
+            bool ok = true;
+            for (u64 b = 0; ok && b * PFSC_BLOCK_SIZE < size && !job.progress.cancel; b++) {
+                ok = state.reader.Read(files[n], b, state.block) &&
+                     (!state.block.compressed ||
+                      InflatePfscBlock(state.block.data, state.buffer) ==
+                          static_cast<s64>(PFSC_BLOCK_SIZE));
+                job.progress.bytes_written += state.block.size;
+            }
+            if (!ok) {
+                job.failed++;
+                job.AddOutput(fmt::format("{{\"path\":\"{}\",\"error\":\"corrupted block\"}}\n",
+                                          EscapeJson(pkg.GetRelativePath(files[n]))));
+            }
+            job.progress.files_done++;
+        });
+    return true;
+}
+
+/// Runs jobs on a fixed set of runner threads, highest priority first and in submission order
+/// within a priority. Every job gets the same share of the cores for its own worker threads.
+class JobScheduler {
+public:
+    explicit JobScheduler(u32 max_jobs) {
+        for (u32 i = 0; i < max_jobs; i++) {
+            runners.emplace_back([this](std::stop_token stop) { Run(stop); });
+        }
+    }
+
+    ~JobScheduler() {
+        Stop();
+    }
+
+    std::shared_ptr<Job> Submit(JobType type, int priority, std::filesystem::path pkg_path,
+                                std::filesystem::path out_dir) {
+        auto job = std::make_shared<Job>();
+        job->type = type;
+        job->priority = priority;
+        job->pkg_path = std::move(pkg_path);
+        job->out_dir = std::move(out_dir);
+        {
+            std::scoped_lock lock{mutex};
+            job->id = next_id++;
+            ForgetFinishedJobs();
+            jobs.emplace(job->id, job);
+            queue.push(job);
+        }
+        cv.notify_one();
+        return job;
+    }
+
+    std::shared_ptr<Job> Find(u64 id) {
+        std::scoped_lock lock{mutex};
+        const auto it = jobs.find(id);
+        return it != jobs.end() ? it->second : nullptr;
+    }
+
+    std::vector<std::shared_ptr<Job>> GetJobs() {
+        std::scoped_lock lock{mutex};
+        std::vector<std::shared_ptr<Job>> list;
+        for (const auto& [id, job] : jobs) {
+            list.push_back(job);
+        }
+        return list;
+    }
+
+    /// Drops a finished job once its result was fetched.
+    void Forget(u64 id) {
+        std::scoped_lock lock{mutex};
+        const auto it = jobs.find(id);
+        if (it != jobs.end() && IsFinished(it->second->state)) {
+            jobs.erase(it);
+        }
+    }
+
+    /// Queued jobs never start, running ones stop at the next file or block.
+    void Cancel(Job& job) {
+        job.progress.cancel = true;
+        JobState expected = JobState::Queued;
+        job.state.compare_exchange_strong(expected, JobState::Cancelled);
+    }
+
+    void Stop() {
+        for (const auto& job : GetJobs()) {
+            Cancel(*job);
+        }
+        runners.clear();
+    }
+
+private:
+    struct ByPriority {
+        bool operator()(const std::shared_ptr<Job>& a, const std::shared_ptr<Job>& b) const {
+            return a->priority != b->priority ? a->priority < b->priority : a->id > b->id;
+        }
+    };
+
+    /// Keeps status and output of the most recent finished jobs only. Called with mutex held.
+    void ForgetFinishedJobs() {
+        size_t finished = std::ranges::count_if(
+            jobs, [](const auto& entry) { return IsFinished(entry.second->state); });
+        for (auto it = jobs.begin(); it != jobs.end() && finished > MaxFinishedJobs;) {
+            if (IsFinished(it->second->state)) {
+                it = jobs.erase(it);
+                finished--;
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void Run(std::stop_token stop) {
+        while (true) {
+            std::shared_ptr<Job> job;
+            {
+                std::unique_lock lock{mutex};
+                if (!cv.wait(lock, stop, [this] { return !queue.empty(); })) {
+                    return;
+                }
+                job = queue.top();
+                queue.pop();
+            }
+            JobState expected = JobState::Queued;
+            if (job->state.compare_exchange_strong(expected, JobState::Running)) {
+                Execute(*job);
+            }
+        }
+    }
+
+    /// Splits the hardware threads between the jobs running when this one starts, so a lone job
+    /// uses all of them.
+    void Execute(Job& job) {
+        const u32 num_threads =
+            std::max(1U, std::thread::hardware_concurrency() / ++running_jobs);
+        std::string error;
+        bool ok = false;
+        switch (job.type) {
+        case JobType::Extract:
+            ok = RunExtractJob(job, num_threads, error);
+            break;
+        case JobType::List:
+            ok = RunListJob(job, error);
+            break;
+        case JobType::Verify:
+            ok = RunVerifyJob(job, num_threads, error);
+            break;
+        }
+        running_jobs--;
+        if (!ok) {
+            std::scoped_lock lock{job.mutex};
+            job.error = error.empty() ? "Failed to open PKG" : error;
+        }
+
+        JobState state = JobState::Done;
+        if (job.progress.cancel) {
+            state = JobState::Cancelled;
+        } else if (!ok || job.failed != 0) {
+            state = JobState::Failed;
+        }
+        job.state = state;
+        std::cout << "Job " << job.id << " (" << ToString(job.type) << " "
+                  << job.pkg_path.filename() << ") " << ToString(state) << "\n";
+    }
+
+    std::atomic<u32> running_jobs{0};
+    std::mutex mutex;
+    std::condition_variable_any cv;
+    std::priority_queue<std::shared_ptr<Job>, std::vector<std::shared_ptr<Job>>, ByPriority> queue;
+    std::map<u64, std::shared_ptr<Job>> jobs;
+    u64 next_id = 1;
+    std::vector<std::jthread> runners; // Declared last so they stop before the state goes away.
+};
+
+bool SendAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const ssize_t sent = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(sent));
+    }
+    return true;
+}
+
+bool ReadRequest(int fd, std::string& line) {
+    char c;
+    while (line.size() < MaxRequestSize) {
+        if (::recv(fd, &c, 1, 0) != 1) {
+            return !line.empty();
+        }
+        if (c == '\n') {
+            return true;
+        }
+        line += c;
+    }
+    return false;
+}
+
+std::vector<std::string> SplitFields(std::string_view line) {
+    std::vector<std::string> fields;
+    for (size_t begin = 0; begin <= line.size();) {
+        const size_t end = std::min(line.find('\t', begin), line.size());
+        fields.emplace_back(line.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return fields;
+}
+
+template <typename T>
+bool ParseNumber(std::string_view text, T& value) {
+    const auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return ec == std::errc{} && ptr == text.data() + text.size();
+}
+
+/// Handles the single request of a connection. Returns the reply, watch requests stream theirs.
+std::string HandleRequest(int fd, std::string_view request, JobScheduler& scheduler,
+                          std::atomic<bool>& stopping) {
+    const auto fields = SplitFields(request);
+    const auto& command = fields[0];
+
+    static constexpr std::array<std::pair<std::string_view, JobType>, 3> JobCommands = {{
+        {"extract", JobType::Extract},
+        {"list", JobType::List},
+        {"verify", JobType::Verify},
+    }};
+    const auto job_command = std::ranges::find(JobCommands, command,
+                                               &std::pair<std::string_view, JobType>::first);
+    if (job_command != JobCommands.end()) {
+        const JobType type = job_command->second;
+        const size_t paths = type == JobType::Extract ? 2 : 1;
+        int priority = 0;
+        if (fields.size() < paths + 1 || fields.size() > paths + 2 ||
+            (fields.size() == paths + 2 && !ParseNumber(fields.back(), priority))) {
+            return FormatError(fmt::format("Usage: {} <pkg>{} [priority]", command,
+                                           paths == 2 ? " <output>" : ""));
+        }
+        auto job = scheduler.Submit(type, priority, fields[1], paths == 2 ? fields[2] : "");
+        return FormatStatus(*job);
+    }
+
+    if (command == "status" && fields.size() == 1) {
+        std::string reply;
+        for (const auto& job : scheduler.GetJobs()) {
+            reply += FormatStatus(*job);
+        }
+        return reply;
+    }
+    if (command == "shutdown" && fields.size() == 1) {
+        stopping = true;
+        return "{\"event\":\"shutdown\"}\n";
+    }
+
+    u64 id = 0;
+    if (fields.size() != 2 || !ParseNumber(fields[1], id)) {
+        return FormatError(fmt::format("Unknown request: {}", request));
+    }
+    const auto job = scheduler.Find(id);
+    if (!job) {
+        return FormatError(fmt::format("No job {}", id));
+    }
+
+    if (command == "status") {
+        return FormatStatus(*job);
+    }
+    if (command == "cancel") {
+        scheduler.Cancel(*job);
+        return FormatStatus(*job);
+    }
+    if (command == "watch") {
+        while (!IsFinished(job->state) && !stopping) {
+            if (!SendAll(fd, FormatStatus(*job))) {
+                return {};
+            }
+            std::this_thread::sleep_for(WatchInterval);
+        }
+        return FormatStatus(*job);
+    }
+    if (command == "result") {
+        if (!IsFinished(job->state)) {
+            return FormatError(fmt::format("Job {} has not finished", id));
+        }
+        std::string reply;
+        {
+            std::scoped_lock lock{job->mutex};
+            for (const auto& line : job->output) {
+                reply += line;
+            }
+        }
+        scheduler.Forget(id);
+        return reply + FormatStatus(*job);
+    }
+    return FormatError(fmt::format("Unknown request: {}", request));
+}
+
+bool MakeSocketAddress(const std::filesystem::path& socket_path, sockaddr_un& address) {
+    const auto& native = socket_path.native();
+    address = {};
+    address.sun_family = AF_UNIX;
+    if (native.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: Socket path is too long: " << socket_path << "\n";
+        return false;
+    }
+    std::memcpy(address.sun_path, native.c_str(), native.size() + 1);
+    return true;
+}
+
+} // Anonymous namespace
+
+int RunDaemon(const std::filesystem::path& socket_path, u32 max_jobs) {
+    sockaddr_un address;
+    if (!MakeSocketAddress(socket_path, address)) {
+        return 1;
+    }
+    const int listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        std::cerr << "Error: Failed to create socket: " << std::strerror(errno) << "\n";
+        return 1;
+    }
+
+    // A socket left behind by a daemon that did not shut down cleanly is replaced.
+    std::error_code ec;
+    if (std::filesystem::is_socket(socket_path, ec)) {
+        std::filesystem::remove(socket_path, ec);
+    }
+    if (::bind(listen_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::chmod(socket_path.c_str(), 0600) != 0 || ::listen(listen_fd, 16) != 0) {
+        std::cerr << "Error: Failed to listen on " << socket_path << ": " << std::strerror(errno)
+                  << "\n";
+        ::close(listen_fd);
+        return 1;
+    }
+
+    max_jobs = std::max(1U, max_jobs);
+    std::cout << "Listening on " << socket_path << ", running up to " << max_jobs
+              << " jobs at once\n";
+
+    std::atomic<bool> stopping{false};
+    {
+        JobScheduler scheduler(max_jobs);
+
+        // The descriptor stays open until the thread is joined, so shutdown can wake it up.
+        struct Connection {
+            int fd;
+            std::shared_ptr<std::atomic<bool>> done;
+            std::jthread thread;
+
+            ~Connection() {
+                thread.join();
+                ::close(fd);
+            }
+        };
+        std::list<Connection> connections;
+
+        while (!stopping) {
+            std::erase_if(connections, [](const Connection& c) { return c.done->load(); });
+            pollfd pfd{.fd = listen_fd, .events = POLLIN};
+            if (::poll(&pfd, 1, AcceptInterval) <= 0) {
+                continue;
+            }
+            const int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0) {
+                continue;
+            }
+            // A client that stops talking must not keep its thread, and shutdown, waiting.
+            ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &ClientTimeout, sizeof(ClientTimeout));
+            ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &ClientTimeout, sizeof(ClientTimeout));
+            if (connections.size() >= MaxConnections) {
+                SendAll(fd, FormatError("Too many connections"));
+                ::close(fd);
+                continue;
+            }
+
+            auto done = std::make_shared<std::atomic<bool>>(false);
+            connections.emplace_back(fd, done, std::jthread([fd, done, &scheduler, &stopping] {
+                std::string request;
+                if (ReadRequest(fd, request) && !request.empty()) {
+                    SendAll(fd, HandleRequest(fd, request, scheduler, stopping));
+                }
+                ::shutdown(fd, SHUT_RDWR);
+                *done = true;
+            }));
+        }
+
+        std::cout << "Shutting down, cancelling unfinished jobs\n";
+        scheduler.Stop();
+        for (const auto& connection : connections) {
+            ::shutdown(connection.fd, SHUT_RDWR);
+        }
+        connections.clear();
+    }
+
+    ::close(listen_fd);
+    std::filesystem::remove(socket_path, ec);
+    return 0;
+}
+
+int RunClient(const std::filesystem::path& socket_path, const std::vector<std::string>& request) {
+    sockaddr_un address;
+    if (request.empty() || !MakeSocketAddress(socket_path, address)) {
+        return 1;
+    }
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 ||
+        ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        std::cerr << "Error: Failed to connect to " << socket_path << ": " << std::strerror(errno)
+                  << "\n";
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return 1;
+    }
+
+    std::string line = request[0];
+    for (size_t i = 1; i < request.size(); i++) {
+        line += '\t';
+        line += request[i];
+    }
+    line += '\n';
+    if (!SendAll(fd, line)) {
+        std::cerr << "Error: Failed to send request\n";
+        ::close(fd);
+        return 1;
+    }
+
+    // Print the reply as it arrives, so watch requests show progress live.
+    std::string last_line;
+    std::string pending;
+    char buffer[4096];
+    ssize_t received;
+    while ((received = ::recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+        std::cout.write(buffer, received);
+        std::cout.flush();
+        pending.append(buffer, static_cast<size_t>(received));
+        const size_t end = pending.rfind('\n');
+        if (end != std::string::npos) {
+            const size_t begin = pending.rfind('\n', end - 1);
+            last_line = pending.substr(begin == std::string::npos ? 0 : begin + 1,
+                                       end - (begin == std::string::npos ? 0 : begin + 1));
+            pending.erase(0, end + 1);
+        }
+    }
+    ::close(fd);
+
+    if (last_line.empty() || last_line.starts_with("{\"error\"")) {
+        return 1;
+    }
+    if (request[0] == "watch" && last_line.find("\"state\":\"done\"") == std::string::npos) {
+        return 1;
+    }
+    return 0;
+}
+
+#endif
@@ -0,0 +1,27 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "common/types.h"
+
+/// Upper bound of the jobs a daemon runs at once, each one has its own runner thread.
+constexpr u32 DAEMON_MAX_JOBS = 64;
+
+/**
+ * Serves extract, list and verify jobs on a Unix domain socket until a shutdown request. Queued
+ * jobs start by priority, at most max_jobs at a time, and each job gets an even share of the cores
+ * among the jobs running when it starts. Each connection carries one tab separated request line,
+ * replies are JSON lines:
+ *
+ *   extract <pkg> <output> [priority]   list <pkg> [priority]   verify <pkg> [priority]
+ *   status [job]   watch <job>   result <job>   cancel <job>   shutdown
+ */
+int RunDaemon(const std::filesystem::path& socket_path, u32 max_jobs);
+
+/// Sends one request to a daemon and prints the reply. Fails if the daemon reports an error or
+/// the job that was watched did not complete.
+int RunClient(const std::filesystem::path& socket_path, const std::vector<std::string>& request);
@@ -1,26 +1,274 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// Logging backend of the CLI tool, used in place of common/logging/backend.cpp.
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <fmt/args.h>
+#include <fmt/format.h>
+
 #include "common/logging/log.h"
-#include <fmt/core.h>
-#include <iostream>
+#include "common/logging/log_entry.h"
+#include "common/logging/text_formatter.h"
 
 namespace Common::Log {
-    // Implementation for the FmtLogMessageImpl function that's missing in the link step
-    void FmtLogMessageImpl(Class cls, Level lvl, const char* filename, unsigned int line,
-                          const char* function, const char* format,
-                          const fmt::v11::basic_format_args<fmt::v11::context>& args) {
-        // Simple implementation that prints to console
-        std::string formatted_message = fmt::vformat(format, args);
-        fmt::print("[{}:{}] {}: {}\n", filename, line, function, formatted_message);
-    }
-    
-    // Implementation for the Stop function
+
+namespace {
+
+using ArgStore = fmt::dynamic_format_arg_store<fmt::format_context>;
+
+/// A log call whose arguments were copied so the writer thread can format it later.
+struct PendingEntry {
+    std::chrono::microseconds timestamp;
+    Class log_class;
+    Level log_level;
+    const char* filename;
+    u32 line_num;
+    const char* function;
+    const char* format; // Always a string literal from the LOG_* macros.
+    ArgStore args;
+    bool preformatted;
+    std::string message; // Set instead of args when they could not be copied.
+};
+
+/// Copies the arguments of a log call into an owning store. Returns false for argument types
+/// that only hold a reference to the caller's object, those have to be formatted right away.
+bool CopyArgs(const fmt::format_args& args, ArgStore& store) {
+    bool copyable = true;
+    const auto copy = [&](auto value) {
+        using T = decltype(value);
+        if constexpr (std::is_same_v<T, fmt::monostate> ||
+                      std::is_same_v<T, fmt::basic_format_arg<fmt::format_context>::handle>) {
+            copyable = false;
+        } else if constexpr (std::is_same_v<T, const char*>) {
+            store.push_back(std::string(value));
+        } else if constexpr (std::is_same_v<T, fmt::string_view>) {
+            store.push_back(std::string(value.data(), value.size()));
+        } else if constexpr (std::is_arithmetic_v<T> || std::is_same_v<T, const void*>) {
+            store.push_back(value);
+        } else {
+            copyable = false; // 128-bit integers
+        }
+    };
+    for (int i = 0; copyable; i++) {
+        const auto arg = args.get(i);
+        if (!arg) {
+            break;
+        }
+#if FMT_VERSION >= 110000
+        arg.visit(copy);
+#else
+        fmt::visit_format_arg(copy, arg);
+#endif
+    }
+    return copyable;
+}
+
+/**
+ * Log calls are pushed into a bounded lock-free multi-producer queue and formatted and written
+ * by a single writer thread, one batch per wakeup, so extraction workers never wait on the
+ * console or on each other. Once stopped, producers drain the queue themselves.
+ */
+class AsyncLogger {
+public:
+    AsyncLogger() {
+        for (size_t i = 0; i < Capacity; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        writer = std::jthread([this](std::stop_token stop) { Run(stop); });
+    }
+
+    ~AsyncLogger() {
+        Stop();
+    }
+
+    void Push(PendingEntry&& entry) {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[pos % Capacity];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(sequence - pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // Full, let the writer catch up, or make room ourselves if it has stopped.
+                if (stopped.load(std::memory_order_acquire)) {
+                    std::scoped_lock lock{stop_mutex};
+                    Drain();
+                } else {
+                    cv.notify_one();
+                    std::this_thread::yield();
+                }
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->entry = std::move(entry);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (stopped.load(std::memory_order_relaxed)) {
+            // E.g. logged while an assertion failure is reported, write it out right away.
+            std::scoped_lock lock{stop_mutex};
+            Drain();
+        } else if (writer_idle.load(std::memory_order_relaxed)) {
+            cv.notify_one();
+        }
+    }
+
     void Stop() {
-        // No-op implementation for our CLI tool
+        std::scoped_lock lock{stop_mutex};
+        if (writer.joinable()) {
+            writer.request_stop();
+            cv.notify_one();
+            writer.join();
+            stopped.store(true, std::memory_order_seq_cst);
+            Drain();
+        }
+    }
+
+private:
+    static constexpr size_t Capacity = 4096;
+    static constexpr auto IdleInterval = std::chrono::milliseconds(50);
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        PendingEntry entry;
+    };
+
+    bool Pop(PendingEntry& entry) {
+        Cell& cell = cells[dequeue_pos % Capacity];
+        if (cell.sequence.load(std::memory_order_acquire) != dequeue_pos + 1) {
+            return false;
+        }
+        entry = std::move(cell.entry);
+        cell.sequence.store(dequeue_pos + Capacity, std::memory_order_release);
+        dequeue_pos++;
+        return true;
+    }
+
+    /// Formats and writes out everything queued, returns false if there was nothing. Only one
+    /// thread drains at a time: the writer, or a holder of stop_mutex once the writer stopped.
+    bool Drain() {
+        buffer.clear();
+        while (Pop(pending)) {
+            Entry entry{
+                .timestamp = pending.timestamp,
+                .log_class = pending.log_class,
+                .log_level = pending.log_level,
+                .filename = pending.filename,
+                .line_num = pending.line_num,
+                .function = pending.function,
+                .message = pending.preformatted ? std::move(pending.message) : Format(pending),
+            };
+            buffer += FormatLogMessage(entry);
+            buffer += '\n';
+            pending.args.clear();
+            pending.message.clear();
+        }
+        if (buffer.empty()) {
+            return false;
+        }
+        std::fwrite(buffer.data(), 1, buffer.size(), stderr);
+        std::fflush(stderr);
+        return true;
+    }
+
+    void Run(std::stop_token stop) {
+        while (true) {
+            if (Drain()) {
+                continue;
+            }
+            if (stop.stop_requested()) {
+                return;
+            }
+
+            // Producers only notify while the writer is idle; the timeout covers a missed wakeup.
+            std::unique_lock lock{idle_mutex};
+            writer_idle.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!HasPending()) {
+                cv.wait_for(lock, stop, IdleInterval, [this] { return HasPending(); });
+            }
+            writer_idle.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    static std::string Format(const PendingEntry& pending) {
+        try {
+            return fmt::vformat(pending.format, pending.args);
+        } catch (const fmt::format_error& e) {
+            return fmt::format("Failed to format \"{}\": {}", pending.format, e.what());
+        }
+    }
+
+    bool HasPending() const {
+        return cells[dequeue_pos % Capacity].sequence.load(std::memory_order_acquire) ==
+               dequeue_pos + 1;
     }
+
+    std::array<Cell, Capacity> cells;
+    alignas(64) std::atomic<size_t> enqueue_pos{0};
+    alignas(64) size_t dequeue_pos = 0;
+    std::string buffer;  // Used by Drain only.
+    PendingEntry pending; // Used by Drain only.
+    std::atomic<bool> writer_idle{false};
+    std::mutex idle_mutex;
+    std::condition_variable_any cv;
+    std::mutex stop_mutex;
+    std::atomic<bool> stopped{false}; // Set once the writer has exited.
+    std::jthread writer;
+};
+
+AsyncLogger& Logger() {
+    static AsyncLogger logger;
+    return logger;
 }
 
-namespace Config {
-    // Implementation for the getTrophyKey function
-    std::string getTrophyKey() {
-        return "0000000000000000000000000000000000000000000000000000000000000000";
+const auto start_time = std::chrono::steady_clock::now();
+
+} // Anonymous namespace
+
+void FmtLogMessageImpl(Class log_class, Level log_level, const char* filename,
+                       unsigned int line_num, const char* function, const char* format,
+                       const fmt::format_args& args) {
+    if (log_level < Level::Info) {
+        return;
+    }
+
+    PendingEntry entry{
+        .timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start_time),
+        .log_class = log_class,
+        .log_level = log_level,
+        .filename = filename,
+        .line_num = line_num,
+        .function = function,
+        .format = format,
+        .preformatted = false,
+    };
+    if (!CopyArgs(args, entry.args)) {
+        entry.args.clear();
+        entry.preformatted = true;
+        entry.message = fmt::vformat(format, args);
     }
-}
\ No newline at end of file
+    Logger().Push(std::move(entry));
+}
+
+/// Writes out everything still queued, called before exit and on assertion failures.
+void Stop() {
+    Logger().Stop();
+}
+
+} // namespace Common::Log
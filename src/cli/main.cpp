@@ -1,27 +1,89 @@
+#include <charconv>
+#include <chrono>
+#include <fmt/format.h>
 #include <iostream>
 #include <filesystem>
 #include <string>
 #include <vector>
+#include "core/file_format/game_archive.h"
+#include "core/file_format/game_library.h"
 #include "core/file_format/pkg.h"
+#include "core/file_format/pkg_builder.h"
+#include "core/file_format/pkg_catalog.h"
+#include "core/file_format/pkg_diff.h"
+#include "core/file_format/playgo_chunk.h"
+#include "core/file_format/psf.h"
+#include "core/file_format/trp.h"
+#include "core/loader/elf.h"
+#include "daemon.h"
+#include "progress.h"
+#include "common/config.h"
+#include "common/io_file.h"
 #include "common/logging/log.h"
 
-// Helper function to safely extract a single file index
-bool ExtractSingleFile(PKG& pkg, int index) {
-    try {
-        pkg.ExtractFiles(index);
-        return true;
-    } catch (const std::exception& e) {
-        std::cerr << "Exception extracting file " << index << ": " << e.what() << std::endl;
-        return false;
-    } catch (...) {
-        std::cerr << "Unknown error extracting file " << index << std::endl;
-        return false;
+// Options that narrow down what gets extracted
+struct ExtractOptions {
+    bool playgoFilter = false;
+    PlaygoSelection playgo;
+    int progressFd = -1; // Receives JSON lines progress events when set
+};
+
+// Split a comma separated option value
+std::vector<std::string> SplitList(const std::string& value) {
+    std::vector<std::string> items;
+    size_t start = 0;
+    while (start <= value.size()) {
+        const size_t end = std::min(value.find(',', start), value.size());
+        if (end > start) {
+            items.push_back(value.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+    return items;
+}
+
+// Parse a whole option value as a number, rejecting anything out of range for T
+template <typename T>
+bool ParseNumber(std::string_view text, T& value) {
+    const auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return ec == std::errc{} && ptr == text.data() + text.size();
+}
+
+// Pick the files of the PKG to extract, honouring any PlayGo chunk selection
+std::vector<int> SelectFiles(PKG& pkg, const std::filesystem::path& outDir,
+                             const ExtractOptions& options) {
+    const u32 numFiles = pkg.GetNumberOfFiles();
+    std::vector<int> indices;
+    indices.reserve(numFiles);
+
+    PlaygoFile playgo;
+    if (options.playgoFilter && !playgo.Open(outDir / "sce_sys" / "playgo-chunk.dat")) {
+        std::cout << "No PlayGo chunk data in this PKG, extracting all files\n";
     }
+    if (!options.playgoFilter || playgo.chunks.empty()) {
+        for (u32 i = 0; i < numFiles; i++) {
+            indices.push_back(static_cast<int>(i));
+        }
+        return indices;
+    }
+
+    // Files belonging only to unselected chunks are never decrypted or inflated.
+    const PlaygoFilter filter(playgo, options.playgo);
+    for (u32 i = 0; i < numFiles; i++) {
+        const auto [begin, end] = pkg.GetFileImageRange(static_cast<int>(i));
+        if (begin == end || filter.IsWanted(begin, end)) {
+            indices.push_back(static_cast<int>(i));
+        }
+    }
+    std::cout << "PlayGo selection keeps " << indices.size() << " of " << numFiles << " entries"
+              << '\n';
+    return indices;
 }
 
 // Process a single PKG file
-bool ProcessPkg(const std::filesystem::path& pkgPath, const std::filesystem::path& baseOutDir) {
-    std::cout << "\nProcessing PKG: " << pkgPath.filename() << std::endl;
+bool ProcessPkg(const std::filesystem::path& pkgPath, const std::filesystem::path& baseOutDir,
+                const ExtractOptions& options) {
+    std::cout << "\nProcessing PKG: " << pkgPath.filename() << '\n';
     
     // Check if PKG file exists
     if (!std::filesystem::exists(pkgPath)) {
@@ -66,12 +128,12 @@ bool ProcessPkg(const std::filesystem::path& pkgPath, const std::filesystem::pat
 
     std::cout << "Extracting PKG: " << pkgPath.filename() << "\n";
     std::cout << "Output directory: " << actualOutDir << "\n";
-    std::cout << "Title ID: " << titleID << std::endl;
-    std::cout << "PKG Size: " << pkg.GetPkgSize() << " bytes" << std::endl;
-    std::cout << "Content Flags: " << pkg.GetPkgFlags() << std::endl;
+    std::cout << "Title ID: " << titleID << '\n';
+    std::cout << "PKG Size: " << pkg.GetPkgSize() << " bytes\n";
+    std::cout << "Content Flags: " << pkg.GetPkgFlags() << '\n';
     
     // Extract metadata and headers
-    std::cout << "Extracting PKG header and metadata..." << std::endl;
+    std::cout << "Extracting PKG header and metadata...\n";
     if (!pkg.Extract(pkgPath, actualOutDir, failReason)) {
         std::cerr << "Extraction failed: " << failReason << "\n";
         return false;
@@ -79,52 +141,580 @@ bool ProcessPkg(const std::filesystem::path& pkgPath, const std::filesystem::pat
     
     // Get count of files to extract
     u32 numFiles = pkg.GetNumberOfFiles();
-    std::cout << "Found " << numFiles << " files to extract..." << std::endl;
+    std::cout << "Found " << numFiles << " files to extract...\n";
     
     // Create an array of indices to extract
-    std::vector<int> indices;
-    for (u32 i = 0; i < numFiles; i++) {
-        indices.push_back(static_cast<int>(i));
-    }
-    
-    // Extract each file individually
-    int extractedCount = 0;
-    int failedCount = 0;
+    const std::vector<int> indices = SelectFiles(pkg, actualOutDir, options);
+    const size_t numSelected = indices.size();
     
-    for (int index : indices) {
-        std::cout << "Extracting file " << (index + 1) << " of " << numFiles << "..." << std::endl;
-        
-        if (ExtractSingleFile(pkg, index)) {
-            extractedCount++;
-        } else {
-            failedCount++;
-        }
-        
-        // Show progress every 10 files
-        if ((index + 1) % 10 == 0 || (index + 1) == numFiles) {
-            std::cout << "Progress: " << (index + 1) << " / " << numFiles << " files" << std::endl;
-        }
+    // Extract the files, batched per directory across all cores
+    std::cout << "Extracting " << numSelected << " entries...\n";
+    u32 failedCount = 0;
+    ExtractProgress progress;
+    ProgressReporter reporter(pkgPath.filename().string(), progress, pkg.GetTotalSize(indices),
+                              pkg.CountFiles(indices), options.progressFd);
+    try {
+        failedCount = pkg.ExtractFiles(indices, 0, &progress);
+    } catch (const std::exception& e) {
+        std::cerr << "Exception during extraction: " << e.what() << '\n';
+        return false;
+    }
+    reporter.Finish(failedCount);
+    const size_t extractedCount = numSelected - failedCount;
+
+    // Lets game library scans take the size from here instead of walking the tree.
+    if (failedCount == 0 &&
+        !WriteExtractManifest(actualOutDir, progress.bytes_written, progress.files_done)) {
+        std::cerr << "Warning: Failed to write the extraction manifest\n";
     }
 
     std::cout << "Extraction complete: " << extractedCount << " files extracted, " 
-              << failedCount << " files failed." << std::endl;
+              << failedCount << " files failed.\n";
     std::cout << "Files extracted to: " << actualOutDir << "\n";
     
     return failedCount == 0; // Return true if all files were extracted successfully
 }
 
+// Mirror an extracted tree, hard linking files where possible. sce_sys is copied since the patch
+// rewrites its files in place.
+bool CloneTree(const std::filesystem::path& base, const std::filesystem::path& merged,
+               size_t& linked, size_t& copied) {
+    std::error_code ec;
+    std::filesystem::create_directories(merged, ec);
+    for (auto it = std::filesystem::recursive_directory_iterator(base, ec);
+         !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+        const auto relative = it->path().lexically_relative(base);
+        const auto target = merged / relative;
+        if (it->is_directory()) {
+            std::filesystem::create_directory(target, ec);
+            continue;
+        }
+        if (!it->is_regular_file()) {
+            continue;
+        }
+        if (*relative.begin() != "sce_sys") {
+            std::filesystem::create_hard_link(it->path(), target, ec);
+            if (!ec) {
+                linked++;
+                continue;
+            }
+            ec.clear();
+        }
+        // Different file system or no hard link support: fall back to a copy.
+        if (!std::filesystem::copy_file(it->path(), target, ec)) {
+            std::cerr << "Error: Failed to copy " << it->path() << ": " << ec.message() << "\n";
+            return false;
+        }
+        copied++;
+    }
+    if (ec) {
+        std::cerr << "Error: Failed to read " << base << ": " << ec.message() << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Refuse to mix up titles: the base must be an extraction of the same game.
+bool CheckBaseGame(const std::filesystem::path& baseDir, std::string_view titleID) {
+    Common::FS::IOFile sfoFile(baseDir / "sce_sys" / "param.sfo", Common::FS::FileAccessMode::Read);
+    std::vector<u8> sfo(sfoFile.IsOpen() ? sfoFile.GetSize() : 0);
+    PsfView psf;
+    if (sfo.empty() || sfoFile.Read(sfo) != sfo.size() || !psf.Open(sfo)) {
+        std::cerr << "Error: " << baseDir << " is not an extracted game (no sce_sys/param.sfo)\n";
+        return false;
+    }
+    const auto baseTitleID = psf.GetString("TITLE_ID").value_or("");
+    if (baseTitleID != titleID) {
+        std::cerr << "Error: PKG is for " << titleID << " but the base game is " << baseTitleID
+                  << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Apply a patch PKG onto an extracted base game, in place or into a new merged tree
+int RunApply(const std::filesystem::path& pkgPath, const std::filesystem::path& baseDir,
+             const std::filesystem::path& mergedDir, const ExtractOptions& options) {
+    PKG pkg;
+    std::string failReason;
+    if (!pkg.Open(pkgPath, failReason)) {
+        std::cerr << "Failed to open PKG file: " << failReason << "\n";
+        return 1;
+    }
+    if (!CheckBaseGame(baseDir, pkg.GetTitleID())) {
+        return 1;
+    }
+
+    std::filesystem::path target = baseDir;
+    if (!mergedDir.empty()) {
+        std::error_code ec;
+        if (std::filesystem::exists(mergedDir, ec) && !std::filesystem::is_empty(mergedDir, ec)) {
+            std::cerr << "Error: Merged output directory is not empty: " << mergedDir << "\n";
+            return 1;
+        }
+        size_t linked = 0;
+        size_t copied = 0;
+        if (!CloneTree(baseDir, mergedDir, linked, copied)) {
+            return 1;
+        }
+        std::cout << "Mirrored base game: " << linked << " files linked, " << copied
+                  << " copied\n";
+        target = mergedDir;
+    }
+
+    std::cout << "Applying " << pkgPath.filename() << " (" << pkg.GetPkgFlags() << ") to "
+              << target << "\n";
+    // The size recorded at extraction no longer holds once the patch is applied.
+    std::error_code manifestEc;
+    std::filesystem::remove(GetExtractManifestPath(target), manifestEc);
+    if (!pkg.ExtractOver(pkgPath, target, failReason)) {
+        std::cerr << "Extraction failed: " << failReason << "\n";
+        return 1;
+    }
+
+    const std::vector<int> indices = SelectFiles(pkg, target, options);
+    ExtractProgress progress;
+    ProgressReporter reporter(pkgPath.filename().string(), progress, pkg.GetTotalSize(indices),
+                              pkg.CountFiles(indices), options.progressFd);
+    const u32 failedCount = pkg.ExtractFiles(indices, 0, &progress);
+    reporter.Finish(failedCount);
+
+    std::cout << "Patch applied: " << pkg.CountFiles(indices) - failedCount
+              << " files written, " << failedCount << " files failed.\n";
+    return failedCount == 0 ? 0 : 1;
+}
+
+// Update an extraction of oldPkg to newPkg, only writing the files whose data changed
+int RunDiffExtract(const std::filesystem::path& oldPath, const std::filesystem::path& newPath,
+                   const std::filesystem::path& targetDir, const ExtractOptions& options) {
+    PKG oldPkg;
+    PKG newPkg;
+    std::string failReason;
+    if (!oldPkg.Open(oldPath, failReason) || !oldPkg.Mount(oldPath, failReason)) {
+        std::cerr << "Failed to open PKG file " << oldPath << ": " << failReason << "\n";
+        return 1;
+    }
+    if (!newPkg.Open(newPath, failReason) || !newPkg.Mount(newPath, failReason)) {
+        std::cerr << "Failed to open PKG file " << newPath << ": " << failReason << "\n";
+        return 1;
+    }
+    if (oldPkg.GetTitleID() != newPkg.GetTitleID()) {
+        std::cerr << "Error: PKGs are for different titles: " << oldPkg.GetTitleID() << " and "
+                  << newPkg.GetTitleID() << "\n";
+        return 1;
+    }
+    if (!CheckBaseGame(targetDir, newPkg.GetTitleID())) {
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    PkgDiff diff;
+    if (!DiffPkgs(oldPkg, newPkg, diff, failReason)) {
+        std::cerr << "Failed to compare PKGs: " << failReason << "\n";
+        return 1;
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+    std::cout << "Compared in " << elapsed.count() << " ms: " << diff.added.size() << " added, "
+              << diff.changed.size() << " changed, " << diff.removed.size() << " removed, "
+              << diff.unchanged << " unchanged (" << diff.blocks_compared << " blocks compared, "
+              << diff.blocks_inflated << " inflated)\n";
+
+    // The size recorded at extraction no longer holds once the tree is updated.
+    std::error_code ec;
+    std::filesystem::remove(GetExtractManifestPath(targetDir), ec);
+
+    // Removed first, a path may come back as a directory where a file used to be.
+    u32 removedCount = 0;
+    for (const auto& path : diff.removed) {
+        if (std::filesystem::remove(targetDir / path, ec)) {
+            removedCount++;
+        } else if (ec) {
+            std::cerr << "Warning: Failed to remove " << targetDir / path << ": " << ec.message()
+                      << "\n";
+        }
+    }
+
+    if (!newPkg.ExtractOver(newPath, targetDir, failReason)) {
+        std::cerr << "Extraction failed: " << failReason << "\n";
+        return 1;
+    }
+    std::vector<int> indices = diff.added;
+    indices.insert(indices.end(), diff.changed.begin(), diff.changed.end());
+    ExtractProgress progress;
+    ProgressReporter reporter(newPath.filename().string(), progress,
+                              newPkg.GetTotalSize(indices), newPkg.CountFiles(indices),
+                              options.progressFd);
+    const u32 failedCount = newPkg.ExtractFiles(indices, 0, &progress);
+    reporter.Finish(failedCount);
+
+    std::cout << "Update applied: " << newPkg.CountFiles(indices) - failedCount
+              << " files written, " << removedCount << " entries removed, " << failedCount
+              << " files failed.\n";
+    return failedCount == 0 ? 0 : 1;
+}
+
+// Refresh the on-disk catalog for a PKG library and print its contents
+int RunCatalog(const std::filesystem::path& sourceDir, const std::filesystem::path& catalogPath) {
+    if (!std::filesystem::exists(sourceDir) || !std::filesystem::is_directory(sourceDir)) {
+        std::cerr << "Error: Source directory not found or not a directory: " << sourceDir << "\n";
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::filesystem::path> pkgFiles;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(sourceDir)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".pkg") {
+            pkgFiles.push_back(entry.path());
+        }
+    }
+
+    PkgCatalog catalog;
+    catalog.Load(catalogPath);
+    const PkgCatalogStats stats = catalog.Refresh(pkgFiles);
+    if (!catalog.Save(catalogPath)) {
+        std::cerr << "Error: Failed to write catalog: " << catalogPath << "\n";
+        return 1;
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    for (const auto& entry : catalog.GetEntries()) {
+        std::cout << entry.title_id << '\t' << entry.content_id << '\t' << entry.category << '\t'
+                  << entry.app_ver << '\t' << entry.pkg_size << '\t' << entry.title << '\t'
+                  << entry.path << '\n';
+    }
+    for (const auto& failure : stats.failures) {
+        std::cerr << "Failed to read " << failure.path << ": " << failure.reason << '\n';
+    }
+    std::cout << "Catalog refreshed in " << elapsed.count() << " ms: "
+              << catalog.GetEntries().size() << " packages (" << stats.probed << " probed, "
+              << stats.reused << " cached, " << stats.removed << " removed, " << stats.failed
+              << " failed)\n";
+    return 0;
+}
+
+// Refresh the game library cache for install directories and print the games found
+int RunGames(const std::filesystem::path& installDir, const std::filesystem::path& cachePath) {
+    if (!std::filesystem::exists(installDir) || !std::filesystem::is_directory(installDir)) {
+        std::cerr << "Error: Install directory not found or not a directory: " << installDir
+                  << "\n";
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    GameLibrary library;
+    library.Load(cachePath);
+    const GameLibraryStats stats = library.Scan({&installDir, 1}, true);
+    if (!library.Save(cachePath)) {
+        std::cerr << "Error: Failed to write game library cache: " << cachePath << "\n";
+        return 1;
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    for (const auto& entry : library.GetEntries()) {
+        std::cout << entry.title_id << '\t' << entry.app_ver << '\t' << entry.size << '\t'
+                  << entry.title << '\t' << entry.path << '\n';
+    }
+    std::cout << "Game library refreshed in " << elapsed.count() << " ms: "
+              << library.GetEntries().size() << " games, " << stats.scanned_dirs
+              << " directories scanned (" << stats.probed << " probed, " << stats.reused
+              << " cached, " << stats.sized << " sized)\n";
+    return 0;
+}
+
+// Pack a directory laid out like an extracted game into a PKG signed with the fake keyset
+int RunPack(const std::filesystem::path& sourceDir, const std::filesystem::path& pkgPath,
+            const std::string& contentId) {
+    const auto start = std::chrono::steady_clock::now();
+
+    PkgBuildOptions options;
+    options.content_id = contentId;
+    PkgBuildStats stats;
+    std::string failReason;
+    if (!BuildPkg(sourceDir, pkgPath, options, failReason, &stats)) {
+        std::cerr << "Failed to build PKG: " << failReason << "\n";
+        return 1;
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+    std::cout << "Packed " << stats.num_files << " files in " << stats.num_dirs
+              << " directories and " << stats.num_entries << " sce_sys entries into "
+              << pkgPath << "\n";
+    std::cout << "PKG built in " << elapsed.count() << " ms: " << stats.input_bytes
+              << " bytes of files, " << stats.compressed_blocks << " of " << stats.num_blocks
+              << " blocks compressed, " << stats.pkg_size << " bytes written\n";
+    return 0;
+}
+
+// Export a PKG or an extracted game directory to a seekable game archive
+int RunExport(const std::filesystem::path& source, const std::filesystem::path& archivePath) {
+    const auto start = std::chrono::steady_clock::now();
+
+    GameArchiveStats stats;
+    std::string failReason;
+    bool ok;
+    if (std::filesystem::is_directory(source)) {
+        ok = ExportGameArchive(source, archivePath, failReason, &stats);
+    } else {
+        PKG pkg;
+        ok = pkg.Open(source, failReason) && pkg.Mount(source, failReason) &&
+             ExportGameArchive(pkg, archivePath, failReason, &stats);
+    }
+    if (!ok) {
+        std::cerr << "Failed to export archive: " << failReason << "\n";
+        return 1;
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+    std::cout << "Exported " << stats.num_files << " files in " << stats.num_dirs
+              << " directories to " << archivePath << "\n";
+    std::cout << "Archive written in " << elapsed.count() << " ms: " << stats.input_bytes
+              << " bytes of files, " << stats.compressed_blocks << " of " << stats.num_blocks
+              << " blocks compressed (" << stats.reused_blocks << " reused from the PKG), "
+              << stats.archive_size << " bytes written\n";
+    return 0;
+}
+
+// Extract every file of a game archive
+int RunUnarchive(const std::filesystem::path& archivePath, const std::filesystem::path& outDir) {
+    GameArchive archive;
+    std::string failReason;
+    if (!archive.Open(archivePath, failReason) || !archive.Extract(outDir, failReason)) {
+        std::cerr << "Failed to extract archive: " << failReason << "\n";
+        return 1;
+    }
+    std::cout << "Extracted " << archive.GetEntries().size() << " entries to " << outDir << "\n";
+    return 0;
+}
+
+// Print the SELF/ELF headers of executables inside a PKG without extracting it
+int RunInspectElf(const std::filesystem::path& pkgPath, const std::vector<std::string>& files) {
+    PKG pkg;
+    std::string failReason;
+    if (!pkg.Open(pkgPath, failReason) || !pkg.Mount(pkgPath, failReason)) {
+        std::cerr << "Failed to open PKG file: " << failReason << "\n";
+        return 1;
+    }
+
+    // Default to the main executable and every module shipped with the game
+    std::vector<int> indices;
+    if (files.empty()) {
+        for (u32 i = 0; i < pkg.GetNumberOfFiles(); i++) {
+            const auto path = pkg.GetRelativePath(static_cast<int>(i));
+            if (pkg.GetFileSize(static_cast<int>(i)) != 0 &&
+                (path == "eboot.bin" ||
+                 (path.starts_with("sce_module/") &&
+                  (path.ends_with(".prx") || path.ends_with(".sprx"))))) {
+                indices.push_back(static_cast<int>(i));
+            }
+        }
+    }
+    for (const auto& file : files) {
+        const int index = pkg.FindFile(file);
+        if (index < 0) {
+            std::cerr << "Error: " << file << " not found in PKG\n";
+            return 1;
+        }
+        indices.push_back(index);
+    }
+
+    int failed = 0;
+    for (const int index : indices) {
+        PkgFileReader reader(pkg, index);
+        Core::Loader::Elf elf;
+        std::cout << "== " << pkg.GetRelativePath(index) << " (" << reader.GetSize()
+                  << " bytes)\n";
+        if (!elf.OpenHeaders([&](u64 offset, std::span<u8> out) {
+                return reader.Read(offset, out);
+            })) {
+            std::cout << "Not a valid SELF/ELF file\n\n";
+            failed++;
+            continue;
+        }
+
+        if (elf.GetSElfHeader().magic == self_header::signature) {
+            std::cout << elf.SElfHeaderStr();
+            const auto id = elf.GetProgramIdHeader();
+            std::cout << fmt::format("program type .......: {:#x}\n",
+                                     static_cast<u64>(id.program_type));
+            std::cout << fmt::format("app version ........: {:#018x}\n", id.appver);
+            std::cout << fmt::format("sdk version ........: {:#018x}\n", id.firmver);
+        }
+        std::cout << elf.ElfHeaderStr();
+        for (u16 i = 0; i < elf.GetProgramHeader().size(); i++) {
+            std::cout << elf.ElfPHeaderStr(i);
+        }
+        std::cout << "Decrypted " << reader.GetBlocksRead() * 64 << " KiB of the file\n\n";
+    }
+    return failed > 0 ? 1 : 0;
+}
+
+// Decrypt the trophy sets of a PKG straight from its entry table
+int RunTrophies(const std::filesystem::path& pkgPath, const std::filesystem::path& outDir) {
+    PKG pkg;
+    std::string failReason;
+    if (!pkg.Open(pkgPath, failReason)) {
+        std::cerr << "Failed to open PKG file: " << failReason << "\n";
+        return 1;
+    }
+
+    const auto trophyDir = outDir / std::string(pkg.GetTitleID()) / "TrophyFiles";
+    TRP trp;
+    if (!trp.ExtractFromPkg(pkg, trophyDir)) {
+        std::cerr << "Trophy extraction failed (is --trophy-key set?)\n";
+        return 1;
+    }
+    std::cout << "Trophies extracted to: " << trophyDir << "\n";
+    return 0;
+}
+
+// Print the command line usage
+void PrintUsage() {
+    std::cerr << "Usage: ps4-pkg-tool <path/to/pkg> [path/to/output]\n";
+    std::cerr << "   OR: ps4-pkg-tool --dir <directory/with/pkgs> [path/to/output]\n";
+    std::cerr << "   OR: ps4-pkg-tool --apply <path/to/patch.pkg> <path/to/base/game> [path/to/merged]\n";
+    std::cerr << "   OR: ps4-pkg-tool --diff-extract <path/to/old.pkg> <path/to/new.pkg> <path/to/extracted/old>\n";
+    std::cerr << "   OR: ps4-pkg-tool --catalog <directory/with/pkgs> <path/to/catalog>\n";
+    std::cerr << "   OR: ps4-pkg-tool --games <path/to/install/dir> <path/to/cache>\n";
+    std::cerr << "   OR: ps4-pkg-tool --pack <path/to/game/dir> <path/to/output.pkg> [content-id]\n";
+    std::cerr << "   OR: ps4-pkg-tool --export <path/to/pkg|path/to/game/dir> <path/to/archive>\n";
+    std::cerr << "   OR: ps4-pkg-tool --unarchive <path/to/archive> <path/to/output>\n";
+    std::cerr << "   OR: ps4-pkg-tool --daemon <path/to/socket> [max-jobs]\n";
+    std::cerr << "   OR: ps4-pkg-tool --client <path/to/socket> <command> [args...]\n";
+    std::cerr << "   OR: ps4-pkg-tool --inspect-elf <path/to/pkg> [file/in/pkg...]\n";
+    std::cerr << "   OR: ps4-pkg-tool --trophies <path/to/pkg> <path/to/output> --trophy-key <key>\n";
+    std::cerr << "       If output path is omitted, the PKG will be extracted to its parent directory\n";
+    std::cerr << "\nExtraction options:\n";
+    std::cerr << "   --languages <codes>  Only extract PlayGo chunks for these languages (e.g. en,ja)\n";
+    std::cerr << "   --initial-only       Only extract the initial PlayGo chunks\n";
+    std::cerr << "   --chunks <ids>       Only extract these PlayGo chunk ids (e.g. 0,1,5)\n";
+    std::cerr << "   --progress-fd <fd>   Write progress as JSON lines to this file descriptor\n";
+    std::cerr << "   --metadata-cache <dir>  Reuse the keys and file tree parsed from a PKG on earlier runs\n";
+}
+
 int main(int argc, char** argv) {
+    // Pull extraction options out of the command line, leaving the positional arguments
+    ExtractOptions options;
+    std::vector<std::string> args;
+    for (int i = 0; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--initial-only") {
+            options.playgoFilter = true;
+            options.playgo.initial_only = true;
+        } else if (arg == "--languages" && i + 1 < argc) {
+            options.playgoFilter = true;
+            for (const auto& code : SplitList(argv[++i])) {
+                const auto mask = PlaygoLanguageMaskFromCode(code);
+                if (!mask) {
+                    std::cerr << "Error: Unknown language code: " << code << "\n";
+                    return 1;
+                }
+                options.playgo.language_mask |= *mask;
+            }
+        } else if (arg == "--progress-fd" && i + 1 < argc) {
+            const std::string fd = argv[++i];
+            if (!ParseNumber(fd, options.progressFd) || options.progressFd < 0) {
+                std::cerr << "Error: Invalid file descriptor: " << fd << "\n";
+                PrintUsage();
+                return 1;
+            }
+        } else if (arg == "--trophy-key" && i + 1 < argc) {
+            Config::setTrophyKey(argv[++i]);
+        } else if (arg == "--metadata-cache" && i + 1 < argc) {
+            Config::setPkgMetadataCacheDir(argv[++i]);
+        } else if (arg == "--chunks" && i + 1 < argc) {
+            options.playgoFilter = true;
+            for (const auto& id : SplitList(argv[++i])) {
+                u16 chunkId;
+                if (!ParseNumber(id, chunkId)) {
+                    std::cerr << "Error: Invalid chunk id: " << id << "\n";
+                    PrintUsage();
+                    return 1;
+                }
+                options.playgo.chunk_ids.push_back(chunkId);
+            }
+        } else {
+            args.push_back(arg);
+        }
+    }
+    argc = static_cast<int>(args.size());
+
+    // Catalog mode: index a PKG library without extracting anything
+    if (argc == 4 && args[1] == "--catalog") {
+        return RunCatalog(args[2], args[3]);
+    }
+
+    // Games mode: index extracted games in an install directory
+    if (argc == 4 && args[1] == "--games") {
+        return RunGames(args[2], args[3]);
+    }
+
+    // Apply mode: write a patch over an extracted base game
+    if ((argc == 4 || argc == 5) && args[1] == "--apply") {
+        return RunApply(args[2], args[3], argc == 5 ? args[4] : "", options);
+    }
+
+    // Diff mode: update an extraction of one PKG version to the next
+    if (argc == 5 && args[1] == "--diff-extract") {
+        return RunDiffExtract(args[2], args[3], args[4], options);
+    }
+
+    // Pack mode: build a PKG from an extracted game directory
+    if ((argc == 4 || argc == 5) && args[1] == "--pack") {
+        return RunPack(args[2], args[3], argc == 5 ? args[4] : "");
+    }
+
+    // Archive modes: convert to and from the seekable game archive format
+    if (argc == 4 && args[1] == "--export") {
+        return RunExport(args[2], args[3]);
+    }
+    if (argc == 4 && args[1] == "--unarchive") {
+        return RunUnarchive(args[2], args[3]);
+    }
+
+    // Daemon mode: serve jobs on a Unix socket, and the client that submits them
+    if ((argc == 3 || argc == 4) && args[1] == "--daemon") {
+        u32 maxJobs = 2;
+        if (argc == 4 && (!ParseNumber(args[3], maxJobs) || maxJobs == 0 ||
+                          maxJobs > DAEMON_MAX_JOBS)) {
+            std::cerr << "Error: max-jobs must be between 1 and " << DAEMON_MAX_JOBS << "\n";
+            return 1;
+        }
+        return RunDaemon(args[2], maxJobs);
+    }
+    if (argc >= 4 && args[1] == "--client") {
+        return RunClient(args[2], {args.begin() + 3, args.end()});
+    }
+
+    // Inspect mode: dump executable headers without extracting the PKG
+    if (argc >= 3 && args[1] == "--inspect-elf") {
+        return RunInspectElf(args[2], {args.begin() + 3, args.end()});
+    }
+
+    // Trophy mode: decrypt trophies without extracting the PKG
+    if (argc == 4 && args[1] == "--trophies") {
+        return RunTrophies(args[2], args[3]);
+    }
+
     // Check for directory mode flag
-    if (argc >= 3 && std::string(argv[1]) == "--dir") {
-        std::filesystem::path sourceDir = argv[2];
+    if (argc >= 3 && args[1] == "--dir") {
+        std::filesystem::path sourceDir = args[2];
         std::filesystem::path outputBaseDir;
         
         // Use the source directory as the default output if no output directory is specified
         if (argc == 3) {
             outputBaseDir = sourceDir;
-            std::cout << "No output directory specified. Using source directory: " << outputBaseDir << std::endl;
+            std::cout << "No output directory specified. Using source directory: " << outputBaseDir << '\n';
         } else {
-            outputBaseDir = argv[3];
+            outputBaseDir = args[3];
         }
         
         if (!std::filesystem::exists(sourceDir) || !std::filesystem::is_directory(sourceDir)) {
@@ -158,7 +748,7 @@ int main(int argc, char** argv) {
             std::cout << "\n[" << (i + 1) << "/" << pkgFiles.size() << "] Processing " 
                       << pkgPath.filename() << "...\n";
             
-            if (ProcessPkg(pkgPath, outputBaseDir)) {
+            if (ProcessPkg(pkgPath, outputBaseDir, options)) {
                 std::cout << "Successfully processed " << pkgPath.filename() << "\n";
                 successCount++;
             } else {
@@ -174,24 +764,22 @@ int main(int argc, char** argv) {
     } 
     // Standard single file processing mode
     else if (argc >= 2 && argc <= 3) {
-        std::filesystem::path pkgPath = argv[1];
+        std::filesystem::path pkgPath = args[1];
         std::filesystem::path outDir;
         
         // Use the PKG's parent directory as the default output if no output directory is specified
         if (argc == 2) {
             outDir = pkgPath.parent_path();
-            std::cout << "No output directory specified. Using PKG parent directory: " << outDir << std::endl;
+            std::cout << "No output directory specified. Using PKG parent directory: " << outDir << '\n';
         } else {
-            outDir = argv[2];
+            outDir = args[2];
         }
         
-        return ProcessPkg(pkgPath, outDir) ? 0 : 1;
+        return ProcessPkg(pkgPath, outDir, options) ? 0 : 1;
     }
     // Invalid arguments
     else {
-        std::cerr << "Usage: ps4-pkg-tool <path/to/pkg> [path/to/output]\n";
-        std::cerr << "   OR: ps4-pkg-tool --dir <directory/with/pkgs> [path/to/output]\n";
-        std::cerr << "       If output path is omitted, the PKG will be extracted to its parent directory\n";
+        PrintUsage();
         return 1;
     }
 }
@@ -0,0 +1,185 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <array>
+#include <cstdio>
+#include <fmt/format.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "progress.h"
+
+namespace {
+
+constexpr auto SampleInterval = std::chrono::milliseconds(250);
+constexpr double LogInterval = 5.0; // Seconds between lines when not writing to a terminal.
+
+std::string FormatBytes(double bytes) {
+    static constexpr std::array<const char*, 5> Units = {"B", "KiB", "MiB", "GiB", "TiB"};
+    size_t unit = 0;
+    while (bytes >= 1024.0 && unit + 1 < Units.size()) {
+        bytes /= 1024.0;
+        unit++;
+    }
+    return unit == 0 ? fmt::format("{:.0f} {}", bytes, Units[unit])
+                     : fmt::format("{:.2f} {}", bytes, Units[unit]);
+}
+
+std::string FormatDuration(double seconds) {
+    const u64 total = static_cast<u64>(seconds + 0.5);
+    if (total >= 3600) {
+        return fmt::format("{}:{:02}:{:02}", total / 3600, total / 60 % 60, total % 60);
+    }
+    return fmt::format("{}:{:02}", total / 60, total % 60);
+}
+
+void WriteFd(int fd, std::string_view data) {
+    while (!data.empty()) {
+#ifdef _WIN32
+        const int written = _write(fd, data.data(), static_cast<unsigned>(data.size()));
+#else
+        const ssize_t written = ::write(fd, data.data(), data.size());
+#endif
+        if (written <= 0) {
+            return;
+        }
+        data.remove_prefix(static_cast<size_t>(written));
+    }
+}
+
+} // Anonymous namespace
+
+std::string EscapeJson(std::string_view text) {
+    std::string out;
+    out.reserve(text.size());
+    for (const char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out += fmt::format("\\u{:04x}", static_cast<unsigned char>(c));
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+ProgressReporter::ProgressReporter(std::string label_, const ExtractProgress& progress_,
+                                   u64 bytes_total_, u32 files_total_, int json_fd_)
+    : label{std::move(label_)}, progress{progress_}, bytes_total{bytes_total_},
+      files_total{files_total_}, json_fd{json_fd_},
+#ifdef _WIN32
+      interactive{_isatty(_fileno(stderr)) != 0},
+#else
+      interactive{::isatty(STDERR_FILENO) != 0},
+#endif
+      start{std::chrono::steady_clock::now()} {
+    WriteJson("start", Sample{0, 0, 0.0}, 0);
+    thread = std::jthread([this](std::stop_token stop) { Run(stop); });
+}
+
+ProgressReporter::~ProgressReporter() {
+    if (!finished) {
+        Finish(0);
+    }
+}
+
+void ProgressReporter::Finish(u32 failed) {
+    thread.request_stop();
+    if (thread.joinable()) {
+        thread.join();
+    }
+    finished = true;
+
+    const Sample sample = Take();
+    Render(sample, true);
+    WriteJson("done", sample, failed);
+}
+
+void ProgressReporter::Run(std::stop_token stop) {
+    std::unique_lock lock{mutex};
+    while (true) {
+        // Wakes up early when Finish requests a stop.
+        cv.wait_for(lock, stop, SampleInterval, [] { return false; });
+        if (stop.stop_requested()) {
+            return;
+        }
+        const Sample sample = Take();
+        Render(sample, false);
+        WriteJson("progress", sample, 0);
+    }
+}
+
+ProgressReporter::Sample ProgressReporter::Take() {
+    const Sample sample{
+        .bytes = progress.bytes_written,
+        .files = progress.files_done,
+        .seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(),
+    };
+
+    // Smooth the rate so the ETA does not jump between small and large files.
+    const double elapsed = sample.seconds - last_seconds;
+    if (elapsed > 0.0) {
+        const double current = static_cast<double>(sample.bytes - last_bytes) / elapsed;
+        rate = last_seconds == 0.0 ? current : rate * 0.7 + current * 0.3;
+        last_bytes = sample.bytes;
+        last_seconds = sample.seconds;
+    }
+    return sample;
+}
+
+void ProgressReporter::Render(const Sample& sample, bool final) {
+    if (!interactive && !final && sample.seconds - last_text < LogInterval) {
+        return;
+    }
+    last_text = sample.seconds;
+
+    const double percent =
+        bytes_total == 0 ? 100.0 : 100.0 * static_cast<double>(sample.bytes) / bytes_total;
+    std::string line = fmt::format("{:5.1f}% {} / {}, {} of {} files", percent,
+                                   FormatBytes(static_cast<double>(sample.bytes)),
+                                   FormatBytes(static_cast<double>(bytes_total)), sample.files,
+                                   files_total);
+    if (final) {
+        const double average = sample.seconds > 0.0 ? sample.bytes / sample.seconds : 0.0;
+        line += fmt::format(", {}/s average, took {}", FormatBytes(average),
+                            FormatDuration(sample.seconds));
+    } else if (rate > 0.0) {
+        line += fmt::format(", {}/s, ETA {}", FormatBytes(rate),
+                            FormatDuration((bytes_total - std::min(sample.bytes, bytes_total)) /
+                                           rate));
+    }
+
+    if (interactive) {
+        // Pad over leftovers of a longer previous line.
+        fmt::print(stderr, "\r{:<79}{}", line, final ? "\n" : "");
+    } else {
+        fmt::print(stderr, "{}\n", line);
+    }
+    std::fflush(stderr);
+}
+
+void ProgressReporter::WriteJson(std::string_view event, const Sample& sample, u32 failed) {
+    if (json_fd < 0) {
+        return;
+    }
+    const u64 remaining = bytes_total - std::min(sample.bytes, bytes_total);
+    std::string line = fmt::format(
+        "{{\"event\":\"{}\",\"pkg\":\"{}\",\"bytes_done\":{},\"bytes_total\":{},"
+        "\"files_done\":{},\"files_total\":{},\"elapsed\":{:.3f},\"rate\":{:.0f}",
+        event, EscapeJson(label), sample.bytes, bytes_total, sample.files, files_total,
+        sample.seconds, rate);
+    if (event == "progress" && rate > 0.0) {
+        line += fmt::format(",\"eta\":{:.1f}", remaining / rate);
+    }
+    if (event == "done") {
+        line += fmt::format(",\"failed\":{}", failed);
+    }
+    line += "}\n";
+    WriteFd(json_fd, line);
+}
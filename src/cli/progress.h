@@ -0,0 +1,62 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include "common/types.h"
+#include "core/file_format/pkg.h"
+
+/// Escapes text for use inside a JSON string.
+std::string EscapeJson(std::string_view text);
+
+/**
+ * Samples the byte counters of a running extraction on a background thread and renders progress
+ * with rate and ETA a few times per second. A terminal gets a single updating line, anything else
+ * a line every few seconds. When json_fd is valid, start/progress/done events are also written to
+ * it as JSON lines for scripts and job schedulers.
+ */
+class ProgressReporter {
+public:
+    ProgressReporter(std::string label, const ExtractProgress& progress, u64 bytes_total,
+                     u32 files_total, int json_fd = -1);
+    ~ProgressReporter();
+
+    /// Stops sampling and reports the final state.
+    void Finish(u32 failed);
+
+private:
+    struct Sample {
+        u64 bytes;
+        u32 files;
+        double seconds;
+    };
+
+    void Run(std::stop_token stop);
+    Sample Take();
+    void Render(const Sample& sample, bool final);
+    void WriteJson(std::string_view event, const Sample& sample, u32 failed);
+
+    std::string label;
+    const ExtractProgress& progress;
+    u64 bytes_total;
+    u32 files_total;
+    int json_fd;
+    bool interactive;
+
+    std::chrono::steady_clock::time_point start;
+    double rate = 0.0; // Smoothed bytes per second.
+    u64 last_bytes = 0;
+    double last_seconds = 0.0;
+    double last_text = 0.0;
+    bool finished = false;
+
+    std::mutex mutex;
+    std::condition_variable_any cv;
+    std::jthread thread;
+};
@@ -0,0 +1,97 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <cstring>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "common/types.h"
+
+namespace Common {
+
+/// Serializes trivially copyable values and length prefixed strings for on-disk caches.
+class BinaryWriter {
+public:
+    template <typename T>
+        requires std::is_trivially_copyable_v<T>
+    void Write(const T& value) {
+        Append(&value, sizeof(value));
+    }
+
+    void Write(const std::string& value) {
+        Write(static_cast<u32>(value.size()));
+        Append(value.data(), value.size());
+    }
+
+    template <typename T>
+        requires std::is_trivially_copyable_v<T>
+    void Write(const std::vector<T>& values) {
+        Write(static_cast<u64>(values.size()));
+        Append(values.data(), values.size() * sizeof(T));
+    }
+
+    const std::vector<u8>& Data() const {
+        return data;
+    }
+
+private:
+    void Append(const void* src, size_t size) {
+        const auto* bytes = static_cast<const u8*>(src);
+        data.insert(data.end(), bytes, bytes + size);
+    }
+
+    std::vector<u8> data;
+};
+
+/// Reads back what BinaryWriter wrote, failing instead of reading past the end.
+class BinaryReader {
+public:
+    explicit BinaryReader(std::span<const u8> data_) : data{data_} {}
+
+    template <typename T>
+        requires std::is_trivially_copyable_v<T>
+    bool Read(T& value) {
+        if (pos + sizeof(T) > data.size()) {
+            return false;
+        }
+        std::memcpy(&value, data.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    }
+
+    bool Read(std::string& value) {
+        u32 size = 0;
+        if (!Read(size) || pos + size > data.size()) {
+            return false;
+        }
+        value.assign(reinterpret_cast<const char*>(data.data() + pos), size);
+        pos += size;
+        return true;
+    }
+
+    template <typename T>
+        requires std::is_trivially_copyable_v<T>
+    bool Read(std::vector<T>& values) {
+        u64 count = 0;
+        if (!Read(count) || count > (data.size() - pos) / sizeof(T)) {
+            return false;
+        }
+        values.resize(count);
+        std::memcpy(values.data(), data.data() + pos, count * sizeof(T));
+        pos += count * sizeof(T);
+        return true;
+    }
+
+    size_t Remaining() const {
+        return data.size() - pos;
+    }
+
+private:
+    std::span<const u8> data;
+    size_t pos = 0;
+};
+
+} // namespace Common
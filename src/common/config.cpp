@@ -79,6 +79,7 @@ static bool separateupdatefolder = false;
 static bool compatibilityData = false;
 static bool checkCompatibilityOnStartup = false;
 static std::string trophyKey;
+static std::filesystem::path pkgMetadataCacheDir; // Not saved, set per run.
 
 // Gui
 static bool load_game_size = true;
@@ -150,6 +151,14 @@ void setTrophyKey(std::string key) {
     trophyKey = key;
 }
 
+std::filesystem::path getPkgMetadataCacheDir() {
+    return pkgMetadataCacheDir;
+}
+
+void setPkgMetadataCacheDir(const std::filesystem::path& dir) {
+    pkgMetadataCacheDir = dir;
+}
+
 bool GetLoadGameSizeEnabled() {
     return load_game_size;
 }
@@ -22,6 +22,8 @@ void saveMainWindow(const std::filesystem::path& path);
 
 std::string getTrophyKey();
 void setTrophyKey(std::string key);
+std::filesystem::path getPkgMetadataCacheDir();
+void setPkgMetadataCacheDir(const std::filesystem::path& dir);
 bool GetLoadGameSizeEnabled();
 std::filesystem::path GetSaveDataPath();
 void setLoadGameSizeEnabled(bool enable);
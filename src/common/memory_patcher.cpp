@@ -2,9 +2,11 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 
 #include <algorithm>
+#include <array>
 #include <codecvt>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <pugixml.hpp>
 #ifdef ENABLE_QT_GUI
 #include <QDir>
@@ -19,6 +21,7 @@
 #endif
 #include "common/logging/log.h"
 #include "common/path_util.h"
+#include "common/scope_exit.h"
 #include "memory_patcher.h"
 
 namespace MemoryPatcher {
@@ -29,6 +32,63 @@ std::string g_game_serial;
 std::string patchFile;
 std::vector<patchInfo> pending_patches;
 
+// While a game loads, patches are collected and applied together so that the signatures of all
+// mask patches are found in a single pass over the image.
+struct DeferredPatch {
+    std::string modNameStr;
+    std::string offsetStr;
+    std::string valueStr;
+    std::string targetStr;
+    std::string sizeStr;
+    bool isOffset;
+    bool littleEndian;
+    PatchMask patchMask;
+    int maskOffset;
+};
+
+static bool g_defer_patches = false;
+static std::vector<DeferredPatch> g_deferred_patches;
+static std::unordered_map<std::string, std::pair<CompiledPattern, uintptr_t>> g_scan_results;
+
+static std::span<const u8> EbootImage() {
+    return {reinterpret_cast<const u8*>(g_eboot_address), g_eboot_image_size};
+}
+
+static void FlushDeferredPatches() {
+    g_defer_patches = false;
+    const auto patches = std::move(g_deferred_patches);
+    g_deferred_patches.clear();
+
+    std::vector<std::string> signatures;
+    for (const auto& patch : patches) {
+        if (patch.patchMask != PatchMask::None) {
+            signatures.push_back(patch.offsetStr);
+        }
+        if (patch.patchMask == PatchMask::Mask_Jump32) {
+            signatures.push_back(patch.targetStr);
+        }
+    }
+    std::ranges::sort(signatures);
+    signatures.erase(std::unique(signatures.begin(), signatures.end()), signatures.end());
+
+    std::vector<CompiledPattern> patterns;
+    patterns.reserve(signatures.size());
+    for (const auto& signature : signatures) {
+        patterns.push_back(CompilePattern(signature));
+    }
+    const auto addresses = PatternScanBatch(patterns, EbootImage());
+    for (size_t i = 0; i < signatures.size(); i++) {
+        g_scan_results.emplace(signatures[i], std::make_pair(std::move(patterns[i]), addresses[i]));
+    }
+
+    for (const auto& patch : patches) {
+        PatchMemory(patch.modNameStr, patch.offsetStr, patch.valueStr, patch.targetStr,
+                    patch.sizeStr, patch.isOffset, patch.littleEndian, patch.patchMask,
+                    patch.maskOffset);
+    }
+    g_scan_results.clear();
+}
+
 std::string toHex(u64 value, size_t byteSize) {
     std::stringstream ss;
     ss << std::hex << std::setfill('0') << std::setw(byteSize * 2) << value;
@@ -118,6 +178,10 @@ std::string convertValueToHex(const std::string type, const std::string valueStr
 }
 
 void OnGameLoaded() {
+    g_defer_patches = true;
+    SCOPE_EXIT {
+        FlushDeferredPatches();
+    };
 
     if (!patchFile.empty()) {
         std::filesystem::path patchDir = Common::FS::GetUserPath(Common::FS::PathType::PatchesDir);
@@ -369,6 +433,12 @@ void ApplyPendingPatches() {
 void PatchMemory(std::string modNameStr, std::string offsetStr, std::string valueStr,
                  std::string targetStr, std::string sizeStr, bool isOffset, bool littleEndian,
                  PatchMask patchMask, int maskOffset) {
+    if (g_defer_patches) {
+        g_deferred_patches.push_back({modNameStr, offsetStr, valueStr, targetStr, sizeStr, isOffset,
+                                      littleEndian, patchMask, maskOffset});
+        return;
+    }
+
     // Send a request to modify the process memory.
     void* cheatAddress = nullptr;
 
@@ -487,48 +557,130 @@ void PatchMemory(std::string modNameStr, std::string offsetStr, std::string valu
              (uintptr_t)cheatAddress, valueStr);
 }
 
-static std::vector<int32_t> PatternToByte(const std::string& pattern) {
-    std::vector<int32_t> bytes;
-    const char* start = pattern.data();
-    const char* end = start + pattern.size();
+bool CompiledPattern::Matches(const u8* data) const {
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        if ((data[i] & mask[i]) != bytes[i]) {
+            return false;
+        }
+    }
+    return true;
+}
 
-    for (const char* current = start; current < end; ++current) {
-        if (*current == '?') {
+CompiledPattern CompilePattern(std::string_view signature) {
+    CompiledPattern pattern;
+    const char* current = signature.data();
+    const char* end = current + signature.size();
+    while (current < end) {
+        if (*current == ' ') {
+            ++current;
+        } else if (*current == '?') {
             ++current;
-            if (*current == '?')
+            if (current < end && *current == '?') {
                 ++current;
-            bytes.push_back(-1);
+            }
+            pattern.bytes.push_back(0);
+            pattern.mask.push_back(0);
         } else {
-            bytes.push_back(strtoul(current, const_cast<char**>(&current), 16));
+            char* next;
+            pattern.bytes.push_back(static_cast<u8>(std::strtoul(current, &next, 16)));
+            pattern.mask.push_back(0xFF);
+            current = next == current ? current + 1 : next;
         }
     }
 
-    return bytes;
+    // Anchor on a fixed byte that is uncommon in x86-64 code to keep candidates rare.
+    static constexpr std::array<u8, 12> CommonBytes = {0x00, 0xFF, 0x48, 0x89, 0x8B, 0x0F,
+                                                       0xE8, 0x24, 0x44, 0x4C, 0xCC, 0x90};
+    for (size_t i = 0; i < pattern.bytes.size(); ++i) {
+        if (pattern.mask[i] == 0) {
+            continue;
+        }
+        const bool common = std::ranges::find(CommonBytes, pattern.bytes[i]) != CommonBytes.end();
+        if (!pattern.has_fixed_bytes || !common) {
+            pattern.anchor = i;
+            pattern.has_fixed_bytes = true;
+        }
+        if (!common) {
+            break;
+        }
+    }
+    return pattern;
 }
 
-uintptr_t PatternScan(const std::string& signature) {
-    std::vector<int32_t> patternBytes = PatternToByte(signature);
-    const auto scanBytes = static_cast<uint8_t*>((void*)g_eboot_address);
-
-    const int32_t* sigPtr = patternBytes.data();
-    const size_t sigSize = patternBytes.size();
-
-    uint32_t foundResults = 0;
-    for (uint32_t i = 0; i < g_eboot_image_size - sigSize; ++i) {
-        bool found = true;
-        for (uint32_t j = 0; j < sigSize; ++j) {
-            if (scanBytes[i + j] != sigPtr[j] && sigPtr[j] != -1) {
-                found = false;
-                break;
+std::vector<uintptr_t> PatternScanBatch(std::span<const CompiledPattern> patterns,
+                                        std::span<const u8> image) {
+    std::vector<uintptr_t> results(patterns.size(), 0);
+
+    // Patterns waiting for a match, indexed by their anchor byte.
+    std::array<std::vector<size_t>, 256> candidates;
+    size_t remaining = 0;
+    for (size_t i = 0; i < patterns.size(); ++i) {
+        const auto& pattern = patterns[i];
+        if (pattern.bytes.empty() || pattern.bytes.size() > image.size()) {
+            continue;
+        }
+        if (!pattern.has_fixed_bytes) {
+            results[i] = reinterpret_cast<uintptr_t>(image.data());
+            continue;
+        }
+        candidates[pattern.bytes[pattern.anchor]].push_back(i);
+        remaining++;
+    }
+
+    // Positions are visited in order, so the first hit of each pattern is its first match.
+    for (size_t pos = 0; pos < image.size() && remaining != 0; ++pos) {
+        auto& list = candidates[image[pos]];
+        for (size_t k = 0; k < list.size();) {
+            const auto& pattern = patterns[list[k]];
+            const size_t start = pos - pattern.anchor;
+            if (pos >= pattern.anchor && start + pattern.bytes.size() <= image.size() &&
+                pattern.Matches(&image[start])) {
+                results[list[k]] = reinterpret_cast<uintptr_t>(&image[start]);
+                list[k] = list.back();
+                list.pop_back();
+                remaining--;
+                continue;
             }
+            ++k;
         }
+    }
+    return results;
+}
 
-        if (found) {
-            foundResults++;
-            return reinterpret_cast<uintptr_t>(&scanBytes[i]);
+uintptr_t PatternScan(const std::string& signature) {
+    const auto image = EbootImage();
+
+    // Signatures found by a batch scan are looked up, as long as earlier patches left them intact.
+    // Misses are scanned again, an earlier patch in the same flush may have written the bytes.
+    if (const auto it = g_scan_results.find(signature); it != g_scan_results.end()) {
+        const auto& [pattern, address] = it->second;
+        if (address != 0 && pattern.Matches(reinterpret_cast<const u8*>(address))) {
+            return address;
         }
     }
 
+    // Find candidates with memchr, which the C library vectorizes, then verify them.
+    const auto pattern = CompilePattern(signature);
+    if (pattern.bytes.empty() || pattern.bytes.size() > image.size()) {
+        return 0;
+    }
+    if (!pattern.has_fixed_bytes) {
+        return reinterpret_cast<uintptr_t>(image.data());
+    }
+    const u8 anchor_byte = pattern.bytes[pattern.anchor];
+    const size_t last = image.size() - pattern.bytes.size() + pattern.anchor;
+    for (size_t pos = pattern.anchor; pos <= last;) {
+        const auto* hit =
+            static_cast<const u8*>(std::memchr(&image[pos], anchor_byte, last - pos + 1));
+        if (!hit) {
+            break;
+        }
+        const auto* start = hit - pattern.anchor;
+        if (pattern.Matches(start)) {
+            return reinterpret_cast<uintptr_t>(start);
+        }
+        pos = static_cast<size_t>(hit - image.data()) + 1;
+    }
     return 0;
 }
 
@@ -3,8 +3,11 @@
 
 #pragma once
 #include <cstring>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
+#include "common/types.h"
 
 namespace MemoryPatcher {
 
@@ -42,7 +45,22 @@ void PatchMemory(std::string modNameStr, std::string offsetStr, std::string valu
                  std::string targetStr, std::string sizeStr, bool isOffset, bool littleEndian,
                  PatchMask patchMask = PatchMask::None, int maskOffset = 0);
 
-static std::vector<int32_t> PatternToByte(const std::string& pattern);
+/// A wildcard signature such as "48 8B ?? 05", parsed once for repeated scanning.
+struct CompiledPattern {
+    std::vector<u8> bytes;
+    std::vector<u8> mask; // 0xFF where the byte must match, 0 for wildcards.
+    size_t anchor = 0;    // Fixed byte searched for to find candidate positions.
+    bool has_fixed_bytes = false;
+
+    bool Matches(const u8* data) const;
+};
+
+CompiledPattern CompilePattern(std::string_view signature);
+
+/// Returns the address of the first match of every pattern in image, or 0, in a single pass.
+std::vector<uintptr_t> PatternScanBatch(std::span<const CompiledPattern> patterns,
+                                        std::span<const u8> image);
+
 uintptr_t PatternScan(const std::string& signature);
 
 } // namespace MemoryPatcher
\ No newline at end of file
@@ -0,0 +1,60 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "common/types.h"
+
+namespace Common {
+
+/// Returns how many threads ParallelFor uses for count items when asked for num_threads, where 0
+/// means one per hardware thread.
+inline u32 ParallelThreadCount(size_t count, u32 num_threads) {
+    if (num_threads == 0) {
+        num_threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    return static_cast<u32>(std::min<u64>(num_threads, count));
+}
+
+/**
+ * Runs body(state, 0) ... body(state, count - 1) on up to num_threads threads, the calling thread
+ * included. Items are handed out one at a time, so uneven items still balance. Each thread first
+ * calls make_state(worker) with its index below ParallelThreadCount() and keeps the result, a
+ * value or a reference, for all the items it runs.
+ *
+ * Bodies run on std::jthread workers, where an escaping exception terminates the process. They
+ * report failures through what they capture and use the std::error_code overloads of
+ * std::filesystem. To abandon the run, set a flag and return early from the remaining items.
+ */
+template <typename MakeState, typename Body>
+void ParallelFor(size_t count, u32 num_threads, MakeState&& make_state, Body&& body) {
+    if (count == 0) {
+        return;
+    }
+    num_threads = ParallelThreadCount(count, num_threads);
+    std::atomic<size_t> next{0};
+    const auto worker = [&](u32 worker_index) {
+        decltype(auto) state = make_state(worker_index);
+        for (size_t n = next++; n < count; n = next++) {
+            body(state, n);
+        }
+    };
+    std::vector<std::jthread> workers;
+    for (u32 t = 1; t < num_threads; t++) {
+        workers.emplace_back(worker, t);
+    }
+    worker(0);
+}
+
+/// Runs body(0) ... body(count - 1) on up to num_threads threads, see above.
+template <typename Body>
+void ParallelFor(size_t count, u32 num_threads, Body&& body) {
+    ParallelFor(
+        count, num_threads, [](u32) { return 0; }, [&](int, size_t n) { body(n); });
+}
+
+} // namespace Common
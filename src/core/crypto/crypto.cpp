@@ -92,6 +92,17 @@ void Crypto::RSA2048Decrypt(std::span<CryptoPP::byte, 32> dec_key,
     std::copy(decrypted.begin(), decrypted.begin() + dec_key.size(), dec_key.begin());
 }
 
+void Crypto::RSA2048Encrypt(std::span<CryptoPP::byte, 256> ciphertext,
+                            std::span<const CryptoPP::byte, 32> key, bool is_dk3) {
+    // The public half of the same keysets RSA2048Decrypt uses.
+    const CryptoPP::RSA::PrivateKey privateKey =
+        is_dk3 ? key_pkg_derived_key3_keyset_init() : FakeKeyset_keyset_init();
+    CryptoPP::RSAES_PKCS1v15_Encryptor rsaEncryptor(privateKey);
+
+    CryptoPP::AutoSeededRandomPool rng;
+    rsaEncryptor.Encrypt(rng, key.data(), key.size(), ciphertext.data());
+}
+
 void Crypto::ivKeyHASH256(std::span<const CryptoPP::byte, 64> cipher_input,
                           std::span<CryptoPP::byte, 32> ivkey_result) {
     CryptoPP::SHA256 sha256;
@@ -138,9 +149,28 @@ void Crypto::aesCbcCfb128DecryptEntry(std::span<const CryptoPP::byte, 32> ivkey,
     }
 }
 
-void Crypto::decryptEFSM(std::span<CryptoPP::byte, 16> trophyKey,
-                         std::span<CryptoPP::byte, 16> NPcommID,
-                         std::span<CryptoPP::byte, 16> efsmIv, std::span<CryptoPP::byte> ciphertext,
+void Crypto::aesCbcCfb128EncryptEntry(std::span<const CryptoPP::byte, 32> ivkey,
+                                      std::span<const CryptoPP::byte> plaintext,
+                                      std::span<CryptoPP::byte> encrypted) {
+    std::array<CryptoPP::byte, CryptoPP::AES::DEFAULT_KEYLENGTH> key;
+    std::array<CryptoPP::byte, CryptoPP::AES::DEFAULT_KEYLENGTH> iv;
+
+    std::copy(ivkey.begin() + 16, ivkey.begin() + 16 + key.size(), key.begin());
+    std::copy(ivkey.begin(), ivkey.begin() + iv.size(), iv.begin());
+
+    CryptoPP::AES::Encryption aesEncryption(key.data(), CryptoPP::AES::DEFAULT_KEYLENGTH);
+    CryptoPP::CBC_Mode_ExternalCipher::Encryption cbcEncryption(aesEncryption, iv.data());
+
+    for (size_t i = 0; i < encrypted.size(); i += CryptoPP::AES::BLOCKSIZE) {
+        cbcEncryption.ProcessData(encrypted.data() + i, plaintext.data() + i,
+                                  CryptoPP::AES::BLOCKSIZE);
+    }
+}
+
+void Crypto::decryptEFSM(std::span<const CryptoPP::byte, 16> trophyKey,
+                         std::span<const CryptoPP::byte, 16> NPcommID,
+                         std::span<const CryptoPP::byte, 16> efsmIv,
+                         std::span<const CryptoPP::byte> ciphertext,
                          std::span<CryptoPP::byte> decrypted) {
 
     // step 1: Encrypt NPcommID
@@ -156,9 +186,9 @@ void Crypto::decryptEFSM(std::span<CryptoPP::byte, 16> trophyKey,
     CryptoPP::CBC_Mode<CryptoPP::AES>::Decryption decrypt;
     decrypt.SetKeyWithIV(trpKey.data(), trpKey.size(), efsmIv.data());
 
-    for (size_t i = 0; i < decrypted.size(); i += CryptoPP::AES::BLOCKSIZE) {
-        decrypt.ProcessData(decrypted.data() + i, ciphertext.data() + i, CryptoPP::AES::BLOCKSIZE);
-    }
+    // Decrypt the whole payload in one call, any trailing partial block is left untouched.
+    const size_t size = decrypted.size() & ~(size_t{CryptoPP::AES::BLOCKSIZE} - 1);
+    decrypt.ProcessData(decrypted.data(), ciphertext.data(), size);
 }
 
 void Crypto::PfsGenCryptoKey(std::span<const CryptoPP::byte, 32> ekpfs,
@@ -213,3 +243,34 @@ void Crypto::decryptPFS(std::span<const CryptoPP::byte, 16> dataKey,
         }
     }
 }
+
+void Crypto::encryptPFS(std::span<const CryptoPP::byte, 16> dataKey,
+                        std::span<const CryptoPP::byte, 16> tweakKey, std::span<const u8> src_image,
+                        std::span<CryptoPP::byte> dst_image, u64 sector) {
+    CryptoPP::ECB_Mode<CryptoPP::AES>::Encryption encryptTweak(tweakKey.data(), tweakKey.size());
+    CryptoPP::ECB_Mode<CryptoPP::AES>::Encryption encrypt(dataKey.data(), dataKey.size());
+
+    // The tweaks of a sector are computed up front, so each sector goes through AES in one call
+    // instead of one call per 16 byte block. src_image and dst_image may be the same buffer.
+    std::array<CryptoPP::byte, 0x1000> tweaks;
+    std::array<CryptoPP::byte, 0x1000> buffer;
+    for (size_t i = 0; i < src_image.size(); i += 0x1000) {
+        const u64 current_sector = sector + (i / 0x1000);
+        std::array<CryptoPP::byte, 16> tweak{};
+        std::array<CryptoPP::byte, 16> encryptedTweak;
+        std::memcpy(tweak.data(), &current_sector, sizeof(u64));
+        encryptTweak.ProcessData(encryptedTweak.data(), tweak.data(), 16);
+        for (size_t j = 0; j < tweaks.size(); j += 16) {
+            std::memcpy(tweaks.data() + j, encryptedTweak.data(), 16);
+            xtsMult(encryptedTweak);
+        }
+
+        for (size_t j = 0; j < buffer.size(); j++) {
+            buffer[j] = src_image[i + j] ^ tweaks[j];
+        }
+        encrypt.ProcessData(buffer.data(), buffer.data(), buffer.size());
+        for (size_t j = 0; j < buffer.size(); j++) {
+            dst_image[i + j] = buffer[j] ^ tweaks[j];
+        }
+    }
+}
@@ -24,6 +24,8 @@ public:
     void RSA2048Decrypt(std::span<CryptoPP::byte, 32> dk3,
                         std::span<const CryptoPP::byte, 256> ciphertext,
                         bool is_dk3); // RSAES_PKCS1v15_
+    void RSA2048Encrypt(std::span<CryptoPP::byte, 256> ciphertext,
+                        std::span<const CryptoPP::byte, 32> key, bool is_dk3);
     void ivKeyHASH256(std::span<const CryptoPP::byte, 64> cipher_input,
                       std::span<CryptoPP::byte, 32> ivkey_result);
     void aesCbcCfb128Decrypt(std::span<const CryptoPP::byte, 32> ivkey,
@@ -32,9 +34,14 @@ public:
     void aesCbcCfb128DecryptEntry(std::span<const CryptoPP::byte, 32> ivkey,
                                   std::span<CryptoPP::byte> ciphertext,
                                   std::span<CryptoPP::byte> decrypted);
-    void decryptEFSM(std::span<CryptoPP::byte, 16> trophyKey,
-                     std::span<CryptoPP::byte, 16> NPcommID, std::span<CryptoPP::byte, 16> efsmIv,
-                     std::span<CryptoPP::byte> ciphertext, std::span<CryptoPP::byte> decrypted);
+    void aesCbcCfb128EncryptEntry(std::span<const CryptoPP::byte, 32> ivkey,
+                                  std::span<const CryptoPP::byte> plaintext,
+                                  std::span<CryptoPP::byte> encrypted);
+    void decryptEFSM(std::span<const CryptoPP::byte, 16> trophyKey,
+                     std::span<const CryptoPP::byte, 16> NPcommID,
+                     std::span<const CryptoPP::byte, 16> efsmIv,
+                     std::span<const CryptoPP::byte> ciphertext,
+                     std::span<CryptoPP::byte> decrypted);
     void PfsGenCryptoKey(std::span<const CryptoPP::byte, 32> ekpfs,
                          std::span<const CryptoPP::byte, 16> seed,
                          std::span<CryptoPP::byte, 16> dataKey,
@@ -42,6 +49,9 @@ public:
     void decryptPFS(std::span<const CryptoPP::byte, 16> dataKey,
                     std::span<const CryptoPP::byte, 16> tweakKey, std::span<const u8> src_image,
                     std::span<CryptoPP::byte> dst_image, u64 sector);
+    void encryptPFS(std::span<const CryptoPP::byte, 16> dataKey,
+                    std::span<const CryptoPP::byte, 16> tweakKey, std::span<const u8> src_image,
+                    std::span<CryptoPP::byte> dst_image, u64 sector);
 
     void xtsXorBlock(CryptoPP::byte* x, const CryptoPP::byte* a, const CryptoPP::byte* b) {
         for (int i = 0; i < 16; i++) {
@@ -0,0 +1,522 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <unordered_set>
+#include "common/binary_stream.h"
+#include "common/logging/log.h"
+#include "common/parallel_for.h"
+#include "common/path_util.h"
+#include "core/file_format/game_archive.h"
+#include "core/file_format/pfsc.h"
+#include "core/file_format/pkg.h"
+#include "core/file_format/pkg_type.h"
+
+namespace {
+
+constexpr u64 BlockSize = PFSC_BLOCK_SIZE;
+constexpr u64 WindowBlocks = 512; // Blocks encoded per pass before they are written in order.
+constexpr u64 MinIndexEntrySize = 25; // Empty path length, size, first block, count and flag.
+
+struct ExportItem {
+    GameArchiveEntry entry;
+    std::filesystem::path source; // File on disk.
+    int pkg_index = -1;           // File inside the PFS image of the PKG.
+    std::vector<u8> data;         // sce_sys entry read from the PKG entry table.
+};
+
+std::filesystem::path PathFromUTF8(std::string_view path) {
+    return std::u8string_view(reinterpret_cast<const char8_t*>(path.data()), path.size());
+}
+
+/// Entry paths come from the archive, they must stay below the directory they are extracted to.
+bool IsSafeEntryPath(std::string_view path) {
+    if (path.empty() || path.front() == '/' || path.find('\\') != std::string_view::npos ||
+        path.find(':') != std::string_view::npos) {
+        return false;
+    }
+    for (size_t begin = 0; begin <= path.size();) {
+        const size_t end = std::min(path.find('/', begin), path.size());
+        const auto part = path.substr(begin, end - begin);
+        if (part.empty() || part == "." || part == "..") {
+            return false;
+        }
+        begin = end + 1;
+    }
+    return true;
+}
+
+u32 ResolveThreads(u32 num_threads) {
+    return num_threads != 0 ? num_threads : std::max(1U, std::thread::hardware_concurrency());
+}
+
+/// Gathers the files of a directory or PKG and writes them as a game archive. Blocks are encoded
+/// by worker threads one window at a time and appended in order by the calling thread.
+class GameArchiveWriter {
+public:
+    explicit GameArchiveWriter(PKG* pkg_ = nullptr) : pkg{pkg_} {}
+
+    bool AddDirectory(const std::filesystem::path& source_dir, std::string& failreason);
+    bool AddPkg(std::string& failreason);
+    bool Write(const std::filesystem::path& archive_path, u32 num_threads,
+               std::string& failreason, GameArchiveStats* stats);
+
+private:
+    struct Worker {
+        PfscCompressor compressor;
+        std::vector<u8> buffer = std::vector<u8>(BlockSize);
+        size_t open_item = ~size_t{0};
+        Common::FS::IOFile file;
+        std::optional<PfscBlockReader> pkg_reader;
+        PfscBlock pkg_block;
+    };
+
+    struct EncodedBlock {
+        std::vector<u8> data;
+        u32 flags = 0;
+        bool reused = false;
+    };
+
+    bool EncodeBlock(Worker& worker, size_t item_index, u64 block, EncodedBlock& out);
+
+    PKG* pkg;
+    std::vector<ExportItem> items;
+};
+
+bool GameArchiveWriter::AddDirectory(const std::filesystem::path& source_dir,
+                                     std::string& failreason) {
+    std::error_code ec;
+    for (auto it = std::filesystem::recursive_directory_iterator(source_dir, ec);
+         !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+        const bool is_dir = it->is_directory(ec);
+        if (!is_dir && !it->is_regular_file(ec)) {
+            continue;
+        }
+        const auto relative = it->path().lexically_relative(source_dir);
+        items.push_back({
+            .entry = {.path = Common::FS::PathToUTF8String(relative.generic_u8string()),
+                      .size = is_dir ? 0 : it->file_size(ec),
+                      .is_dir = is_dir},
+            .source = is_dir ? std::filesystem::path{} : it->path(),
+        });
+    }
+    if (ec) {
+        failreason = fmt::format("Failed to list {}: {}", Common::FS::PathToUTF8String(source_dir),
+                                 ec.message());
+        return false;
+    }
+    std::ranges::sort(items, {}, [](const ExportItem& item) { return item.entry.path; });
+    return true;
+}
+
+bool GameArchiveWriter::AddPkg(std::string& failreason) {
+    std::unordered_set<std::string> paths;
+    for (int i = 0; i < static_cast<int>(pkg->GetNumberOfFiles()); i++) {
+        if (pkg->IsDirectory(i)) {
+            items.push_back({.entry = {.path = pkg->GetRelativePath(i), .is_dir = true}});
+        } else if (pkg->IsFile(i)) {
+            items.push_back({
+                .entry = {.path = pkg->GetRelativePath(i), .size = pkg->GetFileSize(i)},
+                .pkg_index = i,
+            });
+        } else {
+            continue;
+        }
+        paths.insert(items.back().entry.path);
+    }
+
+    // Entry table files, Extract writes them to sce_sys before the image overwrites any of them.
+    // Like there, entries without a known name are stored under their id.
+    for (const PKGEntry& pkg_entry : pkg->GetEntries()) {
+        if (pkg_entry.id < 0x400) {
+            continue;
+        }
+        const auto name = GetEntryNameByType(pkg_entry.id);
+        auto path = name.empty() ? fmt::format("sce_sys/{}", u32{pkg_entry.id})
+                                 : fmt::format("sce_sys/{}", name);
+        if (paths.contains(path)) {
+            continue;
+        }
+        std::vector<u8> data;
+        if (!pkg->ReadEntry(pkg_entry.id, data, failreason)) {
+            return false;
+        }
+        items.push_back({.entry = {.path = std::move(path), .size = data.size()},
+                         .data = std::move(data)});
+    }
+    return true;
+}
+
+bool GameArchiveWriter::EncodeBlock(Worker& worker, size_t item_index, u64 block,
+                                    EncodedBlock& out) {
+    const ExportItem& item = items[item_index];
+    const u64 offset = block * BlockSize;
+    const u64 size = std::min(BlockSize, item.entry.size - offset);
+    out.reused = false;
+
+    if (item.pkg_index >= 0) {
+        if (!worker.pkg_reader) {
+            worker.pkg_reader.emplace(*pkg);
+        }
+        auto& stored = worker.pkg_block;
+        if (!worker.pkg_reader->Read(item.pkg_index, block, stored) || stored.size != size) {
+            LOG_ERROR(Loader, "Invalid PFSC block {} of {}", block, item.entry.path);
+            return false;
+        }
+        // Compressed blocks keep the zlib stream of the PKG, deflate already failed to shrink
+        // the others when the PKG was built.
+        out.data.swap(stored.data);
+        out.flags = stored.compressed ? GAME_ARCHIVE_BLOCK_COMPRESSED : 0;
+        out.reused = stored.compressed;
+        return true;
+    }
+
+    if (!item.source.empty()) {
+        if (worker.open_item != item_index) {
+            worker.file.Open(item.source, Common::FS::FileAccessMode::Read);
+            worker.open_item = item_index;
+        }
+        if (!worker.file.IsOpen() || !worker.file.Seek(static_cast<s64>(offset)) ||
+            worker.file.ReadRaw<u8>(worker.buffer.data(), size) != size) {
+            LOG_ERROR(Loader, "Failed to read {}", Common::FS::PathToUTF8String(item.source));
+            return false;
+        }
+    } else {
+        std::memcpy(worker.buffer.data(), item.data.data() + offset, size);
+    }
+
+    const bool compressed = worker.compressor.Compress({worker.buffer.data(), size}, out.data);
+    out.flags = compressed ? GAME_ARCHIVE_BLOCK_COMPRESSED : 0;
+    return true;
+}
+
+bool GameArchiveWriter::Write(const std::filesystem::path& archive_path, u32 num_threads,
+                              std::string& failreason, GameArchiveStats* stats) {
+    std::ranges::stable_sort(items, {}, [](const ExportItem& item) { return item.entry.is_dir; });
+
+    // Blocks follow the order the files were added in, for a PKG that is the image order.
+    std::vector<size_t> file_items;
+    u64 num_blocks = 0;
+    for (size_t i = 0; i < items.size(); i++) {
+        auto& entry = items[i].entry;
+        if (entry.is_dir || entry.size == 0) {
+            continue;
+        }
+        entry.first_block = num_blocks;
+        entry.num_blocks = static_cast<u32>((entry.size + BlockSize - 1) / BlockSize);
+        num_blocks += entry.num_blocks;
+        file_items.push_back(i);
+    }
+
+    auto temp_path = archive_path;
+    temp_path += ".tmp";
+    Common::FS::IOFile out(temp_path, Common::FS::FileAccessMode::Write);
+    if (!out.IsOpen()) {
+        failreason = "Failed to create the archive";
+        return false;
+    }
+    const auto fail = [&](std::string reason) {
+        failreason = std::move(reason);
+        out.Close();
+        std::error_code ec;
+        std::filesystem::remove(temp_path, ec);
+        return false;
+    };
+
+    num_threads = ResolveThreads(num_threads);
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (u32 i = 0; i < num_threads; i++) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+
+    std::vector<GameArchiveBlock> table(num_blocks);
+    std::vector<EncodedBlock> encoded(std::min(WindowBlocks, num_blocks));
+    u64 position = sizeof(GameArchiveHeader);
+    u64 compressed_blocks = 0;
+    u64 reused_blocks = 0;
+    if (!out.Seek(static_cast<s64>(position))) {
+        return fail("Failed to write the archive");
+    }
+
+    for (u64 first = 0; first < num_blocks; first += WindowBlocks) {
+        const u64 count = std::min(WindowBlocks, num_blocks - first);
+        std::atomic<bool> failed{false};
+        Common::ParallelFor(
+            count, num_threads, [&](u32 t) -> Worker& { return *workers[t]; },
+            [&](Worker& state, size_t i) {
+                if (failed) {
+                    return;
+                }
+                const u64 block = first + i;
+                const auto it = std::ranges::upper_bound(
+                    file_items, block, {}, [&](size_t n) { return items[n].entry.first_block; });
+                const size_t item = *(it - 1);
+                if (!EncodeBlock(state, item, block - items[item].entry.first_block, encoded[i])) {
+                    failed = true;
+                }
+            });
+        if (failed) {
+            return fail("Failed to read the source files");
+        }
+
+        for (u64 i = 0; i < count; i++) {
+            const auto& block = encoded[i];
+            table[first + i] = {
+                .offset = position,
+                .size = static_cast<u32>(block.data.size()),
+                .flags = block.flags,
+            };
+            if (out.WriteSpan(std::span<const u8>(block.data)) != block.data.size()) {
+                return fail("Failed to write the archive");
+            }
+            position += block.data.size();
+            compressed_blocks += (block.flags & GAME_ARCHIVE_BLOCK_COMPRESSED) != 0;
+            reused_blocks += block.reused;
+        }
+    }
+
+    std::ranges::sort(items, {}, [](const ExportItem& item) { return item.entry.path; });
+    Common::BinaryWriter index;
+    for (const auto& item : items) {
+        index.Write(item.entry.path);
+        index.Write(item.entry.size);
+        index.Write(item.entry.first_block);
+        index.Write(item.entry.num_blocks);
+        index.Write(static_cast<u8>(item.entry.is_dir));
+    }
+
+    const GameArchiveHeader header{
+        .magic = GAME_ARCHIVE_MAGIC,
+        .version = GAME_ARCHIVE_VERSION,
+        .block_size = static_cast<u32>(BlockSize),
+        .num_entries = static_cast<u32>(items.size()),
+        .num_blocks = num_blocks,
+        .block_table_offset = position,
+        .index_offset = position + table.size() * sizeof(GameArchiveBlock),
+        .index_size = index.Data().size(),
+    };
+    if (out.Write(table) != table.size() || out.Write(index.Data()) != index.Data().size() ||
+        !out.Seek(0) || !out.WriteObject(header)) {
+        return fail("Failed to write the archive index");
+    }
+    out.Close();
+
+    std::error_code ec;
+    std::filesystem::rename(temp_path, archive_path, ec);
+    if (ec) {
+        return fail(fmt::format("Failed to replace the archive: {}", ec.message()));
+    }
+
+    if (stats) {
+        for (const auto& item : items) {
+            if (item.entry.is_dir) {
+                stats->num_dirs++;
+            } else {
+                stats->num_files++;
+                stats->input_bytes += item.entry.size;
+            }
+        }
+        stats->num_blocks = num_blocks;
+        stats->compressed_blocks = compressed_blocks;
+        stats->reused_blocks = reused_blocks;
+        stats->archive_size = header.index_offset + header.index_size;
+    }
+    return true;
+}
+
+} // Anonymous namespace
+
+bool ExportGameArchive(const std::filesystem::path& source_dir,
+                       const std::filesystem::path& archive_path, std::string& failreason,
+                       GameArchiveStats* stats, u32 num_threads) {
+    GameArchiveWriter writer;
+    return writer.AddDirectory(source_dir, failreason) &&
+           writer.Write(archive_path, num_threads, failreason, stats);
+}
+
+bool ExportGameArchive(PKG& pkg, const std::filesystem::path& archive_path,
+                       std::string& failreason, GameArchiveStats* stats, u32 num_threads) {
+    GameArchiveWriter writer{&pkg};
+    return writer.AddPkg(failreason) && writer.Write(archive_path, num_threads, failreason, stats);
+}
+
+bool GameArchive::Open(const std::filesystem::path& archive_path, std::string& failreason) {
+    path = archive_path;
+    entries.clear();
+    blocks.clear();
+
+    Common::FS::IOFile file(archive_path, Common::FS::FileAccessMode::Read);
+    GameArchiveHeader header{};
+    if (!file.IsOpen() || !file.ReadObject(header)) {
+        failreason = "Failed to read the archive header";
+        return false;
+    }
+    if (header.magic != GAME_ARCHIVE_MAGIC || header.version != GAME_ARCHIVE_VERSION ||
+        header.block_size != BlockSize) {
+        failreason = "Not a supported game archive";
+        return false;
+    }
+
+    // Checked by subtraction, so crafted offsets and sizes cannot wrap around.
+    const u64 file_size = file.GetSize();
+    const u64 table_size = header.num_blocks * sizeof(GameArchiveBlock);
+    if (header.num_blocks > file_size / sizeof(GameArchiveBlock) ||
+        header.block_table_offset > file_size ||
+        table_size > file_size - header.block_table_offset || header.index_offset > file_size ||
+        header.index_size > file_size - header.index_offset) {
+        failreason = "Truncated game archive";
+        return false;
+    }
+    if (header.num_entries > header.index_size / MinIndexEntrySize) {
+        failreason = "Corrupted archive index";
+        return false;
+    }
+
+    blocks.resize(header.num_blocks);
+    std::vector<u8> index(header.index_size);
+    if (!file.Seek(static_cast<s64>(header.block_table_offset)) ||
+        file.Read(blocks) != blocks.size() || !file.Seek(static_cast<s64>(header.index_offset)) ||
+        file.Read(index) != index.size()) {
+        failreason = "Failed to read the archive index";
+        return false;
+    }
+
+    Common::BinaryReader reader{index};
+    entries.resize(header.num_entries);
+    for (auto& entry : entries) {
+        u8 is_dir = 0;
+        if (!reader.Read(entry.path) || !reader.Read(entry.size) ||
+            !reader.Read(entry.first_block) || !reader.Read(entry.num_blocks) ||
+            !reader.Read(is_dir)) {
+            failreason = "Corrupted archive index";
+            return false;
+        }
+        entry.is_dir = is_dir != 0;
+        if (!IsSafeEntryPath(entry.path) ||
+            entry.num_blocks != entry.size / BlockSize + (entry.size % BlockSize != 0) ||
+            entry.first_block > blocks.size() ||
+            entry.num_blocks > blocks.size() - entry.first_block) {
+            failreason = fmt::format("Invalid archive entry '{}'", entry.path);
+            return false;
+        }
+    }
+    return true;
+}
+
+int GameArchive::Find(std::string_view entry_path) const {
+    const auto it = std::ranges::lower_bound(entries, entry_path, {}, &GameArchiveEntry::path);
+    return it != entries.end() && it->path == entry_path ? static_cast<int>(it - entries.begin())
+                                                         : -1;
+}
+
+s64 GameArchive::ReadBlock(int index, u64 block, const Common::FS::IOFile& file,
+                           std::vector<u8>& scratch, std::span<u8> out) const {
+    const auto& entry = entries[index];
+    if (entry.is_dir || block >= entry.num_blocks || out.size() < BlockSize) {
+        return -1;
+    }
+    const auto& stored = blocks[entry.first_block + block];
+    const u64 size = std::min(BlockSize, entry.size - block * BlockSize);
+    if (!file.Seek(static_cast<s64>(stored.offset))) {
+        return -1;
+    }
+
+    if ((stored.flags & GAME_ARCHIVE_BLOCK_COMPRESSED) == 0) {
+        if (stored.size < size || file.ReadRaw<u8>(out.data(), size) != size) {
+            return -1;
+        }
+        return static_cast<s64>(size);
+    }
+    scratch.resize(stored.size);
+    if (file.Read(scratch) != scratch.size()) {
+        return -1;
+    }
+    // PFSC blocks copied from a PKG inflate to a whole block, zero padded past the file end.
+    const s64 produced = InflatePfscBlock(scratch, out.first(BlockSize));
+    return produced >= static_cast<s64>(size) ? static_cast<s64>(size) : -1;
+}
+
+bool GameArchive::Extract(const std::filesystem::path& dest, std::string& failreason,
+                          u32 num_threads) const {
+    std::error_code ec;
+    std::vector<int> files;
+    for (int i = 0; i < static_cast<int>(entries.size()); i++) {
+        const auto target = dest / PathFromUTF8(entries[i].path);
+        std::filesystem::create_directories(entries[i].is_dir ? target : target.parent_path(),
+                                            ec);
+        if (ec) {
+            failreason = fmt::format("Failed to create the directory of {}: {}",
+                                     entries[i].path, ec.message());
+            return false;
+        }
+        if (!entries[i].is_dir) {
+            files.push_back(i);
+        }
+    }
+
+    struct ExtractWorker {
+        Common::FS::IOFile file;
+        std::vector<u8> scratch;
+        std::vector<u8> block = std::vector<u8>(BlockSize);
+    };
+    std::atomic<u32> failed{0};
+    const auto open_worker = [&](u32) {
+        return ExtractWorker{Common::FS::IOFile{path, Common::FS::FileAccessMode::Read}};
+    };
+    Common::ParallelFor(
+        files.size(), num_threads, open_worker,
+        [&](ExtractWorker& state, size_t n) {
+            const auto& entry = entries[files[n]];
+            const auto target = dest / PathFromUTF8(entry.path);
+            Common::FS::IOFile out(target, Common::FS::FileAccessMode::Write);
+            bool ok = state.file.IsOpen() && out.IsOpen();
+            for (u64 b = 0; ok && b < entry.num_blocks; b++) {
+                const s64 size = ReadBlock(files[n], b, state.file, state.scratch, state.block);
+                ok = size >= 0 && out.WriteSpan(std::span<const u8>(state.block).first(size)) ==
+                                      static_cast<size_t>(size);
+            }
+            if (!ok) {
+                LOG_ERROR(Loader, "Failed to extract {}", entry.path);
+                failed++;
+            }
+        });
+    if (failed != 0) {
+        failreason = fmt::format("{} files failed to extract", failed.load());
+        return false;
+    }
+    return true;
+}
+
+GameArchiveReader::GameArchiveReader(const GameArchive& archive_, int index_)
+    : archive{archive_}, index{index_}, file{archive_.GetPath(), Common::FS::FileAccessMode::Read},
+      block(BlockSize) {}
+
+bool GameArchiveReader::Read(u64 offset, std::span<u8> out) {
+    if (offset > GetSize() || out.size() > GetSize() - offset) {
+        return false;
+    }
+    while (!out.empty()) {
+        const u64 n = offset / BlockSize;
+        if (n != cached_block) {
+            if (archive.ReadBlock(index, n, file, scratch, block) < 0) {
+                return false;
+            }
+            cached_block = n;
+        }
+        const u64 block_offset = offset % BlockSize;
+        const u64 size = std::min<u64>(out.size(), BlockSize - block_offset);
+        std::memcpy(out.data(), block.data() + block_offset, size);
+        out = out.subspan(size);
+        offset += size;
+    }
+    return true;
+}
+
+u64 GameArchiveReader::GetSize() const {
+    return archive.GetEntries()[index].size;
+}
@@ -0,0 +1,120 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "common/io_file.h"
+#include "common/types.h"
+
+class PKG;
+
+constexpr u32 GAME_ARCHIVE_MAGIC = 0x43524147; // "GARC"
+constexpr u32 GAME_ARCHIVE_VERSION = 1;
+
+/**
+ * Layout of a game archive: the header, the data blocks, the block table and the index. Every
+ * file is split into 64 KiB blocks that are compressed on their own, so any block can be decoded
+ * without touching the others.
+ */
+struct GameArchiveHeader {
+    u32 magic;
+    u32 version;
+    u32 block_size;
+    u32 num_entries;
+    u64 num_blocks;
+    u64 block_table_offset;
+    u64 index_offset;
+    u64 index_size;
+};
+
+/// Set for a block holding a zlib stream, other blocks are stored as is.
+constexpr u32 GAME_ARCHIVE_BLOCK_COMPRESSED = 0x1;
+
+struct GameArchiveBlock {
+    u64 offset;
+    u32 size;
+    u32 flags;
+};
+
+struct GameArchiveEntry {
+    std::string path; // Relative to the game root, separated by '/'.
+    u64 size = 0;
+    u64 first_block = 0;
+    u32 num_blocks = 0;
+    bool is_dir = false;
+};
+
+struct GameArchiveStats {
+    u32 num_files = 0;
+    u32 num_dirs = 0;
+    u64 input_bytes = 0;
+    u64 num_blocks = 0;
+    u64 compressed_blocks = 0;
+    u64 reused_blocks = 0; // PFSC blocks copied without being inflated and deflated again.
+    u64 archive_size = 0;
+};
+
+/// Exports an extracted game directory, blocks are compressed across worker threads.
+bool ExportGameArchive(const std::filesystem::path& source_dir,
+                       const std::filesystem::path& archive_path, std::string& failreason,
+                       GameArchiveStats* stats = nullptr, u32 num_threads = 0);
+
+/// Exports the content of a mounted PKG the way Extract lays it out. Compressed PFSC blocks are
+/// only decrypted and copied into the archive as they are.
+bool ExportGameArchive(PKG& pkg, const std::filesystem::path& archive_path,
+                       std::string& failreason, GameArchiveStats* stats = nullptr,
+                       u32 num_threads = 0);
+
+class GameArchive {
+public:
+    bool Open(const std::filesystem::path& archive_path, std::string& failreason);
+
+    const std::filesystem::path& GetPath() const {
+        return path;
+    }
+
+    /// Entries sorted by path.
+    const std::vector<GameArchiveEntry>& GetEntries() const {
+        return entries;
+    }
+
+    /// Returns the index of the entry with the given path, or -1.
+    int Find(std::string_view entry_path) const;
+
+    /// Decodes block n of a file into out, which holds at least 64 KiB. Returns the number of
+    /// bytes of the file in the block, or -1 on error.
+    s64 ReadBlock(int index, u64 block, const Common::FS::IOFile& file,
+                  std::vector<u8>& scratch, std::span<u8> out) const;
+
+    /// Writes every entry below dest, files are decoded across worker threads.
+    bool Extract(const std::filesystem::path& dest, std::string& failreason,
+                 u32 num_threads = 0) const;
+
+private:
+    std::filesystem::path path;
+    std::vector<GameArchiveEntry> entries;
+    std::vector<GameArchiveBlock> blocks;
+};
+
+/// Random access to one file of a game archive. Only the blocks covering a read are decoded, the
+/// most recent one is kept for follow-up reads.
+class GameArchiveReader {
+public:
+    GameArchiveReader(const GameArchive& archive, int index);
+
+    bool Read(u64 offset, std::span<u8> out);
+    u64 GetSize() const;
+
+private:
+    const GameArchive& archive;
+    int index;
+    Common::FS::IOFile file;
+    std::vector<u8> scratch;
+    std::vector<u8> block;
+    u64 cached_block = ~0ULL;
+};
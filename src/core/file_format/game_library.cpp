@@ -0,0 +1,410 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+#include "common/binary_stream.h"
+#include "common/io_file.h"
+#include "common/logging/log.h"
+#include "common/parallel_for.h"
+#include "common/path_util.h"
+#include "core/file_format/game_library.h"
+#include "core/file_format/psf.h"
+
+namespace {
+
+// Maximum depth to search for games in subdirectories
+constexpr u32 MaxScanDepth = 5;
+
+// Bytes of a cached entry whose strings are all empty, bounds the entry count of a cache file
+constexpr size_t MinCachedEntrySize = 10 * sizeof(u32) + 5 * sizeof(u64) + sizeof(s32) + 2;
+
+// Larger files are not a param.sfo, this keeps a bad one from being read into memory
+constexpr u64 MaxSfoSize = 1024 * 1024;
+
+u64 GetMtime(const std::filesystem::path& path) {
+    std::error_code ec;
+    const auto write_time = std::filesystem::last_write_time(path, ec);
+    return ec ? 0 : static_cast<u64>(write_time.time_since_epoch().count());
+}
+
+/// Identifies a directory across renames and moves within the same file system.
+u64 GetDirectoryId(const std::filesystem::path& path) {
+#ifdef _WIN32
+    return std::hash<std::wstring>{}(path.native());
+#else
+    struct stat st {};
+    if (::stat(path.c_str(), &st) != 0) {
+        return 0;
+    }
+    return (static_cast<u64>(st.st_dev) << 40) ^ static_cast<u64>(st.st_ino);
+#endif
+}
+
+bool IsUpdateFolder(const std::filesystem::path& path) {
+    const auto name = path.filename().native();
+    const auto ends_with = [&](std::string_view suffix) {
+        return name.size() >= suffix.size() &&
+               std::equal(suffix.begin(), suffix.end(), name.end() - suffix.size());
+    };
+    return ends_with("-UPDATE") || ends_with("-patch");
+}
+
+/// The param.sfo shown for a game, preferring the one of an installed update.
+std::filesystem::path GetSfoPath(const std::filesystem::path& game_dir) {
+    std::error_code ec;
+    for (const char* suffix : {"-UPDATE", "-patch"}) {
+        auto update_dir = game_dir;
+        update_dir += suffix;
+        const auto sfo_path = update_dir / "sce_sys" / "param.sfo";
+        if (std::filesystem::exists(sfo_path, ec)) {
+            return sfo_path;
+        }
+    }
+    return game_dir / "sce_sys" / "param.sfo";
+}
+
+u64 GetTreeSize(const std::filesystem::path& dir) {
+    u64 total = 0;
+    std::error_code ec;
+    for (auto it = std::filesystem::recursive_directory_iterator(
+             dir, std::filesystem::directory_options::skip_permission_denied, ec);
+         !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+        if (it->is_regular_file(ec)) {
+            const u64 size = it->file_size(ec);
+            total += ec ? 0 : size;
+        }
+    }
+    return total;
+}
+
+/**
+ * Lists the install directories breadth first on a pool of threads. Each directory is read once
+ * in a single pass of the directory stream, which the C library fetches in large getdents
+ * batches, and subdirectories are told apart by the entry type without a stat per entry.
+ */
+std::vector<std::filesystem::path> FindGameDirs(std::span<const std::filesystem::path> roots,
+                                                u32 num_threads, u32& scanned_dirs) {
+    struct Task {
+        std::filesystem::path dir;
+        u32 level;
+    };
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Task> queue;
+    std::vector<std::filesystem::path> found;
+    u32 active = 0;
+    for (const auto& root : roots) {
+        queue.push_back({root, 0});
+    }
+
+    const auto worker = [&] {
+        std::unique_lock lock{mutex};
+        while (true) {
+            cv.wait(lock, [&] { return !queue.empty() || active == 0; });
+            if (queue.empty()) {
+                return;
+            }
+            Task task = std::move(queue.front());
+            queue.pop_front();
+            active++;
+            lock.unlock();
+
+            std::vector<Task> children;
+            std::error_code ec;
+            const bool is_game =
+                task.level > 0 &&
+                std::filesystem::exists(task.dir / "sce_sys" / "param.sfo", ec);
+            if (!is_game && task.level < MaxScanDepth) {
+                for (auto it = std::filesystem::directory_iterator(
+                         task.dir, std::filesystem::directory_options::skip_permission_denied, ec);
+                     !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+                    if (it->is_directory(ec) && !IsUpdateFolder(it->path())) {
+                        children.push_back({it->path(), task.level + 1});
+                    }
+                }
+            }
+
+            lock.lock();
+            active--;
+            scanned_dirs++;
+            if (is_game) {
+                found.push_back(std::move(task.dir));
+            }
+            for (auto& child : children) {
+                queue.push_back(std::move(child));
+            }
+            cv.notify_all();
+        }
+    };
+
+    std::vector<std::jthread> workers;
+    for (u32 t = 1; t < num_threads; t++) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    workers.clear();
+    return found;
+}
+
+/// Reads the param.sfo fields of a game, leaving them empty if the file is not a valid param.sfo.
+bool ProbeGame(const std::filesystem::path& sfo_path, GameLibraryEntry& entry) {
+    Common::FS::IOFile file(sfo_path, Common::FS::FileAccessMode::Read);
+    std::vector<u8> data;
+    PsfView psf;
+    if (file.IsOpen() && file.GetSize() <= MaxSfoSize) {
+        data.resize(file.GetSize());
+    }
+    if (data.empty() || file.Read(data) != data.size() || !psf.Open(data)) {
+        LOG_WARNING(Loader, "Failed to read {}", Common::FS::PathToUTF8String(sfo_path));
+        return false;
+    }
+
+    entry.title = psf.GetString("TITLE").value_or("");
+    entry.title_id = psf.GetString("TITLE_ID").value_or("");
+    entry.content_id = psf.GetString("CONTENT_ID").value_or("");
+    entry.app_ver = psf.GetString("APP_VER").value_or("");
+    entry.play_time = psf.GetString("PLAY_TIME").value_or("");
+    const auto system_ver = psf.GetInteger("SYSTEM_VER");
+    entry.system_ver = system_ver.value_or(0);
+    entry.has_system_ver = system_ver.has_value();
+    return true;
+}
+
+} // Anonymous namespace
+
+std::filesystem::path GetExtractManifestPath(const std::filesystem::path& game_dir) {
+    const auto dir = game_dir.has_filename() ? game_dir : game_dir.parent_path();
+    auto name = std::filesystem::path(".");
+    name += dir.filename();
+    name += ".extract_manifest";
+    return dir.parent_path() / name;
+}
+
+bool WriteExtractManifest(const std::filesystem::path& game_dir, u64 total_bytes, u32 num_files) {
+    const u64 dir_id = GetDirectoryId(game_dir);
+    const u64 dir_mtime = GetMtime(game_dir);
+    if (dir_id == 0 || dir_mtime == 0) {
+        return false;
+    }
+    // Earlier versions wrote the manifest into the game's sce_sys.
+    std::error_code ec;
+    std::filesystem::remove(game_dir / "sce_sys" / "extract_manifest.bin", ec);
+
+    Common::BinaryWriter writer;
+    writer.Write(EXTRACT_MANIFEST_MAGIC);
+    writer.Write(EXTRACT_MANIFEST_VERSION);
+    writer.Write(dir_id);
+    writer.Write(dir_mtime);
+    writer.Write(total_bytes);
+    writer.Write(num_files);
+    return Common::FS::IOFile::WriteBytes(GetExtractManifestPath(game_dir), writer.Data()) ==
+           writer.Data().size();
+}
+
+std::optional<ExtractManifest> ReadExtractManifest(const std::filesystem::path& game_dir) {
+    const auto manifest_path = GetExtractManifestPath(game_dir);
+    std::error_code ec;
+    if (!std::filesystem::exists(manifest_path, ec)) {
+        return std::nullopt;
+    }
+
+    Common::FS::IOFile file(manifest_path, Common::FS::FileAccessMode::Read);
+    if (!file.IsOpen()) {
+        return std::nullopt;
+    }
+    std::vector<u8> data(file.GetSize());
+    if (file.Read(data) != data.size()) {
+        return std::nullopt;
+    }
+
+    Common::BinaryReader reader{data};
+    u32 magic = 0;
+    u32 version = 0;
+    ExtractManifest manifest;
+    if (!reader.Read(magic) || !reader.Read(version) || magic != EXTRACT_MANIFEST_MAGIC ||
+        version != EXTRACT_MANIFEST_VERSION || !reader.Read(manifest.dir_id) ||
+        !reader.Read(manifest.dir_mtime) || !reader.Read(manifest.total_bytes) ||
+        !reader.Read(manifest.num_files)) {
+        return std::nullopt;
+    }
+
+    // Another directory now under that name, or files added or removed at its top level since
+    // extraction, make the size stale.
+    if (manifest.dir_id != GetDirectoryId(game_dir) || manifest.dir_mtime != GetMtime(game_dir)) {
+        return std::nullopt;
+    }
+    return manifest;
+}
+
+bool GameLibrary::Load(const std::filesystem::path& cache_path) {
+    entries.clear();
+    if (!std::filesystem::exists(cache_path)) {
+        return false;
+    }
+
+    Common::FS::IOFile file(cache_path, Common::FS::FileAccessMode::Read);
+    if (!file.IsOpen()) {
+        return false;
+    }
+    std::vector<u8> data(file.GetSize());
+    if (file.Read(data) != data.size()) {
+        return false;
+    }
+
+    Common::BinaryReader reader{data};
+    u32 magic = 0;
+    u32 version = 0;
+    u32 count = 0;
+    if (!reader.Read(magic) || !reader.Read(version) || !reader.Read(count) ||
+        magic != GAME_LIBRARY_MAGIC || version != GAME_LIBRARY_VERSION) {
+        LOG_WARNING(Loader, "Ignoring invalid or outdated game library cache");
+        return false;
+    }
+    if (count > reader.Remaining() / MinCachedEntrySize) {
+        LOG_WARNING(Loader, "Game library cache is truncated");
+        return false;
+    }
+
+    entries.resize(count);
+    for (auto& entry : entries) {
+        const bool ok = reader.Read(entry.path) && reader.Read(entry.dir_id) &&
+                        reader.Read(entry.dir_mtime) && reader.Read(entry.sfo_mtime) &&
+                        reader.Read(entry.sfo_size) && reader.Read(entry.sfo_path) &&
+                        reader.Read(entry.icon_path) && reader.Read(entry.pic_path) &&
+                        reader.Read(entry.snd0_path) && reader.Read(entry.title) &&
+                        reader.Read(entry.title_id) && reader.Read(entry.content_id) &&
+                        reader.Read(entry.app_ver) && reader.Read(entry.play_time) &&
+                        reader.Read(entry.system_ver) && reader.Read(entry.has_system_ver) &&
+                        reader.Read(entry.size) && reader.Read(entry.has_size);
+        if (!ok) {
+            LOG_WARNING(Loader, "Game library cache is truncated");
+            entries.clear();
+            return false;
+        }
+    }
+    std::ranges::sort(entries, {}, &GameLibraryEntry::path);
+    return true;
+}
+
+bool GameLibrary::Save(const std::filesystem::path& cache_path) const {
+    Common::BinaryWriter writer;
+    writer.Write(GAME_LIBRARY_MAGIC);
+    writer.Write(GAME_LIBRARY_VERSION);
+    writer.Write(static_cast<u32>(entries.size()));
+    for (const auto& entry : entries) {
+        writer.Write(entry.path);
+        writer.Write(entry.dir_id);
+        writer.Write(entry.dir_mtime);
+        writer.Write(entry.sfo_mtime);
+        writer.Write(entry.sfo_size);
+        writer.Write(entry.sfo_path);
+        writer.Write(entry.icon_path);
+        writer.Write(entry.pic_path);
+        writer.Write(entry.snd0_path);
+        writer.Write(entry.title);
+        writer.Write(entry.title_id);
+        writer.Write(entry.content_id);
+        writer.Write(entry.app_ver);
+        writer.Write(entry.play_time);
+        writer.Write(entry.system_ver);
+        writer.Write(entry.has_system_ver);
+        writer.Write(entry.size);
+        writer.Write(entry.has_size);
+    }
+
+    // Write to a temporary file first so an interrupted save never leaves a torn cache.
+    auto temp_path = cache_path;
+    temp_path += ".tmp";
+    if (Common::FS::IOFile::WriteBytes(temp_path, writer.Data()) != writer.Data().size()) {
+        return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_path, cache_path, ec);
+    return !ec;
+}
+
+GameLibraryStats GameLibrary::Scan(std::span<const std::filesystem::path> install_dirs,
+                                   bool compute_sizes, u32 num_threads) {
+    GameLibraryStats stats{};
+    if (num_threads == 0) {
+        num_threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    const auto game_dirs = FindGameDirs(install_dirs, num_threads, stats.scanned_dirs);
+
+    std::unordered_map<u64, const GameLibraryEntry*> known;
+    for (const auto& entry : entries) {
+        if (entry.dir_id != 0) {
+            known.emplace(entry.dir_id, &entry);
+        }
+    }
+
+    std::vector<GameLibraryEntry> scanned(game_dirs.size());
+    std::atomic<u32> probed{0};
+    std::atomic<u32> reused{0};
+    std::atomic<u32> sized{0};
+    Common::ParallelFor(game_dirs.size(), num_threads, [&](size_t i) {
+        const auto& game_dir = game_dirs[i];
+        auto& entry = scanned[i];
+        const auto sfo_path = GetSfoPath(game_dir);
+        std::error_code ec;
+        const u64 dir_id = GetDirectoryId(game_dir);
+        const u64 dir_mtime = GetMtime(game_dir);
+        const u64 sfo_mtime = GetMtime(sfo_path);
+        const u64 sfo_size = std::filesystem::file_size(sfo_path, ec);
+
+        // Games are matched by directory identity, so a moved game keeps its entry.
+        const auto it = known.find(dir_id);
+        const bool unchanged = it != known.end() && it->second->dir_mtime == dir_mtime &&
+                               it->second->sfo_mtime == sfo_mtime &&
+                               it->second->sfo_size == sfo_size;
+        if (unchanged) {
+            entry = *it->second;
+            reused++;
+        }
+        entry.path = Common::FS::PathToUTF8String(game_dir);
+        entry.sfo_path = Common::FS::PathToUTF8String(sfo_path);
+        entry.icon_path = Common::FS::PathToUTF8String(game_dir / "sce_sys" / "icon0.png");
+        entry.pic_path = Common::FS::PathToUTF8String(game_dir / "sce_sys" / "pic1.png");
+        entry.snd0_path = Common::FS::PathToUTF8String(game_dir / "sce_sys" / "snd0.at9");
+        // A game whose param.sfo cannot be read is still listed, by its path only.
+        if (!unchanged && ProbeGame(sfo_path, entry)) {
+            probed++;
+        }
+        entry.dir_id = dir_id;
+        entry.dir_mtime = dir_mtime;
+        entry.sfo_mtime = sfo_mtime;
+        entry.sfo_size = sfo_size;
+
+        if (!compute_sizes) {
+            entry.has_size = false;
+        } else if (const auto manifest = ReadExtractManifest(game_dir)) {
+            entry.size = manifest->total_bytes;
+            entry.has_size = true;
+        } else if (!unchanged || !entry.has_size) {
+            entry.size = GetTreeSize(game_dir);
+            entry.has_size = true;
+            sized++;
+        }
+    });
+
+    entries = std::move(scanned);
+    std::ranges::sort(entries, {}, &GameLibraryEntry::path);
+
+    stats.probed = probed;
+    stats.reused = reused;
+    stats.sized = sized;
+    return stats;
+}
@@ -0,0 +1,88 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+#include "common/types.h"
+
+constexpr u32 GAME_LIBRARY_MAGIC = 0x4C424D47; // "GMBL"
+constexpr u32 GAME_LIBRARY_VERSION = 2;
+
+constexpr u32 EXTRACT_MANIFEST_MAGIC = 0x4D474B50; // "PKGM"
+constexpr u32 EXTRACT_MANIFEST_VERSION = 2;
+
+/// Written next to an extracted game so its size is known without walking the tree. It is kept
+/// out of the game directory, where the game itself, --pack and --export would pick it up.
+struct ExtractManifest {
+    u64 dir_id = 0;    // Device and inode of the game directory.
+    u64 dir_mtime = 0; // Game directory modification time when the manifest was written.
+    u64 total_bytes = 0;
+    u32 num_files = 0;
+};
+
+/// Returns the hidden .<name>.extract_manifest file beside game_dir.
+std::filesystem::path GetExtractManifestPath(const std::filesystem::path& game_dir);
+bool WriteExtractManifest(const std::filesystem::path& game_dir, u64 total_bytes, u32 num_files);
+
+/// Returns the manifest of a game directory as long as the directory has not changed since.
+std::optional<ExtractManifest> ReadExtractManifest(const std::filesystem::path& game_dir);
+
+/// An installed game and the param.sfo fields shown in the game list.
+struct GameLibraryEntry {
+    std::string path;
+    u64 dir_id = 0;    // Device and inode of the game directory.
+    u64 dir_mtime = 0;
+    u64 sfo_mtime = 0; // Of the param.sfo in use, which may come from an update folder.
+    u64 sfo_size = 0;
+
+    std::string sfo_path;
+    std::string icon_path;
+    std::string pic_path;
+    std::string snd0_path;
+
+    // param.sfo
+    std::string title;
+    std::string title_id;
+    std::string content_id;
+    std::string app_ver;
+    std::string play_time;
+    s32 system_ver = 0;
+    bool has_system_ver = false;
+
+    u64 size = 0;
+    bool has_size = false;
+};
+
+struct GameLibraryStats {
+    u32 scanned_dirs = 0;
+    u32 probed = 0;
+    u32 reused = 0;
+    u32 sized = 0; // Games whose size had to be computed by walking their files.
+};
+
+/**
+ * Persistent index of the games found in the install directories. Directories are traversed in
+ * parallel and games are keyed by directory identity, so only new or changed games have their
+ * param.sfo parsed again. Sizes come from the extraction manifest when there is one.
+ */
+class GameLibrary {
+public:
+    bool Load(const std::filesystem::path& cache_path);
+    bool Save(const std::filesystem::path& cache_path) const;
+
+    /// Finds the games below the install directories and refreshes their entries.
+    GameLibraryStats Scan(std::span<const std::filesystem::path> install_dirs, bool compute_sizes,
+                          u32 num_threads = 0);
+
+    const std::vector<GameLibraryEntry>& GetEntries() const {
+        return entries;
+    }
+
+private:
+    std::vector<GameLibraryEntry> entries; // Sorted by path.
+};
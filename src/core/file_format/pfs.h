@@ -108,10 +108,25 @@ struct Inode {
     u32 loc;
 };
 
-struct pfs_fs_table {
-    std::string name;
-    u32 inode;
-    u32 type;
+constexpr u32 PFS_INVALID_NODE = 0xFFFFFFFF;
+
+/// The parts of an on-disk Inode needed to locate and size a file's data.
+struct PfsInode {
+    u64 size;
+    u64 size_compressed;
+    u32 blocks;
+    u32 loc;
+    u32 flags;
+    u16 mode;
+};
+
+/// Directory tree node indexed by inode number. Names live in a shared string arena and full
+/// paths are only built when a file is opened for writing.
+struct PfsTreeNode {
+    u32 parent = PFS_INVALID_NODE;
+    u32 name_offset = 0;
+    u16 name_length = 0;
+    u8 type = 0;
 };
 
 struct Dirent {
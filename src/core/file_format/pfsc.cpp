@@ -0,0 +1,46 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "core/file_format/pfsc.h"
+
+PfscCompressor::PfscCompressor(int level) {
+    initialized = deflateInit(&stream, level) == Z_OK;
+}
+
+PfscCompressor::~PfscCompressor() {
+    if (initialized) {
+        deflateEnd(&stream);
+    }
+}
+
+bool PfscCompressor::Compress(std::span<const u8> block, std::vector<u8>& out) {
+    out.resize(block.size());
+    if (initialized && !block.empty() && deflateReset(&stream) == Z_OK) {
+        stream.next_in = const_cast<u8*>(block.data());
+        stream.avail_in = static_cast<uInt>(block.size());
+        stream.next_out = out.data();
+        // Stored blocks are told apart by their size, so the output has to stay below it.
+        stream.avail_out = static_cast<uInt>(block.size() - 1);
+        if (deflate(&stream, Z_FINISH) == Z_STREAM_END) {
+            out.resize(stream.total_out);
+            return true;
+        }
+    }
+    out.assign(block.begin(), block.end());
+    return false;
+}
+
+s64 InflatePfscBlock(std::span<const u8> compressed, std::span<u8> out) {
+    z_stream stream{};
+    if (inflateInit(&stream) != Z_OK) {
+        return -1;
+    }
+    stream.next_in = const_cast<u8*>(compressed.data());
+    stream.avail_in = static_cast<uInt>(compressed.size());
+    stream.next_out = out.data();
+    stream.avail_out = static_cast<uInt>(out.size());
+    const int result = inflate(&stream, Z_FINISH);
+    const s64 produced = static_cast<s64>(stream.total_out);
+    inflateEnd(&stream);
+    return result == Z_STREAM_END ? produced : -1;
+}
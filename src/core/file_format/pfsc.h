@@ -0,0 +1,32 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <span>
+#include <vector>
+#include "zlib/zlib.h"
+#include "common/types.h"
+
+/// Uncompressed size of a PFSC block. A stored block of this size is not compressed.
+constexpr u64 PFSC_BLOCK_SIZE = 0x10000;
+
+/// Deflates blocks into zlib streams as PFSC stores them, keeping one stream across blocks.
+class PfscCompressor {
+public:
+    explicit PfscCompressor(int level = Z_DEFAULT_COMPRESSION);
+    ~PfscCompressor();
+
+    PfscCompressor(const PfscCompressor&) = delete;
+    PfscCompressor& operator=(const PfscCompressor&) = delete;
+
+    /// Returns false when the block does not shrink, out then holds the block as is.
+    bool Compress(std::span<const u8> block, std::vector<u8>& out);
+
+private:
+    z_stream stream{};
+    bool initialized = false;
+};
+
+/// Inflates one zlib compressed block into out, returns the number of bytes produced or -1.
+s64 InflatePfscBlock(std::span<const u8> compressed, std::span<u8> out);
@@ -1,32 +1,74 @@
 // SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
 // SPDX-License-Identifier: GPL-2.0-or-later
 
-#include "zlib/zlib.h"
+#include <algorithm>
+#include <atomic>
+#include "common/alignment.h"
+#include "common/binary_stream.h"
+#include "common/config.h"
 #include "common/io_file.h"
 #include "common/logging/formatter.h"
+#include "common/logging/log.h"
+#include "common/parallel_for.h"
+#include "common/path_util.h"
+#include "core/file_format/pfsc.h"
 #include "core/file_format/pkg.h"
 #include "core/file_format/pkg_type.h"
 
-static void DecompressPFSC(std::span<char> compressed_data, std::span<char> decompressed_data) {
-    z_stream decompressStream;
-    decompressStream.zalloc = Z_NULL;
-    decompressStream.zfree = Z_NULL;
-    decompressStream.opaque = Z_NULL;
-
-    if (inflateInit(&decompressStream) != Z_OK) {
-        // std::cerr << "Error initializing zlib for deflation." << std::endl;
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/// Turns a stored PFSC block into its 0x10000 bytes. Compressed blocks always inflate to a whole
+/// block, zero padded past the end of the file, and an empty block reads back as zeros.
+static bool DecodePfscBlock(std::span<const char> stored, std::span<char> out) {
+    if (stored.empty()) {
+        std::fill(out.begin(), out.end(), 0);
+        return true;
+    }
+    if (stored.size() == out.size()) {
+        std::memcpy(out.data(), stored.data(), out.size());
+        return true;
     }
+    const s64 produced = InflatePfscBlock(
+        {reinterpret_cast<const u8*>(stored.data()), stored.size()},
+        {reinterpret_cast<u8*>(out.data()), out.size()});
+    return produced == static_cast<s64>(out.size());
+}
+
+// DK3, EKPFS, the data and tweak keys, then a zero block to check the decryption against.
+static constexpr size_t CachedKeysSize = 32 + 32 + 16 + 16 + 16;
 
-    decompressStream.avail_in = compressed_data.size();
-    decompressStream.next_in = reinterpret_cast<unsigned char*>(compressed_data.data());
-    decompressStream.avail_out = decompressed_data.size();
-    decompressStream.next_out = reinterpret_cast<unsigned char*>(decompressed_data.data());
+static u64 GetMtime(const std::filesystem::path& path) {
+    std::error_code ec;
+    const auto write_time = std::filesystem::last_write_time(path, ec);
+    return ec ? 0 : static_cast<u64>(write_time.time_since_epoch().count());
+}
+
+/// The absolute path a PKG is cached under.
+static std::string GetMetadataCacheId(const std::filesystem::path& pkg_path) {
+    std::error_code ec;
+    const auto absolute = std::filesystem::absolute(pkg_path, ec);
+    return Common::FS::PathToUTF8String(ec ? pkg_path : absolute.lexically_normal());
+}
 
-    if (inflate(&decompressStream, Z_FINISH)) {
+/// Returns the sidecar file of a PKG in the metadata cache, or an empty path if caching is off.
+static std::filesystem::path GetMetadataCachePath(std::string_view id) {
+    const auto cache_dir = Config::getPkgMetadataCacheDir();
+    if (cache_dir.empty()) {
+        return {};
     }
-    if (inflateEnd(&decompressStream) != Z_OK) {
-        // std::cerr << "Error ending zlib inflate" << std::endl;
+    std::array<u8, 32> digest;
+    CryptoPP::SHA256().CalculateDigest(digest.data(), reinterpret_cast<const u8*>(id.data()),
+                                       id.size());
+    std::string name;
+    for (const u8 byte : std::span(digest).first(8)) {
+        name += fmt::format("{:02x}", byte);
     }
+    return cache_dir / (name + ".pkgmeta");
 }
 
 u32 GetPFSCOffset(std::span<const u8> pfs_image) {
@@ -40,6 +82,42 @@ u32 GetPFSCOffset(std::span<const u8> pfs_image) {
     return -1;
 }
 
+/// Reads the directory entry at pos, returns false if it runs past the end of the block.
+static bool ReadDirent(std::span<const char> block, u32 pos, Dirent& dirent) {
+    static constexpr u32 HeaderSize = offsetof(Dirent, name);
+    if (pos + HeaderSize > block.size()) {
+        return false;
+    }
+    std::memcpy(&dirent, block.data() + pos, HeaderSize);
+    if (dirent.entsize <= 0 || dirent.namelen < 0 ||
+        dirent.namelen > static_cast<s32>(sizeof(dirent.name)) ||
+        pos + HeaderSize + dirent.namelen > block.size()) {
+        return dirent.ino == 0; // Zeroed tail of the block.
+    }
+    std::memcpy(dirent.name, block.data() + pos + HeaderSize, dirent.namelen);
+    return true;
+}
+
+#ifndef _WIN32
+static int OpenDirectory(const std::filesystem::path& path) {
+    return ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+static bool WriteAll(int fd, std::span<const char> data) {
+    while (!data.empty()) {
+        const ssize_t written = ::write(fd, data.data(), data.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data = data.subspan(written);
+    }
+    return true;
+}
+#endif
+
 PKG::PKG() = default;
 
 PKG::~PKG() = default;
@@ -47,13 +125,16 @@ PKG::~PKG() = default;
 bool PKG::Open(const std::filesystem::path& filepath, std::string& failreason) {
     Common::FS::IOFile file(filepath, Common::FS::FileAccessMode::Read);
     if (!file.IsOpen()) {
+        failreason = "Failed to open the file";
         return false;
     }
+    pkgpath = filepath;
     pkgSize = file.GetSize();
 
-    file.Read(pkgheader);
-    if (pkgheader.magic != 0x7F434E54)
+    if (file.Read(pkgheader) != 1 || pkgheader.magic != 0x7F434E54) {
+        failreason = "Not a PKG file";
         return false;
+    }
 
     for (const auto& flag : flagNames) {
         if (isFlagSet(pkgheader.pkg_content_flags, flag.first)) {
@@ -75,6 +156,8 @@ bool PKG::Open(const std::filesystem::path& filepath, std::string& failreason) {
         return false;
     }
 
+    pkgEntries.clear();
+    dk3Ready = false;
     for (int i = 0; i < n_files; i++) {
         PKGEntry entry{};
         file.Read(entry.id);
@@ -84,6 +167,7 @@ bool PKG::Open(const std::filesystem::path& filepath, std::string& failreason) {
         file.Read(entry.offset);
         file.Read(entry.size);
         file.Seek(8, Common::FS::SeekOrigin::CurrentPosition);
+        pkgEntries.push_back(entry);
 
         // Try to figure out the name
         const auto name = GetEntryNameByType(entry.id);
@@ -95,6 +179,7 @@ bool PKG::Open(const std::filesystem::path& filepath, std::string& failreason) {
             }
             sfo.resize(entry.size);
             file.ReadRaw<u8>(sfo.data(), entry.size);
+            file.Seek(offset + (i + 1) * sizeof(PKGEntry));
         }
     }
     file.Close();
@@ -102,9 +187,91 @@ bool PKG::Open(const std::filesystem::path& filepath, std::string& failreason) {
     return true;
 }
 
+bool PKG::ReadEntry(u32 id, std::vector<u8>& data, std::string& failreason) {
+    const auto it = std::ranges::find(pkgEntries, id, [](const PKGEntry& e) { return u32(e.id); });
+    if (it == pkgEntries.end()) {
+        failreason = fmt::format("PKG has no entry {:#x}", id);
+        return false;
+    }
+
+    Common::FS::IOFile file(pkgpath, Common::FS::FileAccessMode::Read);
+    if (!file.IsOpen()) {
+        failreason = "Failed to open PKG file";
+        return false;
+    }
+
+    const bool is_np = id >= 0x400 && id <= 0x403;
+    if (is_np && !dk3Ready) {
+        // DK3 is the fourth RSA encrypted key of ENTRY_KEYS, after the seed and 7 digests.
+        const auto keys = std::ranges::find(pkgEntries, 0x10u,
+                                            [](const PKGEntry& e) { return u32(e.id); });
+        std::array<u8, 256> key1_3;
+        if (keys == pkgEntries.end() || !file.Seek(keys->offset + 32 + 7 * 32 + 3 * 256) ||
+            file.Read(key1_3) != key1_3.size()) {
+            failreason = "Failed to read PKG entry keys";
+            return false;
+        }
+        PKG::crypto.RSA2048Decrypt(dk3_, key1_3, true); // decrypt DK3
+        dk3Ready = true;
+    }
+
+    std::vector<u8> raw(it->size);
+    if (!file.Seek(it->offset) || file.Read(raw) != raw.size()) {
+        failreason = "Failed to read PKG entry";
+        return false;
+    }
+    if (is_np) {
+        DecryptNpEntry(*it, raw, data);
+    } else {
+        data = std::move(raw);
+    }
+    return true;
+}
+
+void PKG::DecryptNpEntry(const PKGEntry& entry, std::span<u8> data, std::vector<u8>& out) {
+    std::array<u8, 64> concatenated_ivkey_dk3_;
+    std::memcpy(concatenated_ivkey_dk3_.data(), &entry, sizeof(entry));
+    std::memcpy(concatenated_ivkey_dk3_.data() + sizeof(entry), dk3_.data(), sizeof(dk3_));
+    std::array<u8, 32> npIvKey;
+    PKG::crypto.ivKeyHASH256(concatenated_ivkey_dk3_, npIvKey);
+    out.resize(data.size());
+    PKG::crypto.aesCbcCfb128DecryptEntry(npIvKey, data, out);
+}
+
 bool PKG::Extract(const std::filesystem::path& filepath, const std::filesystem::path& extract,
                   std::string& failreason) {
     extract_path = extract;
+    replaceFiles = false;
+    if (!LoadImage(filepath, failreason, true)) {
+        return false;
+    }
+    CreateDirectories();
+    return true;
+}
+
+bool PKG::ExtractOver(const std::filesystem::path& filepath, const std::filesystem::path& target,
+                      std::string& failreason) {
+    if (!std::filesystem::is_directory(target)) {
+        failreason = "Target directory does not exist";
+        return false;
+    }
+    extract_path = target;
+    replaceFiles = true;
+    if (!LoadImage(filepath, failreason, true)) {
+        return false;
+    }
+    CreateDirectories();
+    return true;
+}
+
+bool PKG::Mount(const std::filesystem::path& filepath, std::string& failreason) {
+    extract_path.clear();
+    replaceFiles = false;
+    return LoadImage(filepath, failreason, false);
+}
+
+bool PKG::LoadImage(const std::filesystem::path& filepath, std::string& failreason,
+                    bool write_sce_sys) {
     pkgpath = filepath;
     Common::FS::IOFile file(filepath, Common::FS::FileAccessMode::Read);
     if (!file.IsOpen()) {
@@ -125,6 +292,22 @@ bool PKG::Extract(const std::filesystem::path& filepath, const std::filesystem::
         return false;
     }
 
+    // Root of the extracted tree. DLCs and patches are extracted in place, games get a folder
+    // named after their title ID.
+    const auto parent_path = extract_path.parent_path();
+    const auto title_id = GetTitleID();
+    if (replaceFiles) {
+        rootPath = extract_path;
+    } else if (parent_path.filename() != title_id &&
+        !fmt::UTF(extract_path.u8string()).data.ends_with("-patch")) {
+        rootPath = parent_path / title_id;
+    } else {
+        rootPath = extract_path;
+    }
+
+    // With a valid cache only the sce_sys entries are left to write.
+    const bool cached = LoadMetadataCache(file);
+
     u32 offset = pkgheader.pkg_table_entry_offset;
     u32 n_files = pkgheader.pkg_table_entry_count;
 
@@ -153,10 +336,12 @@ bool PKG::Extract(const std::filesystem::path& filepath, const std::filesystem::
 
         // Try to figure out the name
         const auto name = GetEntryNameByType(entry.id);
-        const auto filepath = extract_path / "sce_sys" / name;
-        std::filesystem::create_directories(filepath.parent_path());
+        if (write_sce_sys) {
+            const auto filepath = extract_path / "sce_sys" / name;
+            std::filesystem::create_directories(filepath.parent_path());
+        }
 
-        if (name.empty()) {
+        if (name.empty() && write_sce_sys) {
             // Just print with id
             Common::FS::IOFile out(extract_path / "sce_sys" / std::to_string(entry.id),
                                    Common::FS::FileAccessMode::Write);
@@ -175,9 +360,9 @@ bool PKG::Extract(const std::filesystem::path& filepath, const std::filesystem::
             continue;
         }
 
-        if (entry.id == 0x1) {         // DIGESTS, seek;
-                                       // file.Seek(entry.offset, fsSeekSet);
-        } else if (entry.id == 0x10) { // ENTRY_KEYS, seek;
+        if (entry.id == 0x1) {                    // DIGESTS, seek;
+                                                  // file.Seek(entry.offset, fsSeekSet);
+        } else if (entry.id == 0x10 && !cached) { // ENTRY_KEYS, seek;
             file.Seek(entry.offset);
             file.Read(seed_digest);
 
@@ -190,7 +375,8 @@ bool PKG::Extract(const std::filesystem::path& filepath, const std::filesystem::
             }
 
             PKG::crypto.RSA2048Decrypt(dk3_, key1[3], true); // decrypt DK3
-        } else if (entry.id == 0x20) {                       // IMAGE_KEY, seek; IV_KEY
+            dk3Ready = true;
+        } else if (entry.id == 0x20 && !cached) {            // IMAGE_KEY, seek; IV_KEY
             file.Seek(entry.offset);
             file.Read(imgkeydata);
 
@@ -208,6 +394,11 @@ bool PKG::Extract(const std::filesystem::path& filepath, const std::filesystem::
             // file.Seek(entry.offset, fsSeekSet);
         }
 
+        if (!write_sce_sys) {
+            file.Seek(currentPos);
+            continue;
+        }
+
         Common::FS::IOFile out(extract_path / "sce_sys" / name, Common::FS::FileAccessMode::Write);
         if (!file.Seek(entry.offset)) {
             failreason = "Failed to seek to PKG entry offset";
@@ -232,13 +423,7 @@ bool PKG::Extract(const std::filesystem::path& filepath, const std::filesystem::
             std::vector<u8> data;
             data.resize(entry.size);
             file.ReadRaw<u8>(data.data(), entry.size);
-
-            std::span<u8> cipherNp(data.data(), entry.size);
-            std::array<u8, 64> concatenated_ivkey_dk3_;
-            std::memcpy(concatenated_ivkey_dk3_.data(), &entry, sizeof(entry));
-            std::memcpy(concatenated_ivkey_dk3_.data() + sizeof(entry), dk3_.data(), sizeof(dk3_));
-            PKG::crypto.ivKeyHASH256(concatenated_ivkey_dk3_, ivKey);
-            PKG::crypto.aesCbcCfb128DecryptEntry(ivKey, cipherNp, decNp);
+            DecryptNpEntry(entry, data, decNp);
 
             Common::FS::IOFile out(extract_path / "sce_sys" / name,
                                    Common::FS::FileAccessMode::Write);
@@ -249,6 +434,10 @@ bool PKG::Extract(const std::filesystem::path& filepath, const std::filesystem::
         file.Seek(currentPos);
     }
 
+    if (cached) {
+        return true;
+    }
+
     // Read the seed
     std::array<u8, 16> seed;
     if (!file.Seek(pkgheader.pfs_image_offset + 0x370)) {
@@ -259,73 +448,112 @@ bool PKG::Extract(const std::filesystem::path& filepath, const std::filesystem::
 
     // Get data and tweak keys.
     PKG::crypto.PfsGenCryptoKey(ekpfsKey, seed, dataKey, tweakKey);
-    const u32 length = pkgheader.pfs_cache_size * 0x2; // Seems to be ok.
+    const u64 length = static_cast<u64>(pkgheader.pfs_cache_size) * 0x2; // Seems to be ok.
 
-    int num_blocks = 0;
-    std::vector<u8> pfsc(length);
+    u64 num_blocks = 0;
+    std::vector<u8> pfsc;
+    sectorMap.clear();
     if (length != 0) {
         // Read encrypted pfs_image
         std::vector<u8> pfs_encrypted(length);
         file.Seek(pkgheader.pfs_image_offset);
         file.Read(pfs_encrypted);
-        file.Close();
         // Decrypt the pfs_image.
         std::vector<u8> pfs_decrypted(length);
         PKG::crypto.decryptPFS(dataKey, tweakKey, pfs_encrypted, pfs_decrypted, 0);
 
         // Retrieve PFSC from decrypted pfs_image.
         pfsc_offset = GetPFSCOffset(pfs_decrypted);
-        std::memcpy(pfsc.data(), pfs_decrypted.data() + pfsc_offset, length - pfsc_offset);
+        if (pfsc_offset == static_cast<u32>(-1)) {
+            failreason = "PFSC header not found";
+            return false;
+        }
+        pfsc.assign(pfs_decrypted.begin() + pfsc_offset, pfs_decrypted.end());
 
         PFSCHdr pfsChdr;
         std::memcpy(&pfsChdr, pfsc.data(), sizeof(pfsChdr));
+        if (pfsChdr.block_sz2 <= 0 || pfsChdr.data_length < 0 || pfsChdr.block_offsets < 0) {
+            failreason = "Invalid PFSC header";
+            return false;
+        }
 
-        num_blocks = (int)(pfsChdr.data_length / pfsChdr.block_sz2);
+        num_blocks = static_cast<u64>(pfsChdr.data_length / pfsChdr.block_sz2);
         sectorMap.resize(num_blocks + 1); // 8 bytes, need extra 1 to get the last offset.
 
-        for (int i = 0; i < num_blocks + 1; i++) {
-            std::memcpy(&sectorMap[i], pfsc.data() + pfsChdr.block_offsets + i * 8, 8);
+        // The sector map of large images can extend past the cached part of the image.
+        const auto map_bytes = std::as_writable_bytes(std::span(sectorMap));
+        const u64 map_offset = static_cast<u64>(pfsChdr.block_offsets);
+        if (map_offset + map_bytes.size() <= pfsc.size()) {
+            std::memcpy(map_bytes.data(), pfsc.data() + map_offset, map_bytes.size());
+        } else if (!ReadPfsImage(file, pfsc_offset + map_offset,
+                                 {reinterpret_cast<u8*>(map_bytes.data()), map_bytes.size()})) {
+            failreason = "Failed to read PFSC sector map";
+            return false;
         }
     }
 
     u32 ent_size = 0;
     u32 ndinode = 0;
-    int ndinode_counter = 0;
+    u32 ndinode_counter = 0;
+    u32 current_dir = PFS_INVALID_NODE;
     bool dinode_reached = false;
     bool uroot_reached = false;
     std::vector<char> compressedData;
     std::vector<char> decompressedData(0x10000);
 
+    fsEntries.clear();
+    fsTree.clear();
+    fsInodes.clear();
+    fsNames.clear();
+
     // Get iNdoes and Dirents.
-    for (int i = 0; i < num_blocks; i++) {
+    for (u64 i = 0; i < num_blocks; i++) {
         const u64 sectorOffset = sectorMap[i];
         const u64 sectorSize = sectorMap[i + 1] - sectorOffset;
+        if (sectorMap[i + 1] < sectorOffset || sectorSize > 0x10000) {
+            failreason = "Invalid PFSC sector map";
+            return false;
+        }
 
         compressedData.resize(sectorSize);
-        std::memcpy(compressedData.data(), pfsc.data() + sectorOffset, sectorSize);
+        if (sectorOffset + sectorSize <= pfsc.size()) {
+            std::memcpy(compressedData.data(), pfsc.data() + sectorOffset, sectorSize);
+        } else if (!ReadPfsImage(file, pfsc_offset + sectorOffset,
+                                 {reinterpret_cast<u8*>(compressedData.data()), sectorSize})) {
+            failreason = "Failed to read PFS metadata";
+            return false;
+        }
 
-        if (sectorSize == 0x10000) // Uncompressed data
-            std::memcpy(decompressedData.data(), compressedData.data(), 0x10000);
-        else if (sectorSize < 0x10000) // Compressed data
-            DecompressPFSC(compressedData, decompressedData);
+        if (!DecodePfscBlock(compressedData, decompressedData)) {
+            failreason = "Invalid PFSC block in the PFS metadata";
+            return false;
+        }
 
         if (i == 0) {
             std::memcpy(&ndinode, decompressedData.data() + 0x30, 4); // number of folders and files
+            fsTree.resize(ndinode);
+            fsInodes.reserve(ndinode);
         }
 
-        int occupied_blocks =
-            (ndinode * 0xA8) / 0x10000; // how many blocks(0x10000) are taken by iNodes.
-        if (((ndinode * 0xA8) % 0x10000) != 0)
-            occupied_blocks += 1;
+        // How many blocks(0x10000) are taken by iNodes. Inodes never straddle a block.
+        const u32 inodes_per_block = 0x10000 / 0xA8;
+        const u32 occupied_blocks = (ndinode + inodes_per_block - 1) / inodes_per_block;
 
         if (i >= 1 && i <= occupied_blocks) { // Get all iNodes, gives type, file size and location.
-            for (int p = 0; p < 0x10000; p += 0xA8) {
+            for (u32 p = 0; p < inodes_per_block * 0xA8; p += 0xA8) {
                 Inode node;
                 std::memcpy(&node, &decompressedData[p], sizeof(node));
                 if (node.Mode == 0) {
                     break;
                 }
-                iNodeBuf.push_back(node);
+                fsInodes.push_back({
+                    .size = static_cast<u64>(node.Size),
+                    .size_compressed = static_cast<u64>(node.SizeCompressed),
+                    .blocks = node.Blocks,
+                    .loc = node.loc,
+                    .flags = node.Flags,
+                    .mode = node.Mode,
+                });
             }
         }
 
@@ -337,29 +565,19 @@ bool PKG::Extract(const std::filesystem::path& filepath, const std::filesystem::
         }
 
         if (uroot_reached) {
-            for (int i = 0; i < 0x10000; i += ent_size) {
-                Dirent dirent;
-                std::memcpy(&dirent, &decompressedData[i], sizeof(dirent));
-                ent_size = dirent.entsize;
-                if (dirent.ino != 0) {
-                    ndinode_counter++;
-                } else {
-                    // Set the the folder according to the current inode.
-                    // Can be 2 or more (rarely)
-                    auto parent_path = extract_path.parent_path();
-                    auto title_id = GetTitleID();
-
-                    if (parent_path.filename() != title_id &&
-                        !fmt::UTF(extract_path.u8string()).data.ends_with("-patch")) {
-                        extractPaths[ndinode_counter] = parent_path / title_id;
-                    } else {
-                        // DLCs path has different structure
-                        extractPaths[ndinode_counter] = extract_path;
+            Dirent dirent;
+            for (u32 j = 0; ReadDirent(decompressedData, j, dirent); j += dirent.entsize) {
+                if (dirent.ino == 0) {
+                    // The inode following the superroot entries is the image root, it maps
+                    // straight to rootPath.
+                    if (ndinode_counter < fsTree.size()) {
+                        fsTree[ndinode_counter] = {.type = PFS_DIR};
                     }
-                    uroot_reached = false;
                     break;
                 }
+                ndinode_counter++;
             }
+            uroot_reached = false;
         }
 
         const char dot = decompressedData[0x10];
@@ -371,103 +589,616 @@ bool PKG::Extract(const std::filesystem::path& filepath, const std::filesystem::
         // Get folder and file names.
         bool end_reached = false;
         if (dinode_reached) {
-            for (int j = 0; j < 0x10000; j += ent_size) { // Skip the first parent and child.
-                Dirent dirent;
-                std::memcpy(&dirent, &decompressedData[j], sizeof(dirent));
-
+            Dirent dirent;
+            for (u32 j = 0; ReadDirent(decompressedData, j, dirent); j += ent_size) {
                 // Stop here and continue the main loop
                 if (dirent.ino == 0) {
                     break;
                 }
-
                 ent_size = dirent.entsize;
-                auto& table = fsTable.emplace_back();
-                table.name = std::string(dirent.name, dirent.namelen);
-                table.inode = dirent.ino;
-                table.type = dirent.type;
 
-                if (table.type == PFS_CURRENT_DIR) {
-                    current_dir = extractPaths[table.inode];
+                const u32 inode = dirent.ino;
+                if (dirent.type == PFS_CURRENT_DIR) {
+                    current_dir = inode;
+                    continue;
                 }
-                extractPaths[table.inode] = current_dir / std::filesystem::path(table.name);
-
-                if (table.type == PFS_FILE || table.type == PFS_DIR) {
-                    if (table.type == PFS_DIR) { // Create dirs.
-                        std::filesystem::create_directory(extractPaths[table.inode]);
-                    }
-                    ndinode_counter++;
-                    if ((ndinode_counter + 1) == ndinode) // 1 for the image itself (root).
-                        end_reached = true;
+                if ((dirent.type != PFS_FILE && dirent.type != PFS_DIR) || inode >= fsTree.size()) {
+                    continue;
                 }
+
+                fsTree[inode] = {
+                    .parent = current_dir,
+                    .name_offset = static_cast<u32>(fsNames.size()),
+                    .name_length = static_cast<u16>(dirent.namelen),
+                    .type = static_cast<u8>(dirent.type),
+                };
+                fsNames.append(dirent.name, dirent.namelen);
+                fsEntries.push_back(inode);
+
+                ndinode_counter++;
+                if ((ndinode_counter + 1) == ndinode) // 1 for the image itself (root).
+                    end_reached = true;
             }
             if (end_reached) {
                 break;
             }
         }
     }
+
+    SaveMetadataCache(file);
+    return true;
+}
+
+bool PKG::LoadMetadataCache(const Common::FS::IOFile& pkgFile) {
+    const auto id = GetMetadataCacheId(pkgpath);
+    const auto cache_path = GetMetadataCachePath(id);
+    std::error_code ec;
+    if (cache_path.empty() || !std::filesystem::exists(cache_path, ec)) {
+        return false;
+    }
+
+    Common::FS::IOFile file(cache_path, Common::FS::FileAccessMode::Read);
+    std::vector<u8> data(file.IsOpen() ? file.GetSize() : 0);
+    if (data.empty() || file.Read(data) != data.size()) {
+        return false;
+    }
+
+    Common::BinaryReader reader{data};
+    u32 magic = 0;
+    u32 version = 0;
+    std::string path;
+    u64 size = 0;
+    u64 mtime = 0;
+    std::array<u8, 32> digest;
+    std::array<u8, CachedKeysSize> keys;
+    if (!reader.Read(magic) || !reader.Read(version) || magic != PKG_METADATA_CACHE_MAGIC ||
+        version != PKG_METADATA_CACHE_VERSION || !reader.Read(path) || !reader.Read(size) ||
+        !reader.Read(mtime) || !reader.Read(digest) || !reader.Read(keys)) {
+        LOG_WARNING(Loader, "Ignoring invalid or outdated PKG metadata cache");
+        return false;
+    }
+    // A PKG that was replaced or modified since is parsed again, which rewrites the cache.
+    if (path != id || size != pkgSize || mtime != GetMtime(pkgpath) ||
+        !std::ranges::equal(digest, pkgheader.pkg_digest)) {
+        return false;
+    }
+
+    std::array<u8, 32> cache_key;
+    std::array<u8, CachedKeysSize> plain;
+    if (!GetMetadataCacheKey(pkgFile, cache_key)) {
+        return false;
+    }
+    PKG::crypto.aesCbcCfb128DecryptEntry(cache_key, keys, plain);
+    if (!std::all_of(plain.end() - 16, plain.end(), [](u8 b) { return b == 0; })) {
+        LOG_WARNING(Loader, "PKG metadata cache does not belong to this PKG");
+        return false;
+    }
+
+    // The tree is only trusted as a whole, the readers of fsTree and sectorMap index them freely.
+    std::array<u8, 32> payload_digest;
+    std::array<u8, 32> actual_digest;
+    std::vector<u8> payload;
+    if (!reader.Read(payload_digest) || !reader.Read(payload)) {
+        LOG_WARNING(Loader, "PKG metadata cache is truncated");
+        return false;
+    }
+    CryptoPP::SHA256().CalculateDigest(actual_digest.data(), payload.data(), payload.size());
+    if (actual_digest != payload_digest) {
+        LOG_WARNING(Loader, "PKG metadata cache is corrupted");
+        return false;
+    }
+
+    Common::BinaryReader payload_reader{payload};
+    u64 offset = 0;
+    std::vector<u64> sectors;
+    std::vector<PfsTreeNode> tree;
+    std::vector<PfsInode> inodes;
+    std::vector<u32> entries;
+    std::string names;
+    if (!payload_reader.Read(offset) || !payload_reader.Read(sectors) ||
+        !payload_reader.Read(tree) || !payload_reader.Read(inodes) ||
+        !payload_reader.Read(entries) || !payload_reader.Read(names)) {
+        LOG_WARNING(Loader, "PKG metadata cache is corrupted");
+        return false;
+    }
+
+    auto key_data = std::span<const u8>(plain);
+    std::memcpy(dk3_.data(), key_data.data(), dk3_.size());
+    key_data = key_data.subspan(dk3_.size());
+    std::memcpy(ekpfsKey.data(), key_data.data(), ekpfsKey.size());
+    key_data = key_data.subspan(ekpfsKey.size());
+    std::memcpy(dataKey.data(), key_data.data(), dataKey.size());
+    key_data = key_data.subspan(dataKey.size());
+    std::memcpy(tweakKey.data(), key_data.data(), tweakKey.size());
+    dk3Ready = true;
+
+    pfsc_offset = offset;
+    sectorMap = std::move(sectors);
+    fsTree = std::move(tree);
+    fsInodes = std::move(inodes);
+    fsEntries = std::move(entries);
+    fsNames = std::move(names);
+    return true;
+}
+
+void PKG::SaveMetadataCache(const Common::FS::IOFile& pkgFile) {
+    const auto id = GetMetadataCacheId(pkgpath);
+    const auto cache_path = GetMetadataCachePath(id);
+    std::array<u8, 32> cache_key;
+    if (cache_path.empty() || !GetMetadataCacheKey(pkgFile, cache_key)) {
+        return;
+    }
+
+    std::array<u8, CachedKeysSize> plain{};
+    auto key_data = std::span<u8>(plain);
+    std::memcpy(key_data.data(), dk3_.data(), dk3_.size());
+    key_data = key_data.subspan(dk3_.size());
+    std::memcpy(key_data.data(), ekpfsKey.data(), ekpfsKey.size());
+    key_data = key_data.subspan(ekpfsKey.size());
+    std::memcpy(key_data.data(), dataKey.data(), dataKey.size());
+    key_data = key_data.subspan(dataKey.size());
+    std::memcpy(key_data.data(), tweakKey.data(), tweakKey.size());
+    std::array<u8, CachedKeysSize> keys;
+    PKG::crypto.aesCbcCfb128EncryptEntry(cache_key, plain, keys);
+
+    std::array<u8, 32> digest;
+    std::ranges::copy(pkgheader.pkg_digest, digest.begin());
+
+    Common::BinaryWriter writer;
+    writer.Write(PKG_METADATA_CACHE_MAGIC);
+    writer.Write(PKG_METADATA_CACHE_VERSION);
+    writer.Write(id);
+    writer.Write(pkgSize);
+    writer.Write(GetMtime(pkgpath));
+    writer.Write(digest);
+    writer.Write(keys);
+
+    Common::BinaryWriter payload;
+    payload.Write(pfsc_offset);
+    payload.Write(sectorMap);
+    payload.Write(fsTree);
+    payload.Write(fsInodes);
+    payload.Write(fsEntries);
+    payload.Write(fsNames);
+    std::array<u8, 32> payload_digest;
+    CryptoPP::SHA256().CalculateDigest(payload_digest.data(), payload.Data().data(),
+                                       payload.Data().size());
+    writer.Write(payload_digest);
+    writer.Write(payload.Data());
+
+    // Write to a temporary file first so an interrupted save never leaves a torn cache.
+    std::error_code ec;
+    std::filesystem::create_directories(cache_path.parent_path(), ec);
+    auto temp_path = cache_path;
+    temp_path += ".tmp";
+    if (Common::FS::IOFile::WriteBytes(temp_path, writer.Data()) != writer.Data().size()) {
+        LOG_WARNING(Loader, "Failed to write the PKG metadata cache {}",
+                    Common::FS::PathToUTF8String(cache_path));
+        return;
+    }
+    std::filesystem::rename(temp_path, cache_path, ec);
+}
+
+bool PKG::GetMetadataCacheKey(const Common::FS::IOFile& pkgFile, std::array<u8, 32>& key) const {
+    const auto find = [this](u32 id) {
+        return std::ranges::find(pkgEntries, id, [](const PKGEntry& e) { return u32(e.id); });
+    };
+    const auto entry_keys = find(0x10);
+    const auto image_key = find(0x20);
+    std::array<u8, 32 + 7 * 32 + 7 * 256> entry_keys_data;
+    std::array<u8, 256> image_key_data;
+    if (entry_keys == pkgEntries.end() || image_key == pkgEntries.end() ||
+        !pkgFile.Seek(entry_keys->offset) ||
+        pkgFile.Read(entry_keys_data) != entry_keys_data.size() ||
+        !pkgFile.Seek(image_key->offset) || pkgFile.Read(image_key_data) != image_key_data.size()) {
+        return false;
+    }
+    CryptoPP::SHA256 sha256;
+    sha256.Update(entry_keys_data.data(), entry_keys_data.size());
+    sha256.Update(image_key_data.data(), image_key_data.size());
+    sha256.Final(key.data());
     return true;
 }
 
+void PKG::CreateDirectories() const {
+    // Directories are listed before their contents, so parents are always created first.
+#ifdef _WIN32
+    for (const u32 inode : fsEntries) {
+        if (fsTree[inode].type == PFS_DIR) {
+            std::filesystem::create_directory(GetNodePath(inode));
+        }
+    }
+#else
+    // Siblings are listed together, so keep the parent open and create them relative to it
+    // instead of resolving the full path for every directory.
+    u32 open_dir = PFS_INVALID_NODE;
+    int dir_fd = -1;
+    for (const u32 inode : fsEntries) {
+        const auto& node = fsTree[inode];
+        if (node.type != PFS_DIR) {
+            continue;
+        }
+        if (dir_fd < 0 || node.parent != open_dir) {
+            if (dir_fd >= 0) {
+                ::close(dir_fd);
+            }
+            open_dir = node.parent;
+            dir_fd = OpenDirectory(GetNodePath(open_dir));
+        }
+        const std::string name{GetNodeName(inode)};
+        if (dir_fd < 0 || (::mkdirat(dir_fd, name.c_str(), 0755) != 0 && errno != EEXIST)) {
+            LOG_ERROR(Loader, "Failed to create directory {}",
+                      Common::FS::PathToUTF8String(GetNodePath(inode)));
+        }
+    }
+    if (dir_fd >= 0) {
+        ::close(dir_fd);
+    }
+#endif
+}
+
+std::filesystem::path PKG::GetNodePath(u32 inode) const {
+    // Collect the names up to the root, then join them from the top down.
+    std::vector<u32> chain;
+    for (u32 node = inode; node < fsTree.size() && fsTree[node].name_length != 0;
+         node = fsTree[node].parent) {
+        chain.push_back(node);
+        if (chain.size() > fsTree.size()) { // Corrupted tree with a cycle.
+            break;
+        }
+    }
+    auto path = rootPath;
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        path /= GetNodeName(*it);
+    }
+    return path;
+}
+
+std::string_view PKG::GetNodeName(u32 inode) const {
+    const auto& node = fsTree[inode];
+    return std::string_view(fsNames).substr(node.name_offset, node.name_length);
+}
+
+std::filesystem::path PKG::GetFilePath(int index) const {
+    return GetNodePath(fsEntries[index]);
+}
+
+std::pair<u64, u64> PKG::GetFileImageRange(int index) const {
+    const u32 inode = fsEntries[index];
+    if (fsTree[inode].type != PFS_FILE || inode >= fsInodes.size()) {
+        return {0, 0};
+    }
+    const PfsInode& node = fsInodes[inode];
+    const u64 end = u64{node.loc} + node.blocks;
+    if (node.blocks == 0 || end >= sectorMap.size()) {
+        return {0, 0};
+    }
+    return {pfsc_offset + sectorMap[node.loc], pfsc_offset + sectorMap[end]};
+}
+
 void PKG::ExtractFiles(const int index) {
-    int inode_number = fsTable[index].inode;
-    int inode_type = fsTable[index].type;
-    std::string inode_name = fsTable[index].name;
-
-    if (inode_type == PFS_FILE) {
-        int sector_loc = iNodeBuf[inode_number].loc;
-        int nblocks = iNodeBuf[inode_number].Blocks;
-        int bsize = iNodeBuf[inode_number].Size;
-
-        Common::FS::IOFile inflated;
-        inflated.Open(extractPaths[inode_number], Common::FS::FileAccessMode::Write);
-
-        Common::FS::IOFile pkgFile; // Open the file for each iteration to avoid conflict.
-        pkgFile.Open(pkgpath, Common::FS::FileAccessMode::Read);
-
-        int size_decompressed = 0;
-        std::vector<char> compressedData;
-        std::vector<char> decompressedData(0x10000);
-
-        u64 pfsc_buf_size = 0x11000; // extra 0x1000
-        std::vector<u8> pfsc(pfsc_buf_size);
-        std::vector<u8> pfs_decrypted(pfsc_buf_size);
-
-        for (int j = 0; j < nblocks; j++) {
-            u64 sectorOffset =
-                sectorMap[sector_loc + j]; // offset into PFSC_image and not pfs_image.
-            u64 sectorSize = sectorMap[sector_loc + j + 1] -
-                             sectorOffset; // indicates if data is compressed or not.
-            u64 fileOffset = (pkgheader.pfs_image_offset + pfsc_offset + sectorOffset);
-            u64 currentSector1 =
-                (pfsc_offset + sectorOffset) / 0x1000; // block size is 0x1000 for xts decryption.
-
-            int sectorOffsetMask = (sectorOffset + pfsc_offset) & 0xFFFFF000;
-            int previousData = (sectorOffset + pfsc_offset) - sectorOffsetMask;
-
-            pkgFile.Seek(fileOffset - previousData);
-            pkgFile.Read(pfsc);
-
-            PKG::crypto.decryptPFS(dataKey, tweakKey, pfsc, pfs_decrypted, currentSector1);
-
-            compressedData.resize(sectorSize);
-            std::memcpy(compressedData.data(), pfs_decrypted.data() + previousData, sectorSize);
-
-            if (sectorSize == 0x10000) // Uncompressed data
-                std::memcpy(decompressedData.data(), compressedData.data(), 0x10000);
-            else if (sectorSize < 0x10000) // Compressed data
-                DecompressPFSC(compressedData, decompressedData);
-
-            size_decompressed += 0x10000;
-
-            if (j < nblocks - 1) {
-                inflated.WriteRaw<u8>(decompressedData.data(), decompressedData.size());
-            } else {
-                // This is to remove the zeros at the end of the file.
-                const u32 write_size = decompressedData.size() - (size_decompressed - bsize);
-                inflated.WriteRaw<u8>(decompressedData.data(), write_size);
+    const u32 inode_number = fsEntries[index];
+    if (fsTree[inode_number].type != PFS_FILE || inode_number >= fsInodes.size()) {
+        return;
+    }
+
+    Common::FS::IOFile inflated;
+    inflated.Open(GetNodePath(inode_number), Common::FS::FileAccessMode::Write);
+
+    Common::FS::IOFile pkgFile; // Open the file for each iteration to avoid conflict.
+    pkgFile.Open(pkgpath, Common::FS::FileAccessMode::Read);
+
+    InflateFile(inode_number, pkgFile, [&](std::span<const char> data) {
+        return inflated.WriteSpan(data) == data.size();
+    });
+}
+
+u32 PKG::ExtractFiles(std::span<const int> indices, u32 num_threads, ExtractProgress* progress) {
+    // Group the files by parent directory so each batch resolves its directory only once.
+    std::vector<int> files;
+    files.reserve(indices.size());
+    for (const int index : indices) {
+        const u32 inode = fsEntries[index];
+        if (fsTree[inode].type == PFS_FILE && inode < fsInodes.size()) {
+            files.push_back(index);
+        }
+    }
+    const auto parent_of = [this](int index) { return fsTree[fsEntries[index]].parent; };
+    std::ranges::stable_sort(files, {}, parent_of);
+
+    // Large directories are split up so they still spread across threads.
+    static constexpr size_t MaxBatchSize = 256;
+    std::vector<std::span<const int>> batches;
+    for (size_t begin = 0; begin < files.size();) {
+        size_t end = begin + 1;
+        while (end < files.size() && end - begin < MaxBatchSize &&
+               parent_of(files[end]) == parent_of(files[begin])) {
+            end++;
+        }
+        batches.emplace_back(files.data() + begin, end - begin);
+        begin = end;
+    }
+    std::atomic<u32> failed{0};
+    Common::ParallelFor(
+        batches.size(), num_threads,
+        [&](u32) { return Common::FS::IOFile(pkgpath, Common::FS::FileAccessMode::Read); },
+        [&](Common::FS::IOFile& pkgFile, size_t n) {
+            if (progress && progress->cancel) {
+                failed += static_cast<u32>(batches[n].size());
+                return;
             }
+            failed += ExtractBatch(batches[n], pkgFile, progress);
+        });
+    return failed;
+}
+
+u32 PKG::ExtractBatch(std::span<const int> batch, const Common::FS::IOFile& pkgFile,
+                      ExtractProgress* progress) {
+    if (!pkgFile.IsOpen()) {
+        return static_cast<u32>(batch.size());
+    }
+
+    // Counts written bytes and aborts the current file once cancellation is requested.
+    const auto track = [progress](std::span<const char> data, bool written) {
+        if (progress) {
+            progress->bytes_written += data.size();
+            return written && !progress->cancel;
+        }
+        return written;
+    };
+
+    u32 failed = 0;
+#ifdef _WIN32
+    for (const int index : batch) {
+        const u32 inode = fsEntries[index];
+        if (replaceFiles) {
+            std::error_code ec;
+            std::filesystem::remove(GetNodePath(inode), ec);
+        }
+        Common::FS::IOFile out(GetNodePath(inode), Common::FS::FileAccessMode::Write);
+        if (!out.IsOpen() || !InflateFile(inode, pkgFile, [&](std::span<const char> data) {
+                return track(data, out.WriteSpan(data) == data.size());
+            })) {
+            failed++;
+        } else if (progress) {
+            progress->files_done++;
+        }
+    }
+#else
+    const auto dir_path = GetNodePath(fsTree[fsEntries[batch.front()]].parent);
+    const int dir_fd = OpenDirectory(dir_path);
+    if (dir_fd < 0) {
+        LOG_ERROR(Loader, "Failed to open directory {}", Common::FS::PathToUTF8String(dir_path));
+        return static_cast<u32>(batch.size());
+    }
+    for (const int index : batch) {
+        const u32 inode = fsEntries[index];
+        const std::string name{GetNodeName(inode)};
+        if (replaceFiles) {
+            // The old file may be a hard link into the base tree, give the new data its own inode.
+            ::unlinkat(dir_fd, name.c_str(), 0);
+        }
+        const int fd = ::openat(dir_fd, name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            LOG_ERROR(Loader, "Failed to create {}", Common::FS::PathToUTF8String(dir_path / name));
+            failed++;
+            continue;
+        }
+        if (!InflateFile(inode, pkgFile, [&](std::span<const char> data) {
+                return track(data, WriteAll(fd, data));
+            })) {
+            failed++;
+        } else if (progress) {
+            progress->files_done++;
+        }
+        ::close(fd);
+    }
+    ::close(dir_fd);
+#endif
+    return failed;
+}
+
+bool PKG::ReadPfsImage(const Common::FS::IOFile& pkgFile, u64 offset, std::span<u8> out) {
+    // XTS works on 0x1000 byte sectors, so widen the read to whole sectors.
+    const u64 begin = Common::AlignDown(offset, 0x1000);
+    const u64 end = Common::AlignUp(offset + out.size(), 0x1000);
+    std::vector<u8> encrypted(end - begin);
+    std::vector<u8> decrypted(end - begin);
+    if (!pkgFile.Seek(pkgheader.pfs_image_offset + begin) ||
+        pkgFile.Read(encrypted) != encrypted.size()) {
+        return false; // Truncated PKG, do not decrypt whatever is left in the buffer.
+    }
+    PKG::crypto.decryptPFS(dataKey, tweakKey, encrypted, decrypted, begin / 0x1000);
+    std::memcpy(out.data(), decrypted.data() + (offset - begin), out.size());
+    return true;
+}
+
+bool PKG::InflateFile(u32 inode, const Common::FS::IOFile& pkgFile,
+                      const std::function<bool(std::span<const char>)>& write) {
+    const u64 sector_loc = fsInodes[inode].loc;
+    const u64 nblocks = fsInodes[inode].blocks;
+    u64 remaining = fsInodes[inode].size;
+    if (sector_loc + nblocks >= sectorMap.size()) {
+        LOG_ERROR(Loader, "Inode {} points outside of the PFSC sector map", inode);
+        return false;
+    }
+
+    // Blocks are streamed one at a time.
+    BlockScratch scratch;
+    std::vector<char> decompressedData(0x10000);
+    for (u64 j = 0; j < nblocks && remaining != 0; j++) {
+        if (!ReadBlock(sector_loc + j, pkgFile, scratch, decompressedData)) {
+            LOG_ERROR(Loader, "Invalid PFSC block {} of inode {}", sector_loc + j, inode);
+            return false;
+        }
+
+        // The last block is zero padded past the end of the file.
+        const u64 write_size = std::min<u64>(remaining, decompressedData.size());
+        if (!write(std::span(decompressedData).first(write_size))) {
+            return false;
         }
-        pkgFile.Close();
-        inflated.Close();
+        remaining -= write_size;
     }
+    return true;
+}
+
+bool PKG::ReadCompressedBlock(u64 block, const Common::FS::IOFile& pkgFile,
+                              BlockScratch& scratch) {
+    const u64 sectorOffset = sectorMap[block]; // offset into PFSC_image.
+    const u64 sectorSize = sectorMap[block + 1] - sectorOffset; // indicates if data is compressed.
+    if (sectorMap[block + 1] < sectorOffset || sectorSize > 0x10000) {
+        return false;
+    }
+
+    // A compressed block can start anywhere inside its first 0x1000 byte XTS sector, only the
+    // sectors it actually covers are read and decrypted.
+    const u64 imageOffset = pfsc_offset + sectorOffset; // offset into pfs_image.
+    const u64 currentSector = imageOffset / 0x1000; // block size is 0x1000 for xts decryption.
+    const u64 previousData = imageOffset & 0xFFF;
+    const u64 readSize = Common::AlignUp(previousData + sectorSize, 0x1000);
+
+    scratch.encrypted.resize(readSize);
+    scratch.decrypted.resize(readSize);
+    if (!pkgFile.Seek(pkgheader.pfs_image_offset + imageOffset - previousData) ||
+        pkgFile.Read(scratch.encrypted) != scratch.encrypted.size()) {
+        return false; // Truncated PKG, the block would be decrypted from stale data.
+    }
+
+    PKG::crypto.decryptPFS(dataKey, tweakKey, scratch.encrypted, scratch.decrypted, currentSector);
+
+    scratch.compressed.resize(sectorSize);
+    std::memcpy(scratch.compressed.data(), scratch.decrypted.data() + previousData, sectorSize);
+    return true;
+}
+
+bool PKG::ReadBlock(u64 block, const Common::FS::IOFile& pkgFile, BlockScratch& scratch,
+                    std::span<char> out) {
+    return ReadCompressedBlock(block, pkgFile, scratch) &&
+           DecodePfscBlock(scratch.compressed, out.first(0x10000));
+}
+
+bool PKG::ReadFileBlock(int index, u64 block, const Common::FS::IOFile& pkgFile,
+                        std::span<char> out) {
+    const u32 inode = fsEntries[index];
+    if (fsTree[inode].type != PFS_FILE || inode >= fsInodes.size()) {
+        return false;
+    }
+    const auto& node = fsInodes[inode];
+    if (block >= node.blocks || u64{node.loc} + node.blocks >= sectorMap.size()) {
+        return false;
+    }
+    BlockScratch scratch;
+    return ReadBlock(node.loc + block, pkgFile, scratch, out);
+}
+
+u64 PKG::GetFileSize(int index) const {
+    const u32 inode = fsEntries[index];
+    return inode < fsInodes.size() ? fsInodes[inode].size : 0;
+}
+
+bool PKG::IsFile(int index) const {
+    const u32 inode = fsEntries[index];
+    return fsTree[inode].type == PFS_FILE && inode < fsInodes.size();
+}
+
+bool PKG::IsDirectory(int index) const {
+    return fsTree[fsEntries[index]].type == PFS_DIR;
+}
+
+u64 PKG::GetTotalSize(std::span<const int> indices) const {
+    u64 total = 0;
+    for (const int index : indices) {
+        const u32 inode = fsEntries[index];
+        if (fsTree[inode].type == PFS_FILE && inode < fsInodes.size()) {
+            total += fsInodes[inode].size;
+        }
+    }
+    return total;
+}
+
+u32 PKG::CountFiles(std::span<const int> indices) const {
+    return static_cast<u32>(std::ranges::count_if(indices, [this](int index) {
+        const u32 inode = fsEntries[index];
+        return fsTree[inode].type == PFS_FILE && inode < fsInodes.size();
+    }));
+}
+
+std::string PKG::GetRelativePath(int index) const {
+    std::string path;
+    u32 depth = 0;
+    for (u32 node = fsEntries[index]; node < fsTree.size() && fsTree[node].name_length != 0 &&
+                                      depth++ < fsTree.size(); // Corrupted tree with a cycle.
+         node = fsTree[node].parent) {
+        if (!path.empty()) {
+            path.insert(0, 1, '/');
+        }
+        path.insert(0, GetNodeName(node));
+    }
+    return path;
+}
+
+int PKG::FindFile(std::string_view relative_path) const {
+    for (int i = 0; i < static_cast<int>(fsEntries.size()); i++) {
+        if (fsTree[fsEntries[i]].type == PFS_FILE && GetRelativePath(i) == relative_path) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+PkgFileReader::PkgFileReader(PKG& pkg_, int index_)
+    : pkg{pkg_}, index{index_}, pkgFile{pkg_.pkgpath, Common::FS::FileAccessMode::Read},
+      block(0x10000) {}
+
+bool PkgFileReader::Read(u64 offset, std::span<u8> out) {
+    if (offset > GetSize() || out.size() > GetSize() - offset) {
+        return false;
+    }
+    while (!out.empty()) {
+        const u64 n = offset / block.size();
+        if (n != cached_block) {
+            if (!pkg.ReadFileBlock(index, n, pkgFile, block)) {
+                cached_block = ~0ULL; // The buffer may hold part of the failed block.
+                return false;
+            }
+            cached_block = n;
+            blocks_read++;
+        }
+        const u64 block_offset = offset % block.size();
+        const u64 size = std::min<u64>(out.size(), block.size() - block_offset);
+        std::memcpy(out.data(), block.data() + block_offset, size);
+        out = out.subspan(size);
+        offset += size;
+    }
+    return true;
+}
+
+u64 PkgFileReader::GetSize() const {
+    return pkg.GetFileSize(index);
+}
+
+PfscBlockReader::PfscBlockReader(PKG& pkg_)
+    : pkg{pkg_}, pkgFile{pkg_.pkgpath, Common::FS::FileAccessMode::Read} {}
+
+bool PfscBlockReader::Read(int index, u64 block, PfscBlock& out) {
+    if (!pkg.IsFile(index)) {
+        return false;
+    }
+    const auto& node = pkg.fsInodes[pkg.fsEntries[index]];
+    if (block >= node.blocks || u64{node.loc} + node.blocks >= pkg.sectorMap.size() ||
+        !pkg.ReadCompressedBlock(node.loc + block, pkgFile, scratch)) {
+        return false;
+    }
+
+    const auto& stored = scratch.compressed;
+    out.size = std::min<u64>(0x10000, node.size - std::min<u64>(node.size, block * 0x10000));
+    out.compressed = !stored.empty() && stored.size() < 0x10000;
+    if (out.compressed) {
+        out.data.assign(stored.begin(), stored.end());
+    } else if (stored.empty()) { // Sparse block, reads back as zeros.
+        out.data.assign(out.size, 0);
+    } else {
+        out.data.assign(stored.begin(), stored.begin() + out.size);
+    }
+    return true;
 }
@@ -3,12 +3,16 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <filesystem>
+#include <functional>
+#include <span>
 #include <string>
-#include <unordered_map>
 #include <vector>
 #include "common/endian.h"
+#include "common/io_file.h"
 #include "core/crypto/crypto.h"
 #include "pfs.h"
 #include "trp.h"
@@ -98,6 +102,25 @@ struct PKGEntry {
 };
 static_assert(sizeof(PKGEntry) == 32);
 
+/// Shared state of a running extraction. Workers update it as data is written, other threads may
+/// poll it and request cancellation at any time.
+struct ExtractProgress {
+    std::atomic<u64> bytes_written{0};
+    std::atomic<u32> files_done{0};
+    std::atomic<bool> cancel{false};
+};
+
+/// Sidecar of a PKG holding what LoadImage derives and parses, see Config::getPkgMetadataCacheDir.
+constexpr u32 PKG_METADATA_CACHE_MAGIC = 0x444D4B50; // "PKMD"
+constexpr u32 PKG_METADATA_CACHE_VERSION = 2;
+
+/// A data block of a file as stored in the PFSC image, decrypted but still deflated.
+struct PfscBlock {
+    std::vector<u8> data; // zlib stream when compressed, otherwise the bytes of the file.
+    u64 size = 0;         // Bytes of the file in the block once inflated.
+    bool compressed = false;
+};
+
 class PKG {
 public:
     PKG();
@@ -105,15 +128,70 @@ public:
 
     bool Open(const std::filesystem::path& filepath, std::string& failreason);
     void ExtractFiles(const int index);
+
+    /// Extracts the given entries grouped by directory and spread across worker threads. Files
+    /// are created relative to an open handle of their directory. Returns the number of failures.
+    u32 ExtractFiles(std::span<const int> indices, u32 num_threads = 0,
+                     ExtractProgress* progress = nullptr);
     bool Extract(const std::filesystem::path& filepath, const std::filesystem::path& extract,
                  std::string& failreason);
 
+    /// Like Extract, but applies the PKG (usually a patch) onto an existing tree at target.
+    /// ExtractFiles then only writes the files the PKG contains, each as a new file replacing the
+    /// old one, so hard linked copies of a base extraction are never written through.
+    bool ExtractOver(const std::filesystem::path& filepath, const std::filesystem::path& target,
+                     std::string& failreason);
+
+    /// Reads the data of an entry table entry, NP entries (0x400-0x403) are decrypted.
+    /// Only requires Open, nothing is written to disk.
+    bool ReadEntry(u32 id, std::vector<u8>& data, std::string& failreason);
+
+    bool HasEntry(u32 id) const {
+        return std::ranges::any_of(pkgEntries, [id](const PKGEntry& e) { return e.id == id; });
+    }
+
     std::vector<u8> sfo;
 
     u32 GetNumberOfFiles() {
-        return fsTable.size();
+        return fsEntries.size();
     }
 
+    /// Returns the output path of a file or directory, built from the directory tree.
+    std::filesystem::path GetFilePath(int index) const;
+
+    /// Returns the path of a file or directory inside the PFS image, e.g. "sce_module/libc.prx".
+    std::string GetRelativePath(int index) const;
+
+    /// Returns the index of the file at the given PFS path, or -1.
+    int FindFile(std::string_view relative_path) const;
+
+    u64 GetFileSize(int index) const;
+
+    bool IsFile(int index) const;
+    bool IsDirectory(int index) const;
+
+    /// Entry table of the PKG, sce_sys files are the entries with an id from 0x400 up.
+    std::span<const PKGEntry> GetEntries() const {
+        return pkgEntries;
+    }
+
+    /// Returns the number of bytes ExtractFiles writes for the given entries.
+    u64 GetTotalSize(std::span<const int> indices) const;
+
+    /// Returns how many of the given entries are files rather than directories.
+    u32 CountFiles(std::span<const int> indices) const;
+
+    /// Decrypts and inflates block n (0x10000 bytes) of a file. Requires Extract or Mount.
+    bool ReadFileBlock(int index, u64 block, const Common::FS::IOFile& pkgFile,
+                       std::span<char> out);
+
+    /// Derives the keys and parses the PFS directory tree without writing anything to disk, for
+    /// random access to single files.
+    bool Mount(const std::filesystem::path& filepath, std::string& failreason);
+
+    /// Returns the [begin, end) byte range a file's data occupies inside the PFS image.
+    std::pair<u64, u64> GetFileImageRange(int index) const;
+
     u64 GetPkgSize() {
         return pkgSize;
     }
@@ -147,16 +225,62 @@ public:
          {PKGContentFlag::CUMULATIVE_PATCH, "CUMULATIVE_PATCH"}}};
 
 private:
+    friend class PkgFileReader;
+    friend class PfscBlockReader;
+
     Crypto crypto;
     TRP trp;
     u64 pkgSize = 0;
     char pkgTitleID[9];
     PKGHeader pkgheader;
     std::string pkgFlags;
+    std::vector<PKGEntry> pkgEntries;
+    bool dk3Ready = false;
 
-    std::unordered_map<int, std::filesystem::path> extractPaths;
-    std::vector<pfs_fs_table> fsTable;
-    std::vector<Inode> iNodeBuf;
+    void DecryptNpEntry(const PKGEntry& entry, std::span<u8> data, std::vector<u8>& out);
+
+    std::filesystem::path GetNodePath(u32 inode) const;
+    std::string_view GetNodeName(u32 inode) const;
+    void CreateDirectories() const;
+    u32 ExtractBatch(std::span<const int> batch, const Common::FS::IOFile& pkgFile,
+                     ExtractProgress* progress);
+
+    struct BlockScratch {
+        std::vector<u8> encrypted;
+        std::vector<u8> decrypted;
+        std::vector<char> compressed;
+    };
+
+    bool LoadImage(const std::filesystem::path& filepath, std::string& failreason,
+                   bool write_sce_sys);
+
+    /// Restores the keys, sector map and PFS tree from the metadata cache if it was written for
+    /// this very PKG file, skipping the RSA decryptions and the walk of the PFS metadata.
+    bool LoadMetadataCache(const Common::FS::IOFile& pkgFile);
+    void SaveMetadataCache(const Common::FS::IOFile& pkgFile);
+
+    /// The cached keys are encrypted with a key hashed from the ENTRY_KEYS and IMAGE_KEY entries,
+    /// so they are of no use without the PKG they came from.
+    bool GetMetadataCacheKey(const Common::FS::IOFile& pkgFile, std::array<u8, 32>& key) const;
+    bool ReadBlock(u64 block, const Common::FS::IOFile& pkgFile, BlockScratch& scratch,
+                   std::span<char> out);
+
+    /// Reads and decrypts block n of the PFSC image into scratch.compressed without inflating it.
+    /// A block of 0x10000 bytes is stored uncompressed.
+    bool ReadCompressedBlock(u64 block, const Common::FS::IOFile& pkgFile, BlockScratch& scratch);
+
+    /// Reads and decrypts [offset, offset + out.size()) of the PFS image.
+    bool ReadPfsImage(const Common::FS::IOFile& pkgFile, u64 offset, std::span<u8> out);
+
+    /// Decrypts and inflates the data blocks of a file, passing the output to write in order.
+    bool InflateFile(u32 inode, const Common::FS::IOFile& pkgFile,
+                     const std::function<bool(std::span<const char>)>& write);
+
+    std::vector<u32> fsEntries; // Inode numbers of files and directories in PFS order.
+    std::vector<PfsTreeNode> fsTree;
+    std::vector<PfsInode> fsInodes;
+    std::string fsNames;
+    std::filesystem::path rootPath;
     std::vector<u64> sectorMap;
     u64 pfsc_offset;
 
@@ -169,6 +293,43 @@ private:
     std::vector<u8> decNp;
 
     std::filesystem::path pkgpath;
-    std::filesystem::path current_dir;
     std::filesystem::path extract_path;
+    bool replaceFiles = false; // Unlink existing files before writing, set by ExtractOver.
+};
+
+/// Random access to a single file inside the PFS image of a mounted PKG. Only the blocks covering
+/// a read are decrypted and inflated, the most recent one is kept for follow-up reads.
+class PkgFileReader {
+public:
+    PkgFileReader(PKG& pkg, int index);
+
+    bool Read(u64 offset, std::span<u8> out);
+    u64 GetSize() const;
+
+    u64 GetBlocksRead() const {
+        return blocks_read;
+    }
+
+private:
+    PKG& pkg;
+    int index;
+    Common::FS::IOFile pkgFile;
+    std::vector<char> block;
+    u64 cached_block = ~0ULL;
+    u64 blocks_read = 0;
+};
+
+/// Reads the data blocks of files without inflating them, so writers of other deflate based
+/// formats can copy the zlib streams as they are instead of inflating and deflating every block.
+class PfscBlockReader {
+public:
+    explicit PfscBlockReader(PKG& pkg);
+
+    /// Decrypts block n (0x10000 bytes once inflated) of a file. Requires Extract or Mount.
+    bool Read(int index, u64 block, PfscBlock& out);
+
+private:
+    PKG& pkg;
+    Common::FS::IOFile pkgFile;
+    PKG::BlockScratch scratch;
 };
@@ -0,0 +1,664 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "common/alignment.h"
+#include "common/io_file.h"
+#include "common/logging/log.h"
+#include "common/parallel_for.h"
+#include "common/path_util.h"
+#include "core/crypto/crypto.h"
+#include "core/file_format/pfs.h"
+#include "core/file_format/pfsc.h"
+#include "core/file_format/pkg.h"
+#include "core/file_format/pkg_builder.h"
+#include "core/file_format/pkg_type.h"
+#include "core/file_format/psf.h"
+
+namespace {
+
+constexpr u32 PkgMagic = 0x7F434E54;
+constexpr u32 PfscMagic = 0x43534650;
+constexpr s64 PfsMagic = 20130315;
+
+constexpr u64 BlockSize = PFSC_BLOCK_SIZE;
+constexpr u64 SectorSize = 0x1000; // XTS sector.
+constexpr u32 InodeSize = 0xA8;    // On-disk stride, the fields of Inode only fill the start.
+constexpr u32 InodesPerBlock = BlockSize / InodeSize;
+constexpr u32 MaxNameLength = 255;
+
+constexpr u64 EncryptedStart = 0x10000; // The PFS header holding the seed stays in the clear.
+constexpr u64 PfscStart = 0x20000;      // First offset PKG::LoadImage looks for the PFSC header.
+constexpr u64 SectorMapOffset = 0x400;
+constexpr u64 WindowBlocks = 512;         // Blocks compressed and encrypted per pass.
+constexpr u64 EncryptChunkSize = 0x40000; // Unit of work when encrypting a window.
+
+constexpr u32 EntryTableOffset = 0x2000;
+constexpr u32 DigestsEntry = 0x1;
+constexpr u32 EntryKeysEntry = 0x10;
+constexpr u32 ImageKeyEntry = 0x20;
+constexpr u32 ParamSfoEntry = 0x1000;
+constexpr u32 EntryKeysSize = 32 + 7 * 32 + 7 * 256; // Seed digest, digests and keys.
+constexpr u32 Dk3KeyOffset = 32 + 7 * 32 + 3 * 256;  // DK3 is the fourth key.
+constexpr u32 EntryEncrypted = 0x80000000;           // flags1
+constexpr u32 EntryKeyIndexDk3 = 3 << 12;            // flags2
+
+static_assert(offsetof(PSFHeader_, dinode_count) == 0x30, "PKG::LoadImage reads it at 0x30");
+
+struct PackNode {
+    std::filesystem::path path; // Empty for the nodes that only exist in the image.
+    std::string name;
+    u32 parent = 0;
+    bool is_dir = false;
+    bool in_sce_sys = false;
+    u64 size = 0;
+    u32 loc = 0; // First block of the file data, or of the entries of a directory.
+    u32 blocks = 0;
+    std::vector<u32> children;
+};
+
+/// Inode 0 is the superroot, 1 the flat path table and 2 the root of the packed tree, the rest
+/// follow in breadth first order. Metadata blocks come first, then the file data in inode order.
+struct PfsLayout {
+    std::vector<PackNode> nodes;
+    std::vector<u32> data_files; // Files with at least one block, sorted by first block.
+    std::vector<std::vector<u8>> metadata;
+    u64 num_blocks = 0;
+};
+
+struct PackEntry {
+    u32 id;
+    std::vector<u8> data;
+    u32 offset = 0;
+};
+
+struct PfsKeys {
+    std::array<u8, 16> seed;
+    std::array<u8, 16> data_key;
+    std::array<u8, 16> tweak_key;
+};
+
+struct ImageInfo {
+    u64 size = 0;
+    u64 metadata_end = 0; // Image offset where the file data starts.
+    u64 compressed_blocks = 0;
+};
+
+bool IsNpEntry(u32 id) {
+    return id >= 0x400 && id <= 0x403;
+}
+
+/// Maps a path below sce_sys to its entry id, or 0. Entries without a name are extracted under
+/// their decimal id, so those names are recognized as well.
+u32 GetEntryId(std::string_view name) {
+    u32 id = 0;
+    const auto [end, ec] = std::from_chars(name.data(), name.data() + name.size(), id);
+    if (ec == std::errc{} && end == name.data() + name.size()) {
+        return id;
+    }
+    return GetEntryTypeByName(name);
+}
+
+std::array<u8, 32> Sha256(std::span<const u8> data) {
+    std::array<u8, 32> digest;
+    CryptoPP::SHA256().CalculateDigest(digest.data(), data.data(), data.size());
+    return digest;
+}
+
+struct PackWorker {
+    explicit PackWorker(int level) : compressor{level} {}
+
+    PfscCompressor compressor;
+    std::vector<u8> block = std::vector<u8>(BlockSize);
+    u32 open_node = PFS_INVALID_NODE;
+    Common::FS::IOFile file;
+};
+
+/// Walks the source tree breadth first, in the order inodes are numbered. Files below sce_sys
+/// with an entry name go to the entry table instead of the image.
+bool CollectTree(const std::filesystem::path& source_dir, PfsLayout& layout,
+                 std::vector<PackEntry>& entries, std::string& failreason) {
+    auto& nodes = layout.nodes;
+    nodes.resize(3);
+    nodes[0] = {.is_dir = true};
+    nodes[1] = {.name = "flat_path_table"};
+    nodes[2] = {.path = source_dir, .name = "uroot", .parent = 2, .is_dir = true};
+
+    const auto sce_sys = source_dir / "sce_sys";
+    std::error_code ec;
+    for (u32 dir = 2; dir < nodes.size(); dir++) {
+        if (!nodes[dir].is_dir) {
+            continue;
+        }
+        std::vector<std::filesystem::directory_entry> listing;
+        for (auto it = std::filesystem::directory_iterator(nodes[dir].path, ec);
+             !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+            listing.push_back(*it);
+        }
+        if (ec) {
+            failreason = fmt::format("Failed to list {}: {}",
+                                     Common::FS::PathToUTF8String(nodes[dir].path), ec.message());
+            return false;
+        }
+        std::ranges::sort(listing);
+
+        for (const auto& entry : listing) {
+            const bool is_dir = entry.is_directory(ec);
+            if (!is_dir && !entry.is_regular_file(ec)) {
+                continue;
+            }
+            const bool in_sce_sys =
+                nodes[dir].in_sce_sys || (dir == 2 && entry.path().filename() == "sce_sys");
+
+            if (!is_dir && in_sce_sys) {
+                const auto name = entry.path().lexically_relative(sce_sys).generic_string();
+                if (const u32 id = GetEntryId(name); id != 0) {
+                    // Lower ids are generated below, extracted copies of them are stale.
+                    if (id < 0x400) {
+                        continue;
+                    }
+                    Common::FS::IOFile file(entry.path(), Common::FS::FileAccessMode::Read);
+                    std::vector<u8> data(file.IsOpen() ? file.GetSize() : 0);
+                    if (!file.IsOpen() || file.Read(data) != data.size()) {
+                        failreason = fmt::format("Failed to read {}",
+                                                 Common::FS::PathToUTF8String(entry.path()));
+                        return false;
+                    }
+                    entries.push_back({.id = id, .data = std::move(data)});
+                    continue;
+                }
+            }
+
+            PackNode node{
+                .path = entry.path(),
+                .name = Common::FS::PathToUTF8String(entry.path().filename()),
+                .parent = dir,
+                .is_dir = is_dir,
+                .in_sce_sys = in_sce_sys,
+                .size = is_dir ? 0 : entry.file_size(ec),
+            };
+            if (node.name.size() > MaxNameLength) {
+                failreason = fmt::format("File name too long: {}", node.name);
+                return false;
+            }
+            nodes[dir].children.push_back(static_cast<u32>(nodes.size()));
+            nodes.push_back(std::move(node));
+        }
+    }
+    return true;
+}
+
+void AppendDirent(std::vector<std::vector<u8>>& blocks, u32& pos, u32 ino, s32 type,
+                  std::string_view name) {
+    const u32 size = Common::AlignUp<u32>(offsetof(Dirent, name) + name.size() + 1, 8);
+    if (pos + size > BlockSize) {
+        blocks.emplace_back(BlockSize);
+        pos = 0;
+    }
+    const s32 header[] = {static_cast<s32>(ino), type, static_cast<s32>(name.size()),
+                          static_cast<s32>(size)};
+    std::memcpy(blocks.back().data() + pos, header, sizeof(header));
+    std::memcpy(blocks.back().data() + pos + sizeof(header), name.data(), name.size());
+    pos += size;
+}
+
+/// Assigns blocks to directories and files and builds the superblock, inode table and
+/// directory entry blocks.
+void BuildMetadata(PfsLayout& layout) {
+    auto& nodes = layout.nodes;
+    auto& metadata = layout.metadata;
+    const u32 num_inode_blocks = (nodes.size() + InodesPerBlock - 1) / InodesPerBlock;
+    metadata.assign(1 + num_inode_blocks, std::vector<u8>(BlockSize));
+
+    // Superroot, the reader finds it by the flat_path_table entry at the start of a block.
+    u32 pos = 0;
+    nodes[0].loc = static_cast<u32>(metadata.size());
+    metadata.emplace_back(BlockSize);
+    AppendDirent(metadata, pos, 1, PFS_FILE, nodes[1].name);
+    AppendDirent(metadata, pos, 2, PFS_DIR, nodes[2].name);
+    nodes[0].blocks = 1;
+
+    for (u32 i = 2; i < nodes.size(); i++) {
+        auto& dir = nodes[i];
+        if (!dir.is_dir) {
+            continue;
+        }
+        pos = 0;
+        dir.loc = static_cast<u32>(metadata.size());
+        metadata.emplace_back(BlockSize);
+        AppendDirent(metadata, pos, i, PFS_CURRENT_DIR, ".");
+        AppendDirent(metadata, pos, dir.parent, PFS_PARENT_DIR, "..");
+        for (const u32 child : dir.children) {
+            AppendDirent(metadata, pos, child, nodes[child].is_dir ? PFS_DIR : PFS_FILE,
+                         nodes[child].name);
+        }
+        dir.blocks = static_cast<u32>(metadata.size() - dir.loc);
+    }
+
+    u64 next_block = metadata.size();
+    for (u32 i = 1; i < nodes.size(); i++) {
+        auto& file = nodes[i];
+        if (file.is_dir) {
+            continue;
+        }
+        file.loc = static_cast<u32>(next_block);
+        file.blocks = static_cast<u32>((file.size + BlockSize - 1) / BlockSize);
+        next_block += file.blocks;
+        if (file.blocks != 0) {
+            layout.data_files.push_back(i);
+        }
+    }
+    layout.num_blocks = next_block;
+
+    for (u32 i = 0; i < nodes.size(); i++) {
+        const auto& node = nodes[i];
+        Inode inode{};
+        inode.Mode = static_cast<u16>(node.is_dir ? (InodeMode::dir | 0755)
+                                                  : (InodeMode::file | 0644));
+        inode.Nlink = 1;
+        inode.Flags = InodeFlags::readonly;
+        inode.Size = static_cast<s64>(node.is_dir ? node.blocks * BlockSize : node.size);
+        inode.SizeCompressed = inode.Size;
+        inode.Blocks = node.blocks;
+        inode.loc = node.loc;
+        std::memcpy(metadata[1 + i / InodesPerBlock].data() + (i % InodesPerBlock) * InodeSize,
+                    &inode, sizeof(inode));
+    }
+
+    PSFHeader_ superblock{};
+    superblock.version = 1;
+    superblock.magic = PfsMagic;
+    superblock.block_size = BlockSize;
+    superblock.n_block = static_cast<s64>(layout.num_blocks);
+    superblock.dinode_count = static_cast<s64>(nodes.size());
+    superblock.dinode_block_count = num_inode_blocks;
+    superblock.superroot_ino = 0;
+    std::memcpy(metadata[0].data(), &superblock, sizeof(superblock));
+}
+
+/// Fills worker.block with uncompressed block n of the image.
+bool ReadSourceBlock(const PfsLayout& layout, u64 block, PackWorker& worker) {
+    if (block < layout.metadata.size()) {
+        std::ranges::copy(layout.metadata[block], worker.block.begin());
+        return true;
+    }
+
+    const auto it = std::ranges::upper_bound(layout.data_files, block, {},
+                                             [&](u32 node) { return layout.nodes[node].loc; });
+    const u32 index = *(it - 1);
+    const auto& node = layout.nodes[index];
+    if (worker.open_node != index) {
+        worker.file.Open(node.path, Common::FS::FileAccessMode::Read);
+        worker.open_node = index;
+    }
+
+    const u64 offset = (block - node.loc) * BlockSize;
+    const u64 size = std::min(BlockSize, node.size - offset);
+    if (!worker.file.IsOpen() || !worker.file.Seek(static_cast<s64>(offset)) ||
+        worker.file.ReadRaw<u8>(worker.block.data(), size) != size) {
+        LOG_ERROR(Loader, "Failed to read {}", Common::FS::PathToUTF8String(node.path));
+        return false;
+    }
+    // The last block is zero padded past the end of the file.
+    std::fill(worker.block.begin() + size, worker.block.end(), 0);
+    return true;
+}
+
+/// Writes the PFS image to out at image_offset. Blocks are compressed in windows, and once the
+/// offsets of a window are known its complete XTS sectors are encrypted and written, so only a
+/// window is ever held in memory. The PFSC header and sector map go in last.
+bool WriteImage(const PfsLayout& layout, const PfsKeys& keys, const Common::FS::IOFile& out,
+                u64 image_offset, u32 num_threads, int level, ImageInfo& info,
+                std::string& failreason) {
+    Crypto crypto;
+    const u64 data_start = Common::AlignUp(SectorMapOffset + (layout.num_blocks + 1) * 8,
+                                           BlockSize);
+    std::vector<u64> sector_map(layout.num_blocks + 1);
+
+    std::vector<std::unique_ptr<PackWorker>> workers;
+    for (u32 i = 0; i < num_threads; i++) {
+        workers.push_back(std::make_unique<PackWorker>(level));
+    }
+    std::vector<std::vector<u8>> compressed(WindowBlocks);
+    std::atomic<u64> compressed_blocks{0};
+
+    std::vector<u8> pending; // Image bytes from pending_offset on that are not written yet.
+    u64 pending_offset = PfscStart + data_start;
+    u64 position = data_start; // PFSC offset of the next block.
+
+    const auto encrypt_and_write = [&](u64 size) {
+        const u64 num_chunks = (size + EncryptChunkSize - 1) / EncryptChunkSize;
+        Common::ParallelFor(num_chunks, num_threads, [&](size_t chunk) {
+            const u64 begin = chunk * EncryptChunkSize;
+            const auto data =
+                std::span(pending).subspan(begin, std::min(EncryptChunkSize, size - begin));
+            crypto.encryptPFS(keys.data_key, keys.tweak_key, data, data,
+                              (pending_offset + begin) / SectorSize);
+        });
+        if (!out.Seek(static_cast<s64>(image_offset + pending_offset)) ||
+            out.WriteSpan(std::span<const u8>(pending).first(size)) != size) {
+            return false;
+        }
+        pending.erase(pending.begin(), pending.begin() + size);
+        pending_offset += size;
+        return true;
+    };
+
+    for (u64 first = 0; first < layout.num_blocks; first += WindowBlocks) {
+        const u64 count = std::min(WindowBlocks, layout.num_blocks - first);
+        std::atomic<bool> read_failed{false};
+        Common::ParallelFor(
+            count, num_threads, [&](u32 index) -> PackWorker& { return *workers[index]; },
+            [&](PackWorker& worker, size_t i) {
+                if (read_failed) {
+                    return;
+                }
+                if (!ReadSourceBlock(layout, first + i, worker)) {
+                    read_failed = true;
+                    return;
+                }
+                if (worker.compressor.Compress(worker.block, compressed[i])) {
+                    compressed_blocks++;
+                }
+            });
+        if (read_failed) {
+            failreason = "Failed to read the source files";
+            return false;
+        }
+
+        for (u64 i = 0; i < count; i++) {
+            sector_map[first + i] = position;
+            position += compressed[i].size();
+            pending.insert(pending.end(), compressed[i].begin(), compressed[i].end());
+        }
+        if (!encrypt_and_write(Common::AlignDown(pending.size(), SectorSize))) {
+            failreason = "Failed to write the PFS image";
+            return false;
+        }
+    }
+    sector_map[layout.num_blocks] = position;
+
+    info.size = Common::AlignUp(PfscStart + position, BlockSize);
+    info.metadata_end = PfscStart + sector_map[layout.metadata.size()];
+    info.compressed_blocks = compressed_blocks;
+    pending.resize(info.size - pending_offset);
+    if (!encrypt_and_write(pending.size())) {
+        failreason = "Failed to write the PFS image";
+        return false;
+    }
+
+    // Everything between the clear header and the first block, with the PFSC header and map.
+    std::vector<u8> head(PfscStart + data_start - EncryptedStart);
+    PFSCHdr pfsc{};
+    pfsc.magic = PfscMagic;
+    pfsc.unk8 = 6;
+    pfsc.block_sz = BlockSize;
+    pfsc.block_sz2 = BlockSize;
+    pfsc.block_offsets = SectorMapOffset;
+    pfsc.data_start = data_start;
+    pfsc.data_length = static_cast<s64>(layout.num_blocks * BlockSize);
+    u8* const pfsc_data = head.data() + (PfscStart - EncryptedStart);
+    std::memcpy(pfsc_data, &pfsc, sizeof(pfsc));
+    std::memcpy(pfsc_data + SectorMapOffset, sector_map.data(), sector_map.size() * sizeof(u64));
+    crypto.encryptPFS(keys.data_key, keys.tweak_key, head, head, EncryptedStart / SectorSize);
+
+    std::vector<u8> header(EncryptedStart);
+    PSFHeader_ pfs{};
+    pfs.version = 1;
+    pfs.magic = PfsMagic;
+    pfs.mode = static_cast<PfsMode>(Is64Bit | Encrypted | UnknownFlagAlwaysSet);
+    pfs.block_size = BlockSize;
+    pfs.n_block = static_cast<s64>(info.size / BlockSize);
+    std::memcpy(header.data(), &pfs, sizeof(pfs));
+    std::ranges::copy(keys.seed, header.begin() + 0x370);
+
+    if (!out.Seek(static_cast<s64>(image_offset)) || out.Write(header) != header.size() ||
+        out.Write(head) != head.size()) {
+        failreason = "Failed to write the PFS header";
+        return false;
+    }
+    return true;
+}
+
+} // Anonymous namespace
+
+bool BuildPkg(const std::filesystem::path& source_dir, const std::filesystem::path& pkg_path,
+              const PkgBuildOptions& options, std::string& failreason, PkgBuildStats* stats) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(source_dir, ec)) {
+        failreason = "Source directory not found";
+        return false;
+    }
+
+    PfsLayout layout;
+    std::vector<PackEntry> entries;
+    if (!CollectTree(source_dir, layout, entries, failreason)) {
+        return false;
+    }
+    std::ranges::sort(entries, {}, &PackEntry::id);
+    if (const auto dup = std::ranges::adjacent_find(entries, {}, &PackEntry::id);
+        dup != entries.end()) {
+        failreason = fmt::format("sce_sys has two files for PKG entry {:#x}", dup->id);
+        return false;
+    }
+
+    const auto sfo = std::ranges::find(entries, ParamSfoEntry, &PackEntry::id);
+    if (sfo == entries.end()) {
+        failreason = "sce_sys/param.sfo not found";
+        return false;
+    }
+    std::string content_id = options.content_id;
+    if (content_id.empty()) {
+        PsfView psf;
+        if (psf.Open(sfo->data)) {
+            content_id = psf.GetString("CONTENT_ID").value_or("");
+        }
+    }
+    if (content_id.size() != sizeof(PKGHeader::pkg_content_id)) {
+        failreason = fmt::format("Invalid content ID '{}'", content_id);
+        return false;
+    }
+
+    BuildMetadata(layout);
+
+    Crypto crypto;
+    CryptoPP::AutoSeededRandomPool rng;
+    std::array<u8, 32> dk3;
+    std::array<u8, 32> ekpfs;
+    PfsKeys keys;
+    rng.GenerateBlock(dk3.data(), dk3.size());
+    rng.GenerateBlock(ekpfs.data(), ekpfs.size());
+    rng.GenerateBlock(keys.seed.data(), keys.seed.size());
+    crypto.PfsGenCryptoKey(ekpfs, keys.seed, keys.data_key, keys.tweak_key);
+
+    // Generated entries come first, sce_sys entries all have higher ids.
+    entries.insert(entries.begin(), {
+                                        {.id = DigestsEntry},
+                                        {.id = EntryKeysEntry},
+                                        {.id = ImageKeyEntry},
+                                    });
+    entries[0].data.resize(entries.size() * 32);
+    entries[1].data.resize(EntryKeysSize);
+    entries[2].data.resize(256);
+    for (auto& entry : entries) {
+        if (IsNpEntry(entry.id)) {
+            entry.data.resize(Common::AlignUp(entry.data.size(), CryptoPP::AES::BLOCKSIZE));
+        }
+    }
+
+    const u32 num_entries = static_cast<u32>(entries.size());
+    u64 body_end = Common::AlignUp<u64>(EntryTableOffset + num_entries * sizeof(PKGEntry), 16);
+    for (auto& entry : entries) {
+        entry.offset = static_cast<u32>(body_end);
+        body_end = Common::AlignUp<u64>(body_end + entry.data.size(), 16);
+    }
+    if (body_end > std::numeric_limits<u32>::max()) {
+        failreason = "sce_sys entries are too large";
+        return false;
+    }
+
+    std::vector<PKGEntry> table(num_entries);
+    for (u32 i = 0; i < num_entries; i++) {
+        const bool encrypted = entries[i].id == ImageKeyEntry || IsNpEntry(entries[i].id);
+        table[i].id = entries[i].id;
+        table[i].filename_offset = 0;
+        table[i].flags1 = encrypted ? EntryEncrypted : 0;
+        table[i].flags2 = encrypted ? EntryKeyIndexDk3 : 0;
+        table[i].offset = entries[i].offset;
+        table[i].size = static_cast<u32>(entries[i].data.size());
+        table[i].padding = 0;
+    }
+
+    // Key derivation mirrors PKG::LoadImage and PKG::DecryptNpEntry.
+    const auto entry_ivkey = [&](const PKGEntry& entry) {
+        std::array<u8, 64> concatenated_ivkey_dk3;
+        std::memcpy(concatenated_ivkey_dk3.data(), &entry, sizeof(entry));
+        std::memcpy(concatenated_ivkey_dk3.data() + sizeof(entry), dk3.data(), dk3.size());
+        std::array<u8, 32> ivkey;
+        crypto.ivKeyHASH256(concatenated_ivkey_dk3, ivkey);
+        return ivkey;
+    };
+    crypto.RSA2048Encrypt(std::span<u8, 256>(entries[1].data.data() + Dk3KeyOffset, 256), dk3,
+                          true);
+    std::array<u8, 256> ekpfs_encrypted;
+    crypto.RSA2048Encrypt(ekpfs_encrypted, ekpfs, false);
+    crypto.aesCbcCfb128EncryptEntry(entry_ivkey(table[2]), ekpfs_encrypted, entries[2].data);
+    for (u32 i = 0; i < num_entries; i++) {
+        if (IsNpEntry(entries[i].id)) {
+            const auto plaintext = entries[i].data;
+            crypto.aesCbcCfb128EncryptEntry(entry_ivkey(table[i]), plaintext, entries[i].data);
+        }
+    }
+    for (u32 i = 1; i < num_entries; i++) {
+        const auto digest = Sha256(entries[i].data);
+        std::ranges::copy(digest, entries[0].data.begin() + i * digest.size());
+    }
+
+    std::vector<u8> body(body_end - EntryTableOffset);
+    std::memcpy(body.data(), table.data(), table.size() * sizeof(PKGEntry));
+    for (const auto& entry : entries) {
+        std::ranges::copy(entry.data, body.begin() + (entry.offset - EntryTableOffset));
+    }
+
+    Common::FS::IOFile out(pkg_path, Common::FS::FileAccessMode::Write);
+    if (!out.IsOpen()) {
+        failreason = "Failed to create the PKG file";
+        return false;
+    }
+    const auto fail = [&](std::string reason) {
+        failreason = std::move(reason);
+        out.Close();
+        std::filesystem::remove(pkg_path, ec);
+        return false;
+    };
+
+    if (!out.Seek(EntryTableOffset) || out.Write(body) != body.size()) {
+        return fail("Failed to write the PKG entries");
+    }
+
+    const u64 pfs_offset = Common::AlignUp(body_end, BlockSize);
+    const u32 num_threads =
+        options.num_threads != 0 ? options.num_threads
+                                 : std::max(1U, std::thread::hardware_concurrency());
+    ImageInfo image;
+    std::string reason;
+    if (!WriteImage(layout, keys, out, pfs_offset, num_threads, options.compression_level, image,
+                    reason)) {
+        return fail(reason);
+    }
+    out.Flush();
+
+    // The image digests need the finished image, its head is only written at the end.
+    std::array<u8, 32> image_digest;
+    std::array<u8, 32> signed_digest;
+    {
+        Common::FS::IOFile in(pkg_path, Common::FS::FileAccessMode::Read);
+        if (!in.IsOpen() || !in.Seek(static_cast<s64>(pfs_offset))) {
+            return fail("Failed to read back the PFS image");
+        }
+        CryptoPP::SHA256 sha256;
+        std::vector<u8> buffer(0x400000);
+        for (u64 done = 0; done < image.size;) {
+            const u64 size = std::min<u64>(buffer.size(), image.size - done);
+            if (in.ReadRaw<u8>(buffer.data(), size) != size) {
+                return fail("Failed to read back the PFS image");
+            }
+            if (done == 0) {
+                signed_digest = Sha256(std::span(buffer).first(EncryptedStart));
+            }
+            sha256.Update(buffer.data(), size);
+            done += size;
+        }
+        sha256.Final(image_digest.data());
+    }
+
+    PKGHeader header{};
+    header.magic = PkgMagic;
+    header.pkg_type = 0x80000001;
+    header.pkg_file_count = num_entries;
+    header.pkg_table_entry_count = num_entries;
+    header.pkg_sc_entry_count = static_cast<u16>(num_entries);
+    header.pkg_table_entry_count_2 = static_cast<u16>(num_entries);
+    header.pkg_table_entry_offset = EntryTableOffset;
+    header.pkg_sc_entry_data_size = static_cast<u32>(body_end - EntryTableOffset);
+    header.pkg_body_offset = EntryTableOffset;
+    header.pkg_body_size = pfs_offset - EntryTableOffset;
+    header.pkg_content_offset = pfs_offset;
+    header.pkg_content_size = image.size;
+    std::memcpy(header.pkg_content_id, content_id.data(), content_id.size());
+    header.pkg_drm_type = 0xF;
+    header.pkg_content_type = options.content_type;
+    header.pkg_content_flags = options.content_flags;
+
+    std::ranges::copy(Sha256(entries[1].data), header.digest_entries1);
+    std::ranges::copy(Sha256(entries[2].data), header.digest_entries2);
+    std::ranges::copy(Sha256(entries[0].data), header.digest_table_digest);
+    std::ranges::copy(Sha256(std::span(body).first(table.size() * sizeof(PKGEntry))),
+                      header.digest_body_digest);
+
+    header.pfs_image_count = 1;
+    header.pfs_image_offset = pfs_offset;
+    header.pfs_image_size = image.size;
+    header.pkg_size = pfs_offset + image.size;
+    header.pfs_signed_size = static_cast<u32>(EncryptedStart);
+    // PKG::LoadImage reads twice the cache size from the start of the image up front.
+    header.pfs_cache_size = static_cast<u32>(Common::AlignUp(image.metadata_end, BlockSize) / 2);
+    std::ranges::copy(image_digest, header.pfs_image_digest);
+    std::ranges::copy(signed_digest, header.pfs_signed_digest);
+
+    const auto header_bytes = std::as_bytes(std::span(&header, 1));
+    const auto header_digest = Sha256({reinterpret_cast<const u8*>(header_bytes.data()),
+                                       offsetof(PKGHeader, pkg_digest)});
+    std::ranges::copy(header_digest, header.pkg_digest);
+
+    if (!out.Seek(0) || !out.WriteObject(header)) {
+        return fail("Failed to write the PKG header");
+    }
+    out.Close();
+
+    if (stats) {
+        stats->num_entries = num_entries - 3;
+        stats->num_blocks = layout.num_blocks;
+        stats->compressed_blocks = image.compressed_blocks;
+        stats->image_size = image.size;
+        stats->pkg_size = pfs_offset + image.size;
+        for (u32 i = 3; i < layout.nodes.size(); i++) {
+            const auto& node = layout.nodes[i];
+            if (node.is_dir) {
+                stats->num_dirs++;
+            } else {
+                stats->num_files++;
+                stats->input_bytes += node.size;
+            }
+        }
+    }
+    return true;
+}
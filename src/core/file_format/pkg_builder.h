@@ -0,0 +1,37 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include "common/types.h"
+
+struct PkgBuildOptions {
+    std::string content_id;    // Read from sce_sys/param.sfo when empty.
+    u32 content_type = 0x1A;   // Game data.
+    u32 content_flags = 0;     // PKGContentFlag bits, e.g. for patches.
+    int compression_level = 6; // zlib level of the PFSC blocks.
+    u32 num_threads = 0;       // 0 uses every core.
+};
+
+struct PkgBuildStats {
+    u32 num_files = 0;
+    u32 num_dirs = 0;
+    u32 num_entries = 0; // sce_sys files stored in the entry table instead of the PFS image.
+    u64 input_bytes = 0;
+    u64 num_blocks = 0;
+    u64 compressed_blocks = 0;
+    u64 image_size = 0;
+    u64 pkg_size = 0;
+};
+
+/**
+ * Packs a directory laid out like an extracted game into a PKG signed with the fake keyset, the
+ * layout PKG::Extract reads back. sce_sys files with a PKG entry name go to the entry table, the
+ * rest of the tree becomes a PFS image of 64 KiB PFSC blocks, deflated and XTS encrypted across
+ * worker threads one window of blocks at a time.
+ */
+bool BuildPkg(const std::filesystem::path& source_dir, const std::filesystem::path& pkg_path,
+              const PkgBuildOptions& options, std::string& failreason,
+              PkgBuildStats* stats = nullptr);
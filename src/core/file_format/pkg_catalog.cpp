@@ -0,0 +1,210 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <cstring>
+
+#include "common/binary_stream.h"
+#include "common/io_file.h"
+#include "common/logging/log.h"
+#include "common/parallel_for.h"
+#include "common/path_util.h"
+#include "core/file_format/pkg.h"
+#include "core/file_format/pkg_catalog.h"
+#include "core/file_format/psf.h"
+
+namespace {
+
+// Bytes of a catalog entry whose strings are all empty, bounds the entry count of a catalog file
+constexpr size_t MinCatalogEntrySize = 7 * sizeof(u32) + 3 * sizeof(u64) + 2 * sizeof(u32) +
+                                       2 * sizeof(s32) + sizeof(bool);
+
+bool StatPkg(const std::filesystem::path& path, u64& mtime, u64& size) {
+    std::error_code ec;
+    const auto write_time = std::filesystem::last_write_time(path, ec);
+    if (ec) {
+        return false;
+    }
+    size = std::filesystem::file_size(path, ec);
+    if (ec) {
+        return false;
+    }
+    mtime = static_cast<u64>(write_time.time_since_epoch().count());
+    return true;
+}
+
+} // Anonymous namespace
+
+bool PkgCatalog::Load(const std::filesystem::path& catalog_path) {
+    entries.clear();
+    if (!std::filesystem::exists(catalog_path)) {
+        return false;
+    }
+
+    Common::FS::IOFile file(catalog_path, Common::FS::FileAccessMode::Read);
+    if (!file.IsOpen()) {
+        return false;
+    }
+    std::vector<u8> data(file.GetSize());
+    if (file.Read(data) != data.size()) {
+        return false;
+    }
+
+    Common::BinaryReader reader{data};
+    u32 magic = 0;
+    u32 version = 0;
+    u32 count = 0;
+    if (!reader.Read(magic) || !reader.Read(version) || !reader.Read(count) ||
+        magic != PKG_CATALOG_MAGIC || version != PKG_CATALOG_VERSION) {
+        LOG_WARNING(Loader, "Ignoring invalid or outdated PKG catalog");
+        return false;
+    }
+    if (count > reader.Remaining() / MinCatalogEntrySize) {
+        LOG_WARNING(Loader, "PKG catalog is truncated");
+        return false;
+    }
+
+    entries.resize(count);
+    for (auto& entry : entries) {
+        const bool ok = reader.Read(entry.path) && reader.Read(entry.mtime) &&
+                        reader.Read(entry.file_size) && reader.Read(entry.content_id) &&
+                        reader.Read(entry.title_id) && reader.Read(entry.content_type) &&
+                        reader.Read(entry.content_flags) && reader.Read(entry.pkg_size) &&
+                        reader.Read(entry.title) && reader.Read(entry.category) &&
+                        reader.Read(entry.app_ver) && reader.Read(entry.version) &&
+                        reader.Read(entry.app_type) && reader.Read(entry.system_ver) &&
+                        reader.Read(entry.has_system_ver);
+        if (!ok) {
+            LOG_WARNING(Loader, "PKG catalog is truncated");
+            entries.clear();
+            return false;
+        }
+    }
+    std::ranges::sort(entries, {}, &PkgCatalogEntry::path);
+    return true;
+}
+
+bool PkgCatalog::Save(const std::filesystem::path& catalog_path) const {
+    Common::BinaryWriter writer;
+    writer.Write(PKG_CATALOG_MAGIC);
+    writer.Write(PKG_CATALOG_VERSION);
+    writer.Write(static_cast<u32>(entries.size()));
+    for (const auto& entry : entries) {
+        writer.Write(entry.path);
+        writer.Write(entry.mtime);
+        writer.Write(entry.file_size);
+        writer.Write(entry.content_id);
+        writer.Write(entry.title_id);
+        writer.Write(entry.content_type);
+        writer.Write(entry.content_flags);
+        writer.Write(entry.pkg_size);
+        writer.Write(entry.title);
+        writer.Write(entry.category);
+        writer.Write(entry.app_ver);
+        writer.Write(entry.version);
+        writer.Write(entry.app_type);
+        writer.Write(entry.system_ver);
+        writer.Write(entry.has_system_ver);
+    }
+
+    // Write to a temporary file first so an interrupted save never leaves a torn catalog.
+    auto temp_path = catalog_path;
+    temp_path += ".tmp";
+    if (Common::FS::IOFile::WriteBytes(temp_path, writer.Data()) != writer.Data().size()) {
+        return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_path, catalog_path, ec);
+    return !ec;
+}
+
+PkgCatalogStats PkgCatalog::Refresh(std::span<const std::filesystem::path> pkg_paths,
+                                    u32 num_threads) {
+    PkgCatalogStats stats{};
+    std::vector<PkgCatalogEntry> refreshed(pkg_paths.size());
+    std::vector<bool> matched(entries.size());
+    std::vector<size_t> to_probe;
+    std::vector<u8> valid(pkg_paths.size(), 0);
+    std::vector<std::string> failreasons(pkg_paths.size());
+
+    for (size_t i = 0; i < pkg_paths.size(); i++) {
+        auto& entry = refreshed[i];
+        entry.path = Common::FS::PathToUTF8String(pkg_paths[i]);
+        if (!StatPkg(pkg_paths[i], entry.mtime, entry.file_size)) {
+            failreasons[i] = "Failed to read the file status";
+            continue;
+        }
+
+        const auto it = std::ranges::lower_bound(entries, entry.path, {}, &PkgCatalogEntry::path);
+        if (it != entries.end() && it->path == entry.path) {
+            matched[std::distance(entries.begin(), it)] = true;
+            if (it->mtime == entry.mtime && it->file_size == entry.file_size) {
+                entry = *it;
+                valid[i] = 1;
+                stats.reused++;
+                continue;
+            }
+        }
+        to_probe.push_back(i);
+    }
+
+    Common::ParallelFor(to_probe.size(), num_threads, [&](size_t n) {
+        const size_t i = to_probe[n];
+        const u64 mtime = refreshed[i].mtime;
+        const u64 file_size = refreshed[i].file_size;
+        valid[i] = Probe(pkg_paths[i], refreshed[i], failreasons[i]);
+        refreshed[i].mtime = mtime;
+        refreshed[i].file_size = file_size;
+    });
+
+    std::vector<PkgCatalogEntry> kept;
+    kept.reserve(refreshed.size());
+    for (size_t i = 0; i < refreshed.size(); i++) {
+        if (valid[i]) {
+            kept.push_back(std::move(refreshed[i]));
+        } else {
+            stats.failed++;
+            stats.failures.push_back({std::move(refreshed[i].path), std::move(failreasons[i])});
+        }
+    }
+    stats.probed = static_cast<u32>(
+        std::ranges::count_if(to_probe, [&](size_t i) { return valid[i] != 0; }));
+    stats.removed = static_cast<u32>(std::ranges::count(matched, false));
+
+    entries = std::move(kept);
+    std::ranges::sort(entries, {}, &PkgCatalogEntry::path);
+    return stats;
+}
+
+bool PkgCatalog::Probe(const std::filesystem::path& pkg_path, PkgCatalogEntry& entry,
+                       std::string& failreason) {
+    PKG pkg;
+    if (!pkg.Open(pkg_path, failreason)) {
+        LOG_WARNING(Loader, "Failed to probe {}: {}", Common::FS::PathToUTF8String(pkg_path),
+                    failreason);
+        return false;
+    }
+
+    const auto& header = pkg.GetPkgHeader();
+    const auto* content_id = reinterpret_cast<const char*>(header.pkg_content_id);
+    entry.path = Common::FS::PathToUTF8String(pkg_path);
+    entry.content_id.assign(content_id, strnlen(content_id, sizeof(header.pkg_content_id)));
+    entry.title_id = pkg.GetTitleID();
+    entry.content_type = header.pkg_content_type;
+    entry.content_flags = header.pkg_content_flags;
+    entry.pkg_size = header.pkg_size;
+
+    PsfView psf;
+    if (!psf.Open(pkg.sfo)) {
+        return true;
+    }
+    entry.title = psf.GetString("TITLE").value_or("");
+    entry.category = psf.GetString("CATEGORY").value_or("");
+    entry.app_ver = psf.GetString("APP_VER").value_or("");
+    entry.version = psf.GetString("VERSION").value_or("");
+    entry.app_type = psf.GetInteger("APP_TYPE").value_or(0);
+    const auto system_ver = psf.GetInteger("SYSTEM_VER");
+    entry.system_ver = system_ver.value_or(0);
+    entry.has_system_ver = system_ver.has_value();
+    return true;
+}
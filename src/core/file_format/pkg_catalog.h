@@ -0,0 +1,75 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+#include "common/types.h"
+
+constexpr u32 PKG_CATALOG_MAGIC = 0x43474B50; // "PKGC"
+constexpr u32 PKG_CATALOG_VERSION = 2;
+
+/// Parsed PKG header and param.sfo fields of a single package.
+struct PkgCatalogEntry {
+    std::string path;
+    u64 mtime = 0;
+    u64 file_size = 0;
+
+    // PKG header
+    std::string content_id;
+    std::string title_id;
+    u32 content_type = 0;
+    u32 content_flags = 0;
+    u64 pkg_size = 0;
+
+    // param.sfo
+    std::string title;
+    std::string category;
+    std::string app_ver;
+    std::string version;
+    s32 app_type = 0;
+    s32 system_ver = 0;
+    bool has_system_ver = false;
+};
+
+/// A package that could not be read, with the reason.
+struct PkgCatalogFailure {
+    std::string path;
+    std::string reason;
+};
+
+struct PkgCatalogStats {
+    u32 probed = 0;
+    u32 reused = 0;
+    u32 removed = 0;
+    u32 failed = 0;
+    std::vector<PkgCatalogFailure> failures;
+};
+
+/**
+ * Persistent index of PKG metadata keyed by path, modification time and size.
+ * Refresh only probes packages that are new or changed since the last scan.
+ */
+class PkgCatalog {
+public:
+    bool Load(const std::filesystem::path& catalog_path);
+    bool Save(const std::filesystem::path& catalog_path) const;
+
+    /// Brings the catalog in sync with the given package list, probing in parallel.
+    PkgCatalogStats Refresh(std::span<const std::filesystem::path> pkg_paths,
+                            u32 num_threads = 0);
+
+    /// Reads the header and param.sfo of a single package.
+    static bool Probe(const std::filesystem::path& pkg_path, PkgCatalogEntry& entry,
+                      std::string& failreason);
+
+    const std::vector<PkgCatalogEntry>& GetEntries() const {
+        return entries;
+    }
+
+private:
+    std::vector<PkgCatalogEntry> entries; // Sorted by path.
+};
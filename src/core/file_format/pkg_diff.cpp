@@ -0,0 +1,147 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+#include "common/logging/log.h"
+#include "common/parallel_for.h"
+#include "core/file_format/pfsc.h"
+#include "core/file_format/pkg.h"
+#include "core/file_format/pkg_diff.h"
+
+namespace {
+
+struct FilePair {
+    int old_index;
+    int new_index;
+    u64 size;
+};
+
+enum class BlockMatch { Same, Different, Error };
+
+class BlockComparer {
+public:
+    BlockComparer(PKG& old_pkg, PKG& new_pkg) : old_reader{old_pkg}, new_reader{new_pkg} {}
+
+    BlockMatch Compare(const FilePair& pair, std::atomic<u64>& compared,
+                       std::atomic<u64>& inflated) {
+        const u64 num_blocks = (pair.size + PFSC_BLOCK_SIZE - 1) / PFSC_BLOCK_SIZE;
+        for (u64 block = 0; block < num_blocks; block++) {
+            if (!old_reader.Read(pair.old_index, block, old_block) ||
+                !new_reader.Read(pair.new_index, block, new_block)) {
+                return BlockMatch::Error;
+            }
+            compared++;
+            if (old_block.compressed == new_block.compressed && old_block.data == new_block.data) {
+                continue;
+            }
+
+            // Equal data can still be deflated differently, e.g. by another packer.
+            inflated++;
+            const auto old_data = Inflate(old_block, old_buffer);
+            const auto new_data = Inflate(new_block, new_buffer);
+            if (old_data.size() != old_block.size || new_data.size() != new_block.size) {
+                return BlockMatch::Error;
+            }
+            if (!std::ranges::equal(old_data, new_data)) {
+                return BlockMatch::Different;
+            }
+        }
+        return BlockMatch::Same;
+    }
+
+private:
+    /// Returns the file bytes of a block, empty if its zlib stream is corrupted. Like extraction
+    /// does, a compressed block has to inflate to a whole block.
+    static std::span<const u8> Inflate(const PfscBlock& block, std::vector<u8>& buffer) {
+        if (!block.compressed) {
+            return block.data;
+        }
+        buffer.resize(PFSC_BLOCK_SIZE);
+        if (InflatePfscBlock(block.data, buffer) != static_cast<s64>(PFSC_BLOCK_SIZE)) {
+            return {};
+        }
+        return std::span<const u8>(buffer).first(block.size);
+    }
+
+    PfscBlockReader old_reader;
+    PfscBlockReader new_reader;
+    PfscBlock old_block;
+    PfscBlock new_block;
+    std::vector<u8> old_buffer;
+    std::vector<u8> new_buffer;
+};
+
+} // Anonymous namespace
+
+bool DiffPkgs(PKG& old_pkg, PKG& new_pkg, PkgDiff& diff, std::string& failreason,
+              u32 num_threads) {
+    diff = {};
+
+    // Entries present in both trees are matched by path, anything else is added or removed.
+    std::unordered_map<std::string, int> old_paths;
+    for (int i = 0; i < static_cast<int>(old_pkg.GetNumberOfFiles()); i++) {
+        if (old_pkg.IsFile(i) || old_pkg.IsDirectory(i)) {
+            old_paths.emplace(old_pkg.GetRelativePath(i), i);
+        }
+    }
+
+    std::vector<FilePair> candidates;
+    for (int i = 0; i < static_cast<int>(new_pkg.GetNumberOfFiles()); i++) {
+        const bool is_file = new_pkg.IsFile(i);
+        if (!is_file && !new_pkg.IsDirectory(i)) {
+            continue;
+        }
+        const auto it = old_paths.find(new_pkg.GetRelativePath(i));
+        if (it == old_paths.end() || old_pkg.IsFile(it->second) != is_file) {
+            diff.added.push_back(i);
+            continue;
+        }
+        const int old_index = it->second;
+        old_paths.erase(it);
+        if (!is_file) {
+            continue;
+        }
+        const u64 size = new_pkg.GetFileSize(i);
+        if (old_pkg.GetFileSize(old_index) != size) {
+            diff.changed.push_back(i);
+        } else if (size == 0) {
+            diff.unchanged++;
+        } else {
+            candidates.push_back({old_index, i, size});
+        }
+    }
+
+    for (auto& [path, index] : old_paths) {
+        diff.removed.push_back(path);
+    }
+    // A directory sorts before everything below it, so reversing puts children first.
+    std::ranges::sort(diff.removed, std::greater{});
+
+    std::vector<BlockMatch> results(candidates.size());
+    std::atomic<u64> compared{0};
+    std::atomic<u64> inflated{0};
+    Common::ParallelFor(
+        candidates.size(), num_threads, [&](u32) { return BlockComparer(old_pkg, new_pkg); },
+        [&](BlockComparer& comparer, size_t n) {
+            results[n] = comparer.Compare(candidates[n], compared, inflated);
+        });
+
+    for (size_t n = 0; n < candidates.size(); n++) {
+        if (results[n] == BlockMatch::Error) {
+            failreason = fmt::format("Failed to read {}",
+                                     new_pkg.GetRelativePath(candidates[n].new_index));
+            return false;
+        }
+        if (results[n] == BlockMatch::Different) {
+            diff.changed.push_back(candidates[n].new_index);
+        } else {
+            diff.unchanged++;
+        }
+    }
+    std::ranges::sort(diff.changed);
+    diff.blocks_compared = compared;
+    diff.blocks_inflated = inflated;
+    return true;
+}
@@ -0,0 +1,28 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "common/types.h"
+
+class PKG;
+
+struct PkgDiff {
+    std::vector<int> added;           // Entries of the new PKG missing from the old one.
+    std::vector<int> changed;         // Files of the new PKG whose data differs.
+    std::vector<std::string> removed; // Paths only the old PKG has, children before parents.
+    u32 unchanged = 0;
+    u64 blocks_compared = 0;
+    u64 blocks_inflated = 0; // Blocks whose zlib streams differ and had to be compared inflated.
+};
+
+/**
+ * Compares the PFS trees of two mounted versions of the same content. Files of equal size are
+ * compared block by block on the decrypted PFSC data, which is usually enough to tell them apart
+ * without inflating anything. Only blocks with different zlib streams are inflated, so files
+ * that were merely recompressed do not count as changed.
+ */
+bool DiffPkgs(PKG& old_pkg, PKG& new_pkg, PkgDiff& diff, std::string& failreason,
+              u32 num_threads = 0);
@@ -636,3 +636,8 @@ std::string_view GetEntryNameByType(u32 type) {
     }
     return "";
 }
+
+u32 GetEntryTypeByName(std::string_view name) {
+    const auto it = std::ranges::find(PkgEntries, name, &PkgEntryValue::name);
+    return it != PkgEntries.end() ? it->type : 0;
+}
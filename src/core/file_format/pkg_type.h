@@ -8,3 +8,6 @@
 
 /// Retrieves the PKG entry name from its type identifier.
 std::string_view GetEntryNameByType(u32 type);
+
+/// Retrieves the PKG entry type identifier from its name, or 0 if the name is not an entry.
+u32 GetEntryTypeByName(std::string_view name);
@@ -1,8 +1,40 @@
 // SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <algorithm>
+#include <array>
+#include <charconv>
 #include "playgo_chunk.h"
 
+namespace {
+
+// Indexed by system language id.
+constexpr std::array<std::string_view, 30> PlaygoLanguageCodes = {
+    "ja", "en", "fr", "es", "de", "it", "nl", "pt", "ru", "ko",
+    "zh-hant", "zh-hans", "fi", "sv", "da", "no", "pl", "pt-br", "en-gb", "tr",
+    "es-la", "ar", "fr-ca", "cs", "hu", "el", "ro", "th", "vi", "id",
+};
+
+} // Anonymous namespace
+
+std::optional<u64> PlaygoLanguageMaskFromCode(std::string_view code) {
+    u32 lang_id = PlaygoLanguageCodes.size();
+    const auto it = std::ranges::find(PlaygoLanguageCodes, code);
+    if (it != PlaygoLanguageCodes.end()) {
+        lang_id = static_cast<u32>(std::distance(PlaygoLanguageCodes.begin(), it));
+    } else {
+        const auto [ptr, ec] = std::from_chars(code.data(), code.data() + code.size(), lang_id);
+        if (ec != std::errc{} || ptr != code.data() + code.size()) {
+            return std::nullopt;
+        }
+    }
+    if (lang_id >= 64) {
+        return std::nullopt;
+    }
+    // The most significant bit stands for language 0.
+    return u64{1} << (63 - lang_id);
+}
+
 bool PlaygoFile::Open(const std::filesystem::path& filepath) {
     Common::FS::IOFile file(filepath, Common::FS::FileAccessMode::Read);
     if (file.IsOpen()) {
@@ -20,10 +52,13 @@ bool PlaygoFile::LoadChunks(const Common::FS::IOFile& file) {
             bool ret = true;
 
             std::string chunk_attrs_data, chunk_mchunks_data, chunk_labels_data, mchunk_attrs_data;
+            std::string scenario_attrs_data, scenario_chunks_data;
             ret = ret && load_chunk_data(file, playgoHeader.chunk_attrs, chunk_attrs_data);
             ret = ret && load_chunk_data(file, playgoHeader.chunk_mchunks, chunk_mchunks_data);
             ret = ret && load_chunk_data(file, playgoHeader.chunk_labels, chunk_labels_data);
             ret = ret && load_chunk_data(file, playgoHeader.mchunk_attrs, mchunk_attrs_data);
+            ret = ret && load_chunk_data(file, playgoHeader.scenario_attrs, scenario_attrs_data);
+            ret = ret && load_chunk_data(file, playgoHeader.scenario_chunks, scenario_chunks_data);
 
             if (ret) {
                 chunks.resize(playgoHeader.chunk_count);
@@ -42,16 +77,35 @@ bool PlaygoFile::LoadChunks(const Common::FS::IOFile& file) {
 
                     u64 total_size = 0;
                     u16 mchunk_count = chunk_attrs[i].mchunk_count;
+                    chunks[i].ranges.clear();
                     if (mchunk_count != 0) {
                         auto mchunks = reinterpret_cast<u16*>(
                             ((u8*)chunk_mchunks + chunk_attrs[i].mchunks_offset));
                         for (u16 j = 0; j < mchunk_count; j++) {
                             u16 mchunk_id = mchunks[j];
                             total_size += mchunk_attrs[mchunk_id].size.size;
+                            chunks[i].ranges.push_back({mchunk_attrs[mchunk_id].loc.offset,
+                                                        mchunk_attrs[mchunk_id].size.size});
                         }
                     }
                     chunks[i].total_size = total_size;
                 }
+
+                scenarios.resize(playgoHeader.scenario_count);
+                auto scenario_attrs =
+                    reinterpret_cast<playgo_scenario_attr_entry_t*>(&scenario_attrs_data[0]);
+                for (u16 i = 0; i < playgoHeader.scenario_count; i++) {
+                    const u64 end = scenario_attrs[i].chunks_offset +
+                                    u64{scenario_attrs[i].chunk_count} * sizeof(u16);
+                    if (end > scenario_chunks_data.size()) {
+                        return false;
+                    }
+                    auto chunk_ids = reinterpret_cast<u16*>(&scenario_chunks_data[0] +
+                                                            scenario_attrs[i].chunks_offset);
+                    scenarios[i].initial_chunk_count = scenario_attrs[i].initial_chunk_count;
+                    scenarios[i].chunk_ids.assign(chunk_ids,
+                                                  chunk_ids + scenario_attrs[i].chunk_count);
+                }
             }
 
             return ret;
@@ -72,4 +126,70 @@ bool PlaygoFile::load_chunk_data(const Common::FS::IOFile& file, const chunk_t c
         }
     }
     return false;
-}
\ No newline at end of file
+}
+
+std::vector<bool> PlaygoFile::SelectChunks(const PlaygoSelection& selection) const {
+    std::vector<bool> selected(chunks.size(), true);
+
+    if (selection.initial_only && playgoHeader.default_scenario_id < scenarios.size()) {
+        const auto& scenario = scenarios[playgoHeader.default_scenario_id];
+        selected.assign(selected.size(), false);
+        const u16 count = std::min<u16>(scenario.initial_chunk_count, scenario.chunk_ids.size());
+        for (u16 i = 0; i < count; i++) {
+            if (scenario.chunk_ids[i] < selected.size()) {
+                selected[scenario.chunk_ids[i]] = true;
+            }
+        }
+    }
+
+    if (!selection.chunk_ids.empty()) {
+        for (u16 id = 0; id < selected.size(); id++) {
+            if (std::ranges::find(selection.chunk_ids, id) == selection.chunk_ids.end()) {
+                selected[id] = false;
+            }
+        }
+    }
+
+    if (selection.language_mask != 0) {
+        for (u16 id = 0; id < selected.size(); id++) {
+            // A chunk without a language mask holds language-neutral data.
+            const u64 mask = chunks[id].language_mask;
+            if (mask != 0 && (mask & selection.language_mask) == 0) {
+                selected[id] = false;
+            }
+        }
+    }
+    return selected;
+}
+
+PlaygoFilter::PlaygoFilter(const PlaygoFile& playgo, const PlaygoSelection& selection) {
+    const auto selected = playgo.SelectChunks(selection);
+    for (size_t id = 0; id < playgo.chunks.size(); id++) {
+        for (const auto& range : playgo.chunks[id].ranges) {
+            ranges.push_back({range.offset, range.offset + range.size, 0, selected[id]});
+        }
+    }
+    std::ranges::sort(ranges, {}, &Range::begin);
+    u64 reach = 0;
+    for (auto& range : ranges) {
+        reach = std::max(reach, range.end);
+        range.reach = reach;
+    }
+}
+
+bool PlaygoFilter::IsWanted(u64 begin, u64 end) const {
+    bool covered = false;
+    // Mchunks may be shared between chunks and ranges may overlap, so start at the first range
+    // that reaches past begin and check every range that overlaps.
+    auto it = std::ranges::upper_bound(ranges, begin, {}, &Range::reach);
+    for (; it != ranges.end() && it->begin < end; ++it) {
+        if (it->end <= begin) {
+            continue;
+        }
+        if (it->selected) {
+            return true;
+        }
+        covered = true;
+    }
+    return !covered;
+}
@@ -4,6 +4,8 @@
 #pragma once
 #include <filesystem>
 #include <mutex>
+#include <optional>
+#include <string_view>
 #include <vector>
 #include "common/io_file.h"
 #include "core/libraries/playgo/playgo_types.h"
@@ -88,13 +90,35 @@ struct playgo_mchunk_attr_entry_t {
     playgo_chunk_size_t size;
 } __attribute__((packed));
 
+struct PlaygoChunkRange {
+    u64 offset; // Byte offset into the PFS image.
+    u64 size;
+};
+
 struct PlaygoChunk {
     u64 req_locus;
     u64 language_mask;
     u64 total_size;
     std::string label_name;
+    std::vector<PlaygoChunkRange> ranges;
+};
+
+struct PlaygoScenario {
+    u16 initial_chunk_count;
+    std::vector<u16> chunk_ids;
+};
+
+/// Which chunks of a package to keep when extracting.
+struct PlaygoSelection {
+    bool initial_only = false;  // Only the initial chunks of the default scenario.
+    u64 language_mask = 0;      // 0 keeps every language.
+    std::vector<u16> chunk_ids; // Empty keeps every chunk.
 };
 
+/// Maps a language code such as "en" or "ja" (or a numeric system language id) to its PlayGo
+/// language mask bit.
+std::optional<u64> PlaygoLanguageMaskFromCode(std::string_view code);
+
 class PlaygoFile {
 public:
     OrbisPlayGoHandle handle = 0;
@@ -105,6 +129,7 @@ public:
     OrbisPlayGoEta eta = 0;
     OrbisPlayGoLanguageMask langMask = 0;
     std::vector<PlaygoChunk> chunks;
+    std::vector<PlaygoScenario> scenarios;
 
 public:
     explicit PlaygoFile() = default;
@@ -113,6 +138,9 @@ public:
     bool Open(const std::filesystem::path& filepath);
     bool LoadChunks(const Common::FS::IOFile& file);
 
+    /// Returns, indexed by chunk id, whether the chunk is needed for the given selection.
+    std::vector<bool> SelectChunks(const PlaygoSelection& selection) const;
+
     PlaygoHeader& GetPlaygoHeader() {
         return playgoHeader;
     }
@@ -127,3 +155,21 @@ private:
     PlaygoHeader playgoHeader;
     std::mutex speed_mutex;
 };
+
+/// Answers whether a byte range of the PFS image belongs to a selected chunk.
+class PlaygoFilter {
+public:
+    PlaygoFilter(const PlaygoFile& playgo, const PlaygoSelection& selection);
+
+    /// Data not covered by any chunk is always wanted.
+    bool IsWanted(u64 begin, u64 end) const;
+
+private:
+    struct Range {
+        u64 begin;
+        u64 end;
+        u64 reach; // Largest end of this range and all ranges before it.
+        bool selected;
+    };
+    std::vector<Range> ranges; // Sorted by begin.
+};
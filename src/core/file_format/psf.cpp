@@ -22,8 +22,8 @@ static inline u32 get_max_size(std::string_view key, u32 default_value) {
 
 bool PSF::Open(const std::filesystem::path& filepath) {
     using namespace std::chrono;
-    if (std::filesystem::exists(filepath)) {
-        const auto t = std::filesystem::last_write_time(filepath);
+    std::error_code ec;
+    if (const auto t = std::filesystem::last_write_time(filepath, ec); !ec) {
         const auto rel =
             duration_cast<seconds>(t - std::filesystem::file_time_type::clock::now()).count();
         const auto tp = system_clock::to_time_t(system_clock::now() + seconds{rel});
@@ -290,3 +290,91 @@ std::pair<std::vector<PSF::Entry>::const_iterator, size_t> PSF::FindEntry(
         std::ranges::find_if(entry_list, [&](const auto& entry) { return entry.key == key; });
     return {entry, std::distance(entry_list.begin(), entry)};
 }
+
+bool PsfView::Open(std::span<const u8> psf_buffer) {
+    buffer = {};
+    if (psf_buffer.size() < sizeof(PSFHeader)) {
+        return false;
+    }
+    std::memcpy(&header, psf_buffer.data(), sizeof(header));
+    if (header.magic != PSF_MAGIC ||
+        (header.version != PSF_VERSION_1_1 && header.version != PSF_VERSION_1_0)) {
+        return false;
+    }
+
+    const u64 size = psf_buffer.size();
+    const u64 index_end =
+        sizeof(PSFHeader) + u64{header.index_table_entries} * sizeof(PSFRawEntry);
+    if (index_end > size || header.key_table_offset > size || header.data_table_offset > size) {
+        return false;
+    }
+
+    // Validate every entry up front so lookups can skip bounds checks.
+    buffer = psf_buffer;
+    for (u32 i = 0; i < header.index_table_entries; i++) {
+        const PSFRawEntry entry = GetRawEntry(i);
+        const u64 key_offset = u64{header.key_table_offset} + entry.key_offset;
+        const u64 data_offset = u64{header.data_table_offset} + entry.data_offset;
+        const auto fmt = static_cast<PSFEntryFmt>(entry.param_fmt.Raw());
+        const bool valid_fmt = fmt == PSFEntryFmt::Binary || fmt == PSFEntryFmt::Text ||
+                               (fmt == PSFEntryFmt::Integer && entry.param_len == sizeof(s32));
+        if (!valid_fmt || key_offset >= size ||
+            std::memchr(buffer.data() + key_offset, 0, size - key_offset) == nullptr ||
+            data_offset + entry.param_len > size) {
+            buffer = {};
+            return false;
+        }
+    }
+    return true;
+}
+
+std::optional<std::span<const u8>> PsfView::GetBinary(std::string_view key) const {
+    return Find(key, PSFEntryFmt::Binary);
+}
+
+std::optional<std::string_view> PsfView::GetString(std::string_view key) const {
+    const auto data = Find(key, PSFEntryFmt::Text);
+    if (!data) {
+        return {};
+    }
+    const auto* str = reinterpret_cast<const char*>(data->data());
+    return std::string_view{str, strnlen(str, data->size())};
+}
+
+std::optional<s32> PsfView::GetInteger(std::string_view key) const {
+    const auto data = Find(key, PSFEntryFmt::Integer);
+    if (!data) {
+        return {};
+    }
+    s32 value;
+    std::memcpy(&value, data->data(), sizeof(value));
+    return value;
+}
+
+std::optional<std::span<const u8>> PsfView::Find(std::string_view key, PSFEntryFmt fmt) const {
+    if (buffer.empty()) {
+        return {};
+    }
+    for (u32 i = 0; i < header.index_table_entries; i++) {
+        const PSFRawEntry entry = GetRawEntry(i);
+        if (GetKey(entry) == key) {
+            if (static_cast<PSFEntryFmt>(entry.param_fmt.Raw()) != fmt) {
+                return {};
+            }
+            return buffer.subspan(header.data_table_offset + entry.data_offset, entry.param_len);
+        }
+    }
+    return {};
+}
+
+std::string_view PsfView::GetKey(const PSFRawEntry& entry) const {
+    return reinterpret_cast<const char*>(buffer.data() + header.key_table_offset +
+                                         entry.key_offset);
+}
+
+PSFRawEntry PsfView::GetRawEntry(u32 index) const {
+    PSFRawEntry entry;
+    std::memcpy(&entry, buffer.data() + sizeof(PSFHeader) + index * sizeof(PSFRawEntry),
+                sizeof(entry));
+    return entry;
+}
@@ -5,6 +5,7 @@
 
 #include <chrono>
 #include <filesystem>
+#include <optional>
 #include <span>
 #include <string>
 #include <string_view>
@@ -93,3 +94,22 @@ private:
     [[nodiscard]] std::pair<std::vector<Entry>::const_iterator, size_t> FindEntry(
         std::string_view key) const;
 };
+
+/// Read-only view over an encoded param.sfo. Open validates the header and index table once,
+/// lookups then read straight from the borrowed buffer without allocating.
+class PsfView {
+public:
+    bool Open(std::span<const u8> psf_buffer);
+
+    std::optional<std::span<const u8>> GetBinary(std::string_view key) const;
+    std::optional<std::string_view> GetString(std::string_view key) const;
+    std::optional<s32> GetInteger(std::string_view key) const;
+
+private:
+    std::optional<std::span<const u8>> Find(std::string_view key, PSFEntryFmt fmt) const;
+    std::string_view GetKey(const PSFRawEntry& entry) const;
+    PSFRawEntry GetRawEntry(u32 index) const;
+
+    std::span<const u8> buffer;
+    PSFHeader header{};
+};
@@ -1,29 +1,20 @@
 // SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iterator>
 #include "common/config.h"
 #include "common/logging/log.h"
+#include "common/parallel_for.h"
 #include "common/path_util.h"
+#include "core/file_format/pkg.h"
 #include "trp.h"
 
 TRP::TRP() = default;
 TRP::~TRP() = default;
 
-void TRP::GetNPcommID(const std::filesystem::path& trophyPath, int index) {
-    std::filesystem::path trpPath = trophyPath / "sce_sys/npbind.dat";
-    Common::FS::IOFile npbindFile(trpPath, Common::FS::FileAccessMode::Read);
-    if (!npbindFile.IsOpen()) {
-        LOG_CRITICAL(Common_Filesystem, "Failed to open npbind.dat file");
-        return;
-    }
-    if (!npbindFile.Seek(0x84 + (index * 0x180))) {
-        LOG_CRITICAL(Common_Filesystem, "Failed to seek to NPbind offset");
-        return;
-    }
-    npbindFile.ReadRaw<u8>(np_comm_id.data(), 12);
-    std::fill(np_comm_id.begin() + 12, np_comm_id.end(), 0); // fill with 0, we need 16 bytes.
-}
-
 static void removePadding(std::vector<u8>& vec) {
     for (auto it = vec.rbegin(); it != vec.rend(); ++it) {
         if (*it == '>') {
@@ -41,6 +32,26 @@ static void hexToBytes(const char* hex, unsigned char* dst) {
     }
 }
 
+std::vector<std::array<u8, 16>> TRP::ParseNpBind(std::span<const u8> npbind) {
+    std::vector<std::array<u8, 16>> ids;
+    for (size_t pos = 0x84; pos + 12 <= npbind.size(); pos += 0x180) {
+        auto& id = ids.emplace_back(); // zero padded, we need 16 bytes.
+        std::memcpy(id.data(), npbind.data() + pos, 12);
+    }
+    return ids;
+}
+
+bool TRP::GetUserKey(std::array<u8, 16>& user_key) {
+    const auto user_key_str = Config::getTrophyKey();
+    if (user_key_str.size() != 32) {
+        LOG_CRITICAL(Common_Filesystem, "Trophy decryption key is not specified");
+        return false;
+    }
+    user_key.fill(0);
+    hexToBytes(user_key_str.c_str(), user_key.data());
+    return true;
+}
+
 bool TRP::Extract(const std::filesystem::path& trophyPath, const std::string titleId) {
     std::filesystem::path gameSysDir = trophyPath / "sce_sys/trophy/";
     if (!std::filesystem::exists(gameSysDir)) {
@@ -48,91 +59,217 @@ bool TRP::Extract(const std::filesystem::path& trophyPath, const std::string tit
         return false;
     }
 
-    const auto user_key_str = Config::getTrophyKey();
-    if (user_key_str.size() != 32) {
-        LOG_CRITICAL(Common_Filesystem, "Trophy decryption key is not specified");
+    std::array<u8, 16> user_key{};
+    if (!GetUserKey(user_key)) {
         return false;
     }
 
-    std::array<CryptoPP::byte, 16> user_key{};
-    hexToBytes(user_key_str.c_str(), user_key.data());
+    // npbind.dat lists the NP communication ID of every trophy set, read it only once.
+    std::vector<u8> npbind;
+    Common::FS::IOFile npbindFile(trophyPath / "sce_sys/npbind.dat",
+                                  Common::FS::FileAccessMode::Read);
+    if (npbindFile.IsOpen()) {
+        npbind.resize(npbindFile.GetSize());
+        npbindFile.Read(npbind);
+    } else {
+        LOG_CRITICAL(Common_Filesystem, "Failed to open npbind.dat file");
+    }
+    const auto np_comm_ids = ParseNpBind(npbind);
 
-    for (int index = 0; const auto& it : std::filesystem::directory_iterator(gameSysDir)) {
+    // trophyNN.trp belongs to the NN-th npbind.dat entry, directory order is unspecified.
+    std::vector<std::filesystem::path> trp_paths;
+    for (const auto& it : std::filesystem::directory_iterator(gameSysDir)) {
         if (it.is_regular_file()) {
-            GetNPcommID(trophyPath, index);
+            trp_paths.push_back(it.path());
+        }
+    }
+    std::ranges::sort(trp_paths);
+
+    struct TrpJob {
+        std::filesystem::path path;
+        std::array<u8, 16> np_comm_id{};
+    };
+    std::vector<TrpJob> jobs;
+    for (size_t index = 0; index < trp_paths.size(); index++) {
+        auto& job = jobs.emplace_back(trp_paths[index]);
+        if (index < np_comm_ids.size()) {
+            job.np_comm_id = np_comm_ids[index];
+        }
+    }
+
+    const auto trophy_dir =
+        Common::FS::GetUserPath(Common::FS::PathType::MetaDataDir) / titleId / "TrophyFiles";
+    std::atomic<bool> success{true};
+    Common::ParallelFor(jobs.size(), 0, [&](size_t n) {
+        const auto& job = jobs[n];
+        Common::FS::IOFile file(job.path, Common::FS::FileAccessMode::Read);
+        if (!file.IsOpen()) {
+            LOG_CRITICAL(Common_Filesystem, "Unable to open trophy file for read");
+            success = false;
+            return;
+        }
+        std::vector<u8> trp(file.GetSize());
+        if (file.Read(trp) != trp.size() ||
+            !ExtractTrp(trp, user_key, job.np_comm_id, trophy_dir / job.path.stem())) {
+            success = false;
+        }
+    });
+    return success;
+}
+
+bool TRP::ExtractTrp(std::span<const u8> trp, std::span<const u8, 16> user_key,
+                     std::span<const u8, 16> np_comm_id, const std::filesystem::path& outDir) {
+    // This runs on ParallelFor workers, where a filesystem exception would terminate.
+    std::error_code ec;
+    std::filesystem::create_directories(outDir / "Icons", ec);
+    if (!ec) {
+        std::filesystem::create_directory(outDir / "Xml", ec);
+    }
+    if (ec) {
+        LOG_CRITICAL(Common_Filesystem, "Failed to create trophy directory {}: {}",
+                     fmt::UTF(outDir.u8string()), ec.message());
+        return false;
+    }
+    return ParseTrp(trp, user_key, np_comm_id, [&](const auto& name, std::span<const u8> data) {
+        const auto path = outDir / name;
+        const size_t written = Common::FS::IOFile::WriteBytes(path, data);
+        if (written != data.size()) {
+            LOG_CRITICAL(Common_Filesystem,
+                         "Trophy file {} write failed, wanted to write {} bytes, wrote {}",
+                         fmt::UTF(path.u8string()), data.size(), written);
+            return false;
+        }
+        return true;
+    });
+}
+
+bool TRP::ParseTrp(std::span<const u8> trp, std::span<const u8, 16> user_key,
+                   std::span<const u8, 16> np_comm_id, const Sink& sink) {
+    TrpHeader header;
+    if (trp.size() < sizeof(header)) {
+        LOG_CRITICAL(Common_Filesystem, "Trophy file is truncated");
+        return false;
+    }
+    std::memcpy(&header, trp.data(), sizeof(header));
+    if (header.magic != 0xDCA24D00) {
+        LOG_CRITICAL(Common_Filesystem, "Wrong trophy magic number");
+        return false;
+    }
+
+    const u32 entry_num = header.entry_num;
+    const u32 entry_size = header.entry_size;
+    if (entry_size < sizeof(TrpEntry) ||
+        u64{entry_num} * entry_size > trp.size() - sizeof(TrpHeader)) {
+        LOG_CRITICAL(Common_Filesystem, "Invalid TRP entry table");
+        return false;
+    }
+
+    const bool has_np_comm_id = np_comm_id[0] == 'N' && np_comm_id[1] == 'P';
+    u64 entryPos = sizeof(TrpHeader);
+    for (u32 i = 0; i < entry_num; i++, entryPos += entry_size) {
+        TrpEntry entry;
+        std::memcpy(&entry, trp.data() + entryPos, sizeof(entry));
 
-            Common::FS::IOFile file(it.path(), Common::FS::FileAccessMode::Read);
-            if (!file.IsOpen()) {
-                LOG_CRITICAL(Common_Filesystem, "Unable to open trophy file for read");
+        const u64 pos = entry.entry_pos;
+        const u64 len = entry.entry_len;
+        if (pos > trp.size() || len > trp.size() - pos) {
+            LOG_CRITICAL(Common_Filesystem, "TRP entry is out of bounds");
+            return false;
+        }
+        const auto data = trp.subspan(pos, len);
+        const std::string_view name(entry.entry_name, strnlen(entry.entry_name, 32));
+
+        if (entry.flag == 0 && name.find("TROP") != std::string::npos) { // PNG
+            if (!sink(std::filesystem::path("Icons") / name, data)) {
                 return false;
             }
-
-            TrpHeader header;
-            file.Read(header);
-            if (header.magic != 0xDCA24D00) {
-                LOG_CRITICAL(Common_Filesystem, "Wrong trophy magic number");
+        }
+        if (entry.flag == 3 && has_np_comm_id && len >= iv_len) { // ESFM, encrypted.
+            // The first 16 bytes are the iv key on every entry, skip them as we want a clean
+            // xml file.
+            const auto esfmIv = data.first<iv_len>();
+            const auto ESFM = data.subspan(iv_len);
+            std::vector<u8> XML(ESFM.size());
+            crypto.decryptEFSM(user_key, np_comm_id, esfmIv, ESFM, XML); // decrypt
+            removePadding(XML);
+            std::string xml_name{name};
+            size_t xml_pos = xml_name.find("ESFM");
+            if (xml_pos != std::string::npos)
+                xml_name.replace(xml_pos, xml_name.length(), "XML");
+            if (!sink(std::filesystem::path("Xml") / xml_name, XML)) {
                 return false;
             }
+        }
+    }
+    return true;
+}
 
-            s64 seekPos = sizeof(TrpHeader);
-            std::filesystem::path trpFilesPath(
-                Common::FS::GetUserPath(Common::FS::PathType::MetaDataDir) / titleId /
-                "TrophyFiles" / it.path().stem());
-            std::filesystem::create_directories(trpFilesPath / "Icons");
-            std::filesystem::create_directory(trpFilesPath / "Xml");
-
-            for (int i = 0; i < header.entry_num; i++) {
-                if (!file.Seek(seekPos)) {
-                    LOG_CRITICAL(Common_Filesystem, "Failed to seek to TRP entry offset");
-                    return false;
-                }
-                seekPos += (s64)header.entry_size;
-                TrpEntry entry;
-                file.Read(entry);
-                std::string_view name(entry.entry_name);
-                if (entry.flag == 0 && name.find("TROP") != std::string::npos) { // PNG
-                    if (!file.Seek(entry.entry_pos)) {
-                        LOG_CRITICAL(Common_Filesystem, "Failed to seek to TRP entry offset");
-                        return false;
-                    }
-                    std::vector<u8> icon(entry.entry_len);
-                    file.Read(icon);
-                    Common::FS::IOFile::WriteBytes(trpFilesPath / "Icons" / name, icon);
-                }
-                if (entry.flag == 3 && np_comm_id[0] == 'N' &&
-                    np_comm_id[1] == 'P') { // ESFM, encrypted.
-                    if (!file.Seek(entry.entry_pos)) {
-                        LOG_CRITICAL(Common_Filesystem, "Failed to seek to TRP entry offset");
-                        return false;
-                    }
-                    file.Read(esfmIv); // get iv key.
-                    // Skip the first 16 bytes which are the iv key on every entry as we want a
-                    // clean xml file.
-                    std::vector<u8> ESFM(entry.entry_len - iv_len);
-                    std::vector<u8> XML(entry.entry_len - iv_len);
-                    if (!file.Seek(entry.entry_pos + iv_len)) {
-                        LOG_CRITICAL(Common_Filesystem, "Failed to seek to TRP entry + iv offset");
-                        return false;
-                    }
-                    file.Read(ESFM);
-                    crypto.decryptEFSM(user_key, np_comm_id, esfmIv, ESFM, XML); // decrypt
-                    removePadding(XML);
-                    std::string xml_name = entry.entry_name;
-                    size_t pos = xml_name.find("ESFM");
-                    if (pos != std::string::npos)
-                        xml_name.replace(pos, xml_name.length(), "XML");
-                    std::filesystem::path path = trpFilesPath / "Xml" / xml_name;
-                    size_t written = Common::FS::IOFile::WriteBytes(path, XML);
-                    if (written != XML.size()) {
-                        LOG_CRITICAL(
-                            Common_Filesystem,
-                            "Trophy XML {} write failed, wanted to write {} bytes, wrote {}",
-                            fmt::UTF(path.u8string()), XML.size(), written);
-                    }
-                }
-            }
+bool TRP::ReadPkgTrophySets(PKG& pkg, std::vector<PkgTrophySet>& sets) {
+    std::string failreason;
+    std::vector<u8> npbind;
+    if (!pkg.ReadEntry(0x403, npbind, failreason)) {
+        LOG_CRITICAL(Common_Filesystem, "Failed to read npbind.dat from PKG: {}", failreason);
+    }
+    const auto np_comm_ids = ParseNpBind(npbind);
+
+    // trophy00.trp to trophy99.trp, entry trophyNN belongs to the NN-th npbind.dat entry.
+    for (u32 index = 0; index < 100; index++) {
+        const u32 id = 0x1400 + index;
+        if (!pkg.HasEntry(id)) {
+            continue;
+        }
+        auto& set = sets.emplace_back();
+        set.name = fmt::format("trophy{:02}", index);
+        if (!pkg.ReadEntry(id, set.data, failreason)) {
+            LOG_CRITICAL(Common_Filesystem, "Failed to read {} from PKG: {}", set.name, failreason);
+            return false;
+        }
+        if (index < np_comm_ids.size()) {
+            set.np_comm_id = np_comm_ids[index];
         }
-        index++;
     }
     return true;
 }
+
+bool TRP::ExtractFromPkg(PKG& pkg, const std::filesystem::path& outDir) {
+    std::array<u8, 16> user_key{};
+    std::vector<PkgTrophySet> sets;
+    if (!GetUserKey(user_key) || !ReadPkgTrophySets(pkg, sets)) {
+        return false;
+    }
+
+    std::atomic<bool> success{true};
+    Common::ParallelFor(sets.size(), 0, [&](size_t n) {
+        const auto& set = sets[n];
+        if (!ExtractTrp(set.data, user_key, set.np_comm_id, outDir / set.name)) {
+            success = false;
+        }
+    });
+    return success;
+}
+
+bool TRP::LoadFromPkg(PKG& pkg, std::vector<TrophyFile>& files) {
+    std::array<u8, 16> user_key{};
+    std::vector<PkgTrophySet> sets;
+    if (!GetUserKey(user_key) || !ReadPkgTrophySets(pkg, sets)) {
+        return false;
+    }
+
+    std::vector<std::vector<TrophyFile>> results(sets.size());
+    std::atomic<bool> success{true};
+    Common::ParallelFor(sets.size(), 0, [&](size_t n) {
+        const auto& set = sets[n];
+        const auto sink = [&](const std::filesystem::path& name, std::span<const u8> data) {
+            results[n].push_back({set.name / name, {data.begin(), data.end()}});
+            return true;
+        };
+        if (!ParseTrp(set.data, user_key, set.np_comm_id, sink)) {
+            success = false;
+        }
+    });
+
+    for (auto& result : results) {
+        std::ranges::move(result, std::back_inserter(files));
+    }
+    return success;
+}
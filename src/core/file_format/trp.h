@@ -3,6 +3,9 @@
 
 #pragma once
 
+#include <array>
+#include <functional>
+#include <span>
 #include <vector>
 #include "common/endian.h"
 #include "common/io_file.h"
@@ -29,18 +32,52 @@ struct TrpEntry {
     unsigned char padding[12];
 };
 
+class PKG;
+
+/// A decrypted trophy file, path is relative to the title's TrophyFiles folder.
+struct TrophyFile {
+    std::filesystem::path path;
+    std::vector<u8> data;
+};
+
 class TRP {
 public:
+    /// Receives each output file of a TRP, path is relative to its trophy set folder.
+    using Sink = std::function<bool(const std::filesystem::path& path, std::span<const u8> data)>;
+
     TRP();
     ~TRP();
     bool Extract(const std::filesystem::path& trophyPath, const std::string titleId);
-    void GetNPcommID(const std::filesystem::path& trophyPath, int index);
+
+    /// Like Extract, but reads the trophy sets and npbind.dat straight from the PKG entry table
+    /// instead of an extracted sce_sys folder. The PKG only needs to be opened.
+    bool ExtractFromPkg(PKG& pkg, const std::filesystem::path& outDir);
+
+    /// Decrypts the trophy sets of a PKG into memory without touching the disk.
+    bool LoadFromPkg(PKG& pkg, std::vector<TrophyFile>& files);
+
+    /// Writes the icons and decrypted XML files of an in-memory TRP file to outDir.
+    bool ExtractTrp(std::span<const u8> trp, std::span<const u8, 16> user_key,
+                    std::span<const u8, 16> np_comm_id, const std::filesystem::path& outDir);
+
+    /// Passes the icons and decrypted XML files of an in-memory TRP file to sink.
+    bool ParseTrp(std::span<const u8> trp, std::span<const u8, 16> user_key,
+                  std::span<const u8, 16> np_comm_id, const Sink& sink);
+
+    /// Returns the 16 byte (zero padded) NP communication IDs listed in npbind.dat.
+    static std::vector<std::array<u8, 16>> ParseNpBind(std::span<const u8> npbind);
+
+    /// Parses the configured trophy key, returns false if it is missing or malformed.
+    static bool GetUserKey(std::array<u8, 16>& user_key);
 
 private:
+    struct PkgTrophySet {
+        std::string name;
+        std::vector<u8> data;
+        std::array<u8, 16> np_comm_id{};
+    };
+    bool ReadPkgTrophySets(PKG& pkg, std::vector<PkgTrophySet>& sets);
+
     Crypto crypto;
-    std::vector<u8> NPcommID = std::vector<u8>(12);
-    std::array<u8, 16> np_comm_id{};
-    std::array<u8, 16> esfmIv{};
-    std::filesystem::path trpFilesPath;
     static constexpr int iv_len = 16;
 };
\ No newline at end of file
@@ -19,11 +19,123 @@ std::string RemoveTrailingSlashes(const std::string& path) {
     return path_sanitized;
 }
 
+std::optional<std::filesystem::path> HostPathIndex::Resolve(const std::filesystem::path& root,
+                                                           std::string_view rel_path) {
+    auto current_path = root;
+    while (!rel_path.empty()) {
+        const size_t end = std::min(rel_path.find('/'), rel_path.size());
+        const auto part = rel_path.substr(0, end);
+        rel_path.remove_prefix(std::min(end + 1, rel_path.size()));
+        if (part.empty() || part == ".") {
+            continue;
+        }
+        if (part == "..") {
+            current_path = current_path.parent_path();
+            continue;
+        }
+
+        const auto find = [&](const Listing& listing) -> const std::string* {
+            auto it = listing.find(std::string{part});
+            if (it == listing.end()) {
+                it = listing.find(Common::ToLower(part));
+            }
+            return it != listing.end() ? &it->second : nullptr;
+        };
+        bool from_cache = false;
+        auto listing = GetListing(current_path, false, from_cache);
+        const std::string* name = listing ? find(*listing) : nullptr;
+        if (!name && from_cache) {
+            // Save data and backups are written on the host without invalidating, look again.
+            listing = GetListing(current_path, true, from_cache);
+            name = listing ? find(*listing) : nullptr;
+        }
+        if (!name) {
+            return std::nullopt;
+        }
+        current_path /= *name;
+    }
+    return current_path;
+}
+
+std::shared_ptr<const HostPathIndex::Listing> HostPathIndex::GetListing(
+    const std::filesystem::path& dir, bool refresh, bool& from_cache) {
+    auto key = dir.string();
+    u64 generation;
+    {
+        std::shared_lock lock{m_mutex};
+        if (const auto it = m_listings.find(key); it != m_listings.end() && !refresh) {
+            from_cache = true;
+            return it->second;
+        }
+        generation = m_generation;
+    }
+    from_cache = false;
+
+    // List the directory without holding the lock, lookups in other directories go on.
+    std::error_code ec;
+    std::vector<std::string> names;
+    for (auto it = std::filesystem::directory_iterator(dir, ec);
+         !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+        names.push_back(it->path().filename().string());
+    }
+    if (ec) {
+        return nullptr;
+    }
+
+    // Exact names take precedence over case-insensitive matches of other entries.
+    auto listing = std::make_shared<Listing>();
+    for (const auto& name : names) {
+        listing->emplace(name, name);
+    }
+    for (const auto& name : names) {
+        listing->try_emplace(Common::ToLower(name), name);
+    }
+
+    std::unique_lock lock{m_mutex};
+    if (generation != m_generation) {
+        // Something changed while listing, use the result once but do not keep it.
+        return listing;
+    }
+    return m_listings.insert_or_assign(std::move(key), std::move(listing)).first->second;
+}
+
+void HostPathIndex::Invalidate(const std::filesystem::path& host_path) {
+    const auto key = host_path.string();
+    std::unique_lock lock{m_mutex};
+    m_generation++;
+    m_listings.erase(host_path.parent_path().string());
+    for (auto it = m_listings.begin(); it != m_listings.end();) {
+        const auto& dir = it->first;
+        if (dir.starts_with(key) && (dir.size() == key.size() || dir[key.size()] == '/')) {
+            it = m_listings.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void HostPathIndex::Clear() {
+    std::unique_lock lock{m_mutex};
+    m_generation++;
+    m_listings.clear();
+}
+
 void MntPoints::Mount(const std::filesystem::path& host_folder, const std::string& guest_folder,
                       bool read_only) {
+    // Look for an update overlay once here instead of on every path lookup.
+    std::filesystem::path patch_path = host_folder;
+    patch_path += "-UPDATE";
+    if (!std::filesystem::exists(patch_path)) {
+        patch_path = host_folder;
+        patch_path += "-patch";
+        if (!std::filesystem::exists(patch_path)) {
+            patch_path.clear();
+        }
+    }
+
     std::scoped_lock lock{m_mutex};
     const auto guest_folder_sanitized = RemoveTrailingSlashes(guest_folder);
-    m_mnt_pairs.emplace_back(host_folder, guest_folder_sanitized, read_only);
+    m_mnt_pairs.emplace_back(host_folder, guest_folder_sanitized, read_only, patch_path);
 }
 
 void MntPoints::Unmount(const std::filesystem::path& host_folder, const std::string& guest_folder) {
@@ -33,11 +145,13 @@ void MntPoints::Unmount(const std::filesystem::path& host_folder, const std::str
         return pair.mount == guest_folder_sanitized;
     });
     m_mnt_pairs.erase(it, m_mnt_pairs.end());
+    m_path_index.Clear();
 }
 
 void MntPoints::UnmountAll() {
     std::scoped_lock lock{m_mutex};
     m_mnt_pairs.clear();
+    m_path_index.Clear();
 }
 
 std::filesystem::path MntPoints::GetHostPath(std::string_view path, bool* is_read_only,
@@ -68,81 +182,26 @@ std::filesystem::path MntPoints::GetHostPath(std::string_view path, bool* is_rea
     // Remove device (e.g /app0) from path to retrieve relative path.
     const auto rel_path = std::string_view{corrected_path}.substr(mount->mount.size() + 1);
     std::filesystem::path host_path = mount->host_path / rel_path;
-    std::filesystem::path patch_path = mount->host_path;
-    patch_path += "-UPDATE";
-    if (!std::filesystem::exists(patch_path)) {
-        patch_path = mount->host_path;
-        patch_path += "-patch";
-    }
-    patch_path /= rel_path;
-
-    if ((corrected_path.starts_with("/app0") || corrected_path.starts_with("/hostapp")) &&
-        !force_base_path && std::filesystem::exists(patch_path)) {
-        return patch_path;
-    }
+    const bool use_patch =
+        !force_base_path && !mount->patch_path.empty() &&
+        (corrected_path.starts_with("/app0") || corrected_path.starts_with("/hostapp"));
 
     if (!NeedsCaseInsensitiveSearch) {
-        return host_path;
-    }
-
-    const auto search = [&](const auto host_path) {
-        // If the path does not exist attempt to verify this.
-        // Retrieve parent path until we find one that exists.
-        std::scoped_lock lk{m_mutex};
-        path_parts.clear();
-        auto current_path = host_path;
-        while (!std::filesystem::exists(current_path)) {
-            // We have probably cached this if it's a folder.
-            if (auto it = path_cache.find(current_path); it != path_cache.end()) {
-                current_path = it->second;
-                break;
+        if (use_patch) {
+            auto patch_path = mount->patch_path / rel_path;
+            if (std::filesystem::exists(patch_path)) {
+                return patch_path;
             }
-            path_parts.emplace_back(current_path.filename());
-            current_path = current_path.parent_path();
         }
-        // We have found an anchor. Traverse parts we recoded and see if they
-        // exist in filesystem but in different case.
-        auto guest_path = current_path;
-        while (!path_parts.empty()) {
-            const auto part = path_parts.back();
-            const auto add_match = [&](const auto& host_part) {
-                current_path /= host_part;
-                guest_path /= part;
-                path_cache[guest_path] = current_path;
-                path_parts.pop_back();
-            };
-            // Can happen when the mismatch is in upper folder.
-            if (std::filesystem::exists(current_path / part)) {
-                add_match(part);
-                continue;
-            }
-            const auto part_low = Common::ToLower(part.string());
-            bool found_match = false;
-            for (const auto& path : std::filesystem::directory_iterator(current_path)) {
-                const auto candidate = path.path().filename();
-                const auto filename = Common::ToLower(candidate.string());
-                // Check if a filename matches in case insensitive manner.
-                if (filename != part_low) {
-                    continue;
-                }
-                // We found a match, record the actual path in the cache.
-                add_match(candidate);
-                found_match = true;
-                break;
-            }
-            if (!found_match) {
-                return std::optional<std::filesystem::path>({});
-            }
-        }
-        return std::optional<std::filesystem::path>(current_path);
-    };
+        return host_path;
+    }
 
-    if (!force_base_path) {
-        if (const auto path = search(patch_path)) {
+    if (use_patch) {
+        if (auto path = m_path_index.Resolve(mount->patch_path, rel_path)) {
             return *path;
         }
     }
-    if (const auto path = search(host_path)) {
+    if (auto path = m_path_index.Resolve(mount->host_path, rel_path)) {
         return *path;
     }
 
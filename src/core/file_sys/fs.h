@@ -4,7 +4,10 @@
 #pragma once
 
 #include <atomic>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <shared_mutex>
 #include <string>
 #include <vector>
 #include <tsl/robin_map.h>
@@ -14,6 +17,35 @@
 
 namespace Core::FileSys {
 
+/**
+ * Resolves relative paths against a host directory, matching each component case-insensitively.
+ * Each directory is listed once, on first use, into a map from exact and lowercased names to real
+ * names, so repeated lookups are hash probes under a shared lock. Listings should be invalidated
+ * when the emulator creates, removes or renames entries. A name missing from a cached listing
+ * lists its directory again before failing, for entries created on the host by other means.
+ */
+class HostPathIndex {
+public:
+    /// Returns the real path of root / rel_path, or nullopt if some component does not exist.
+    std::optional<std::filesystem::path> Resolve(const std::filesystem::path& root,
+                                                 std::string_view rel_path);
+
+    /// Drops the listings of the given path, everything below it and its parent directory.
+    void Invalidate(const std::filesystem::path& host_path);
+    void Clear();
+
+private:
+    using Listing = tsl::robin_map<std::string, std::string>;
+
+    /// Lists dir unless a cached listing exists and refresh is false. from_cache tells which.
+    std::shared_ptr<const Listing> GetListing(const std::filesystem::path& dir, bool refresh,
+                                              bool& from_cache);
+
+    std::shared_mutex m_mutex;
+    tsl::robin_map<std::string, std::shared_ptr<const Listing>> m_listings;
+    u64 m_generation = 0; // Bumped on invalidation so listings read concurrently are not cached.
+};
+
 class MntPoints {
 #ifdef _WIN64
     static constexpr bool NeedsCaseInsensitiveSearch = false;
@@ -25,6 +57,7 @@ public:
         std::filesystem::path host_path;
         std::string mount; // e.g /app0
         bool read_only;
+        std::filesystem::path patch_path{}; // -UPDATE or -patch overlay, empty if there is none
     };
 
     explicit MntPoints() = default;
@@ -42,6 +75,13 @@ public:
     void IterateDirectory(std::string_view guest_directory,
                           const IterateDirectoryCallback& callback);
 
+    /// Must be called after creating, removing or renaming host_path.
+    void InvalidatePath(const std::filesystem::path& host_path) {
+        if constexpr (NeedsCaseInsensitiveSearch) {
+            m_path_index.Invalidate(host_path);
+        }
+    }
+
     const MntPair* GetMountFromHostPath(const std::string& host_path) {
         std::scoped_lock lock{m_mutex};
         const auto it = std::ranges::find_if(m_mnt_pairs, [&](const MntPair& mount) {
@@ -62,8 +102,7 @@ public:
 
 private:
     std::vector<MntPair> m_mnt_pairs;
-    std::vector<std::filesystem::path> path_parts;
-    tsl::robin_map<std::filesystem::path, std::filesystem::path> path_cache;
+    HostPathIndex m_path_index;
     std::mutex m_mutex;
 };
 
@@ -130,6 +130,9 @@ s32 PS4_SYSV_ABI open(const char* raw_path, s32 flags, u16 mode) {
             }
             // Create file if it doesn't exist
             Common::FS::IOFile out(file->m_host_name, Common::FS::FileAccessMode::Write);
+            if (!exists) {
+                mnt->InvalidatePath(file->m_host_name);
+            }
         } else if (!exists) {
             // File to open doesn't exist, return ENOENT
             h->DeleteHandle(handle);
@@ -463,6 +466,7 @@ s32 PS4_SYSV_ABI posix_mkdir(const char* path, u16 mode) {
         *__Error() = POSIX_EIO;
         return -1;
     }
+    mnt->InvalidatePath(dir_name);
 
     if (!std::filesystem::exists(dir_name)) {
         *__Error() = POSIX_ENOENT;
@@ -503,6 +507,7 @@ s32 PS4_SYSV_ABI posix_rmdir(const char* path) {
 
     std::error_code ec;
     s32 result = std::filesystem::remove_all(dir_name, ec);
+    mnt->InvalidatePath(dir_name);
 
     if (ec) {
         *__Error() = POSIX_EIO;
@@ -702,6 +707,7 @@ s32 PS4_SYSV_ABI posix_rename(const char* from, const char* to) {
         return -1;
     }
     std::filesystem::copy(src_path, dst_path, std::filesystem::copy_options::overwrite_existing);
+    mnt->InvalidatePath(dst_path);
     return ORBIS_OK;
 }
 
@@ -954,6 +960,7 @@ s32 PS4_SYSV_ABI posix_unlink(const char* path) {
     } else {
         file->f.Unlink();
     }
+    mnt->InvalidatePath(host_path);
 
     LOG_INFO(Kernel_Fs, "Unlinked {}", path);
     return ORBIS_OK;
@@ -1,8 +1,9 @@
 // SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <memory>
+#include <mutex>
 #include <unordered_map>
-#include <pugixml.hpp>
 
 #include "common/logging/log.h"
 #include "common/path_util.h"
@@ -10,6 +11,7 @@
 #include "core/libraries/libs.h"
 #include "core/libraries/np_trophy/np_trophy.h"
 #include "core/libraries/np_trophy/np_trophy_error.h"
+#include "core/libraries/np_trophy/trophy_db.h"
 #include "core/libraries/np_trophy/trophy_ui.h"
 
 namespace Libraries::NpTrophy {
@@ -28,11 +30,38 @@ struct ContextKeyHash {
 
 struct TrophyContext {
     u32 context_id;
+    std::shared_ptr<TrophyDb> db;
 };
 static Common::SlotVector<OrbisNpTrophyHandle> trophy_handles{};
 static Common::SlotVector<ContextKey> trophy_contexts{};
 static std::unordered_map<ContextKey, TrophyContext, ContextKeyHash> contexts_internal{};
 
+// All contexts of the running game share one parsed copy of its TROP.XML.
+static std::weak_ptr<TrophyDb> shared_trophy_db;
+// Guards the contexts and the shared database, trophy calls may come from any game thread.
+static std::mutex trophy_db_mutex;
+
+/// Returns the trophy state of a context, TROP.XML is parsed on first use.
+static std::shared_ptr<TrophyDb> GetTrophyDb(OrbisNpTrophyContext context) {
+    std::scoped_lock lock{trophy_db_mutex};
+    for (auto& [key, internal] : contexts_internal) {
+        if (internal.context_id != static_cast<u32>(context)) {
+            continue;
+        }
+        if (!internal.db) {
+            internal.db = shared_trophy_db.lock();
+        }
+        if (!internal.db) {
+            internal.db = std::make_shared<TrophyDb>(
+                Common::FS::GetUserPath(Common::FS::PathType::MetaDataDir) / game_serial /
+                "TrophyFiles");
+            shared_trophy_db = internal.db;
+        }
+        return internal.db;
+    }
+    return nullptr;
+}
+
 void ORBIS_NP_TROPHY_FLAG_ZERO(OrbisNpTrophyFlagArray* p) {
     for (int i = 0; i < ORBIS_NP_TROPHY_NUM_MAX; i++) {
         uint32_t array_index = i / 32;
@@ -154,6 +183,7 @@ s32 PS4_SYSV_ABI sceNpTrophyCreateContext(OrbisNpTrophyContext* context, int32_t
         return ORBIS_NP_TROPHY_ERROR_INVALID_ARGUMENT;
     }
 
+    std::scoped_lock lock{trophy_db_mutex};
     if (trophy_contexts.size() >= MaxTrophyContexts) {
         return ORBIS_NP_TROPHY_ERROR_CONTEXT_EXCEEDS_MAX;
     }
@@ -195,6 +225,7 @@ int PS4_SYSV_ABI sceNpTrophyDestroyContext(OrbisNpTrophyContext context) {
     Common::SlotId contextId;
     contextId.index = context;
 
+    std::scoped_lock lock{trophy_db_mutex};
     ContextKey contextkey = trophy_contexts[contextId];
     trophy_contexts.erase(contextId);
     contexts_internal.erase(contextkey);
@@ -246,66 +277,30 @@ int PS4_SYSV_ABI sceNpTrophyGetGameInfo(OrbisNpTrophyContext context, OrbisNpTro
     if (details->size != 0x4A0 || data->size != 0x20)
         return ORBIS_NP_TROPHY_ERROR_INVALID_ARGUMENT;
 
-    const auto trophy_dir =
-        Common::FS::GetUserPath(Common::FS::PathType::MetaDataDir) / game_serial / "TrophyFiles";
-    auto trophy_file = trophy_dir / "trophy00" / "Xml" / "TROP.XML";
-
-    pugi::xml_document doc;
-    pugi::xml_parse_result result = doc.load_file(trophy_file.native().c_str());
-
-    if (!result) {
-        LOG_ERROR(Lib_NpTrophy, "Failed to parse trophy xml : {}", result.description());
+    const auto db = GetTrophyDb(context);
+    if (!db) {
+        return ORBIS_NP_TROPHY_ERROR_INVALID_CONTEXT;
+    }
+    if (!db->IsLoaded()) {
         return ORBIS_OK;
     }
 
-    GameTrophyInfo game_info{};
-
-    auto trophyconf = doc.child("trophyconf");
-    for (const pugi::xml_node& node : trophyconf.children()) {
-        std::string_view node_name = node.name();
-
-        if (node_name == "title-name") {
-            strncpy(details->title, node.text().as_string(), ORBIS_NP_TROPHY_GAME_TITLE_MAX_SIZE);
-        }
-
-        if (node_name == "title-detail") {
-            strncpy(details->description, node.text().as_string(),
-                    ORBIS_NP_TROPHY_GAME_DESCR_MAX_SIZE);
-        }
-
-        if (node_name == "group")
-            game_info.num_groups++;
-
-        if (node_name == "trophy") {
-            bool current_trophy_unlockstate = node.attribute("unlockstate").as_bool();
-            std::string_view current_trophy_grade = node.attribute("ttype").value();
-
-            if (current_trophy_grade.empty()) {
-                continue;
-            }
-
-            game_info.num_trophies++;
-            int trophy_grade = GetTrophyGradeFromChar(current_trophy_grade.at(0));
-            game_info.num_trophies_by_rarity[trophy_grade]++;
+    strncpy(details->title, db->GetTitle().c_str(), ORBIS_NP_TROPHY_GAME_TITLE_MAX_SIZE);
+    strncpy(details->description, db->GetDescription().c_str(),
+            ORBIS_NP_TROPHY_GAME_DESCR_MAX_SIZE);
 
-            if (current_trophy_unlockstate) {
-                game_info.unlocked_trophies++;
-                game_info.unlocked_trophies_by_rarity[trophy_grade]++;
-            }
-        }
-    }
-
-    details->num_groups = game_info.num_groups;
+    const TrophyCounts game_info = db->GetCounts();
+    details->num_groups = db->GetNumGroups();
     details->num_trophies = game_info.num_trophies;
-    details->num_platinum = game_info.num_trophies_by_rarity[ORBIS_NP_TROPHY_GRADE_PLATINUM];
-    details->num_gold = game_info.num_trophies_by_rarity[ORBIS_NP_TROPHY_GRADE_GOLD];
-    details->num_silver = game_info.num_trophies_by_rarity[ORBIS_NP_TROPHY_GRADE_SILVER];
-    details->num_bronze = game_info.num_trophies_by_rarity[ORBIS_NP_TROPHY_GRADE_BRONZE];
+    details->num_platinum = game_info.num_by_grade[ORBIS_NP_TROPHY_GRADE_PLATINUM];
+    details->num_gold = game_info.num_by_grade[ORBIS_NP_TROPHY_GRADE_GOLD];
+    details->num_silver = game_info.num_by_grade[ORBIS_NP_TROPHY_GRADE_SILVER];
+    details->num_bronze = game_info.num_by_grade[ORBIS_NP_TROPHY_GRADE_BRONZE];
     data->unlocked_trophies = game_info.unlocked_trophies;
-    data->unlocked_platinum = game_info.unlocked_trophies_by_rarity[ORBIS_NP_TROPHY_GRADE_PLATINUM];
-    data->unlocked_gold = game_info.unlocked_trophies_by_rarity[ORBIS_NP_TROPHY_GRADE_GOLD];
-    data->unlocked_silver = game_info.unlocked_trophies_by_rarity[ORBIS_NP_TROPHY_GRADE_SILVER];
-    data->unlocked_bronze = game_info.unlocked_trophies_by_rarity[ORBIS_NP_TROPHY_GRADE_BRONZE];
+    data->unlocked_platinum = game_info.unlocked_by_grade[ORBIS_NP_TROPHY_GRADE_PLATINUM];
+    data->unlocked_gold = game_info.unlocked_by_grade[ORBIS_NP_TROPHY_GRADE_GOLD];
+    data->unlocked_silver = game_info.unlocked_by_grade[ORBIS_NP_TROPHY_GRADE_SILVER];
+    data->unlocked_bronze = game_info.unlocked_by_grade[ORBIS_NP_TROPHY_GRADE_BRONZE];
 
     // maybe this should be 1 instead of 100?
     data->progress_percentage = 100;
@@ -344,75 +339,35 @@ int PS4_SYSV_ABI sceNpTrophyGetGroupInfo(OrbisNpTrophyContext context, OrbisNpTr
     if (details->size != 0x4A0 || data->size != 0x28)
         return ORBIS_NP_TROPHY_ERROR_INVALID_ARGUMENT;
 
-    const auto trophy_dir =
-        Common::FS::GetUserPath(Common::FS::PathType::MetaDataDir) / game_serial / "TrophyFiles";
-    auto trophy_file = trophy_dir / "trophy00" / "Xml" / "TROP.XML";
-
-    pugi::xml_document doc;
-    pugi::xml_parse_result result = doc.load_file(trophy_file.native().c_str());
-
-    if (!result) {
-        LOG_ERROR(Lib_NpTrophy, "Failed to open trophy xml : {}", result.description());
+    const auto db = GetTrophyDb(context);
+    if (!db) {
+        return ORBIS_NP_TROPHY_ERROR_INVALID_CONTEXT;
+    }
+    if (!db->IsLoaded()) {
         return ORBIS_OK;
     }
 
-    GroupTrophyInfo group_info{};
-
-    auto trophyconf = doc.child("trophyconf");
-    for (const pugi::xml_node& node : trophyconf.children()) {
-        std::string_view node_name = node.name();
-
-        if (node_name == "group") {
-            int current_group_id = node.attribute("id").as_int(ORBIS_NP_TROPHY_INVALID_GROUP_ID);
-            if (current_group_id != ORBIS_NP_TROPHY_INVALID_GROUP_ID) {
-                if (current_group_id == groupId) {
-                    std::string_view current_group_name = node.child("name").text().as_string();
-                    std::string_view current_group_description =
-                        node.child("detail").text().as_string();
-
-                    strncpy(details->title, current_group_name.data(),
-                            ORBIS_NP_TROPHY_GROUP_TITLE_MAX_SIZE);
-                    strncpy(details->description, current_group_description.data(),
-                            ORBIS_NP_TROPHY_GAME_DESCR_MAX_SIZE);
-                }
-            }
-        }
-
-        details->group_id = groupId;
-        data->group_id = groupId;
-
-        if (node_name == "trophy") {
-            bool current_trophy_unlockstate = node.attribute("unlockstate").as_bool();
-            std::string_view current_trophy_grade = node.attribute("ttype").value();
-            int current_trophy_group_id = node.attribute("gid").as_int(-1);
-
-            if (current_trophy_grade.empty()) {
-                continue;
-            }
-
-            if (current_trophy_group_id == groupId) {
-                group_info.num_trophies++;
-                int trophyGrade = GetTrophyGradeFromChar(current_trophy_grade.at(0));
-                group_info.num_trophies_by_rarity[trophyGrade]++;
-                if (current_trophy_unlockstate) {
-                    group_info.unlocked_trophies++;
-                    group_info.unlocked_trophies_by_rarity[trophyGrade]++;
-                }
-            }
-        }
+    std::string group_name;
+    std::string group_description;
+    if (db->GetGroupText(groupId, group_name, group_description)) {
+        strncpy(details->title, group_name.c_str(), ORBIS_NP_TROPHY_GROUP_TITLE_MAX_SIZE);
+        strncpy(details->description, group_description.c_str(),
+                ORBIS_NP_TROPHY_GAME_DESCR_MAX_SIZE);
     }
 
+    const TrophyCounts group_info = db->GetGroupCounts(groupId);
+    details->group_id = groupId;
+    data->group_id = groupId;
     details->num_trophies = group_info.num_trophies;
-    details->num_platinum = group_info.num_trophies_by_rarity[ORBIS_NP_TROPHY_GRADE_PLATINUM];
-    details->num_gold = group_info.num_trophies_by_rarity[ORBIS_NP_TROPHY_GRADE_GOLD];
-    details->num_silver = group_info.num_trophies_by_rarity[ORBIS_NP_TROPHY_GRADE_SILVER];
-    details->num_bronze = group_info.num_trophies_by_rarity[ORBIS_NP_TROPHY_GRADE_BRONZE];
+    details->num_platinum = group_info.num_by_grade[ORBIS_NP_TROPHY_GRADE_PLATINUM];
+    details->num_gold = group_info.num_by_grade[ORBIS_NP_TROPHY_GRADE_GOLD];
+    details->num_silver = group_info.num_by_grade[ORBIS_NP_TROPHY_GRADE_SILVER];
+    details->num_bronze = group_info.num_by_grade[ORBIS_NP_TROPHY_GRADE_BRONZE];
     data->unlocked_trophies = group_info.unlocked_trophies;
-    data->unlocked_platinum =
-        group_info.unlocked_trophies_by_rarity[ORBIS_NP_TROPHY_GRADE_PLATINUM];
-    data->unlocked_gold = group_info.unlocked_trophies_by_rarity[ORBIS_NP_TROPHY_GRADE_GOLD];
-    data->unlocked_silver = group_info.unlocked_trophies_by_rarity[ORBIS_NP_TROPHY_GRADE_SILVER];
-    data->unlocked_bronze = group_info.unlocked_trophies_by_rarity[ORBIS_NP_TROPHY_GRADE_BRONZE];
+    data->unlocked_platinum = group_info.unlocked_by_grade[ORBIS_NP_TROPHY_GRADE_PLATINUM];
+    data->unlocked_gold = group_info.unlocked_by_grade[ORBIS_NP_TROPHY_GRADE_GOLD];
+    data->unlocked_silver = group_info.unlocked_by_grade[ORBIS_NP_TROPHY_GRADE_SILVER];
+    data->unlocked_bronze = group_info.unlocked_by_grade[ORBIS_NP_TROPHY_GRADE_BRONZE];
 
     // maybe this should be 1 instead of 100?
     data->progress_percentage = 100;
@@ -446,51 +401,27 @@ int PS4_SYSV_ABI sceNpTrophyGetTrophyInfo(OrbisNpTrophyContext context, OrbisNpT
     if (details->size != 0x498 || data->size != 0x18)
         return ORBIS_NP_TROPHY_ERROR_INVALID_ARGUMENT;
 
-    const auto trophy_dir =
-        Common::FS::GetUserPath(Common::FS::PathType::MetaDataDir) / game_serial / "TrophyFiles";
-    auto trophy_file = trophy_dir / "trophy00" / "Xml" / "TROP.XML";
-
-    pugi::xml_document doc;
-    pugi::xml_parse_result result = doc.load_file(trophy_file.native().c_str());
+    const auto db = GetTrophyDb(context);
+    if (!db) {
+        return ORBIS_NP_TROPHY_ERROR_INVALID_CONTEXT;
+    }
 
-    if (!result) {
-        LOG_ERROR(Lib_NpTrophy, "Failed to open trophy xml : {}", result.description());
+    const auto trophy = db->GetTrophy(trophyId);
+    if (!trophy || trophy->type == '\0') {
         return ORBIS_OK;
     }
 
-    auto trophyconf = doc.child("trophyconf");
-
-    for (const pugi::xml_node& node : trophyconf.children()) {
-        std::string_view node_name = node.name();
-
-        if (node_name == "trophy") {
-            int current_trophy_id = node.attribute("id").as_int(ORBIS_NP_TROPHY_INVALID_TROPHY_ID);
-            if (current_trophy_id == trophyId) {
-                bool current_trophy_unlockstate = node.attribute("unlockstate").as_bool();
-                std::string_view current_trophy_grade = node.attribute("ttype").value();
-                std::string_view current_trophy_name = node.child("name").text().as_string();
-                std::string_view current_trophy_description =
-                    node.child("detail").text().as_string();
-
-                uint64_t current_trophy_timestamp = node.attribute("timestamp").as_ullong();
-                int current_trophy_groupid = node.attribute("gid").as_int(-1);
-                bool current_trophy_hidden = node.attribute("hidden").as_bool();
-
-                details->trophy_id = trophyId;
-                details->trophy_grade = GetTrophyGradeFromChar(current_trophy_grade.at(0));
-                details->group_id = current_trophy_groupid;
-                details->hidden = current_trophy_hidden;
-
-                strncpy(details->name, current_trophy_name.data(), ORBIS_NP_TROPHY_NAME_MAX_SIZE);
-                strncpy(details->description, current_trophy_description.data(),
-                        ORBIS_NP_TROPHY_DESCR_MAX_SIZE);
-
-                data->trophy_id = trophyId;
-                data->unlocked = current_trophy_unlockstate;
-                data->timestamp.tick = current_trophy_timestamp;
-            }
-        }
-    }
+    details->trophy_id = trophyId;
+    details->trophy_grade = trophy->grade;
+    details->group_id = trophy->group_id;
+    details->hidden = trophy->hidden;
+
+    strncpy(details->name, trophy->name.c_str(), ORBIS_NP_TROPHY_NAME_MAX_SIZE);
+    strncpy(details->description, trophy->description.c_str(), ORBIS_NP_TROPHY_DESCR_MAX_SIZE);
+
+    data->trophy_id = trophyId;
+    data->unlocked = trophy->unlocked;
+    data->timestamp.tick = trophy->timestamp;
 
     return ORBIS_OK;
 }
@@ -511,37 +442,12 @@ s32 PS4_SYSV_ABI sceNpTrophyGetTrophyUnlockState(OrbisNpTrophyContext context,
 
     ORBIS_NP_TROPHY_FLAG_ZERO(flags);
 
-    const auto trophy_dir =
-        Common::FS::GetUserPath(Common::FS::PathType::MetaDataDir) / game_serial / "TrophyFiles";
-    auto trophy_file = trophy_dir / "trophy00" / "Xml" / "TROP.XML";
-
-    pugi::xml_document doc;
-    pugi::xml_parse_result result = doc.load_file(trophy_file.native().c_str());
-
-    if (!result) {
-        LOG_ERROR(Lib_NpTrophy, "Failed to open trophy XML: {}", result.description());
-        *count = 0;
-        return ORBIS_OK;
-    }
-
-    int num_trophies = 0;
-    auto trophyconf = doc.child("trophyconf");
-
-    for (const pugi::xml_node& node : trophyconf.children()) {
-        std::string_view node_name = node.name();
-        int current_trophy_id = node.attribute("id").as_int(ORBIS_NP_TROPHY_INVALID_TROPHY_ID);
-        bool current_trophy_unlockstate = node.attribute("unlockstate").as_bool();
-
-        if (node_name == "trophy") {
-            num_trophies++;
-        }
-
-        if (current_trophy_unlockstate) {
-            ORBIS_NP_TROPHY_FLAG_SET(current_trophy_id, flags);
-        }
+    const auto db = GetTrophyDb(context);
+    if (!db) {
+        return ORBIS_NP_TROPHY_ERROR_INVALID_CONTEXT;
     }
 
-    *count = num_trophies;
+    *count = db->GetUnlockState(flags);
     return ORBIS_OK;
 }
 
@@ -870,121 +776,28 @@ int PS4_SYSV_ABI sceNpTrophyUnlockTrophy(OrbisNpTrophyContext context, OrbisNpTr
     if (platinumId == nullptr)
         return ORBIS_NP_TROPHY_ERROR_INVALID_ARGUMENT;
 
-    const auto trophy_dir =
-        Common::FS::GetUserPath(Common::FS::PathType::MetaDataDir) / game_serial / "TrophyFiles";
-    auto trophy_file = trophy_dir / "trophy00" / "Xml" / "TROP.XML";
-
-    pugi::xml_document doc;
-    pugi::xml_parse_result result = doc.load_file(trophy_file.native().c_str());
-
-    if (!result) {
-        LOG_ERROR(Lib_NpTrophy, "Failed to parse trophy xml : {}", result.description());
-        return ORBIS_OK;
+    const auto db = GetTrophyDb(context);
+    if (!db) {
+        return ORBIS_NP_TROPHY_ERROR_INVALID_CONTEXT;
     }
 
     *platinumId = ORBIS_NP_TROPHY_INVALID_TROPHY_ID;
 
-    int num_trophies = 0;
-    int num_trophies_unlocked = 0;
-    pugi::xml_node platinum_node;
-
-    auto trophyconf = doc.child("trophyconf");
-
-    for (pugi::xml_node& node : trophyconf.children()) {
-        int current_trophy_id = node.attribute("id").as_int(ORBIS_NP_TROPHY_INVALID_TROPHY_ID);
-        bool current_trophy_unlockstate = node.attribute("unlockstate").as_bool();
-        const char* current_trophy_name = node.child("name").text().as_string();
-        std::string_view current_trophy_description = node.child("detail").text().as_string();
-        std::string_view current_trophy_type = node.attribute("ttype").value();
-
-        if (current_trophy_type == "P") {
-            platinum_node = node;
-            if (trophyId == current_trophy_id) {
-                return ORBIS_NP_TROPHY_ERROR_PLATINUM_CANNOT_UNLOCK;
-            }
-        }
-
-        if (std::string_view(node.name()) == "trophy") {
-            if (node.attribute("pid").as_int(-1) != ORBIS_NP_TROPHY_INVALID_TROPHY_ID) {
-                num_trophies++;
-                if (current_trophy_unlockstate) {
-                    num_trophies_unlocked++;
-                }
-            }
-
-            if (current_trophy_id == trophyId) {
-                if (current_trophy_unlockstate) {
-                    LOG_INFO(Lib_NpTrophy, "Trophy already unlocked");
-                    return ORBIS_NP_TROPHY_ERROR_TROPHY_ALREADY_UNLOCKED;
-                } else {
-                    if (node.attribute("unlockstate").empty()) {
-                        node.append_attribute("unlockstate") = "true";
-                    } else {
-                        node.attribute("unlockstate").set_value("true");
-                    }
-
-                    auto trophyTimestamp = std::chrono::duration_cast<std::chrono::seconds>(
-                                               std::chrono::system_clock::now().time_since_epoch())
-                                               .count();
-
-                    if (node.attribute("timestamp").empty()) {
-                        node.append_attribute("timestamp") =
-                            std::to_string(trophyTimestamp).c_str();
-                    } else {
-                        node.attribute("timestamp")
-                            .set_value(std::to_string(trophyTimestamp).c_str());
-                    }
-
-                    std::string trophy_icon_file = "TROP";
-                    trophy_icon_file.append(node.attribute("id").value());
-                    trophy_icon_file.append(".PNG");
-
-                    std::filesystem::path current_icon_path =
-                        trophy_dir / "trophy00" / "Icons" / trophy_icon_file;
-
-                    AddTrophyToQueue(current_icon_path, current_trophy_name, current_trophy_type);
-                }
-            }
-        }
+    const TrophyUnlockResult result = db->Unlock(trophyId);
+    if (result.error != ORBIS_OK) {
+        return result.error;
     }
 
-    if (!platinum_node.attribute("unlockstate").as_bool()) {
-        if ((num_trophies - 1) == num_trophies_unlocked) {
-            if (platinum_node.attribute("unlockstate").empty()) {
-                platinum_node.append_attribute("unlockstate") = "true";
-            } else {
-                platinum_node.attribute("unlockstate").set_value("true");
-            }
-
-            auto trophyTimestamp = std::chrono::duration_cast<std::chrono::seconds>(
-                                       std::chrono::system_clock::now().time_since_epoch())
-                                       .count();
-
-            if (platinum_node.attribute("timestamp").empty()) {
-                platinum_node.append_attribute("timestamp") =
-                    std::to_string(trophyTimestamp).c_str();
-            } else {
-                platinum_node.attribute("timestamp")
-                    .set_value(std::to_string(trophyTimestamp).c_str());
-            }
-
-            int platinum_trophy_id =
-                platinum_node.attribute("id").as_int(ORBIS_NP_TROPHY_INVALID_TROPHY_ID);
-            const char* platinum_trophy_name = platinum_node.child("name").text().as_string();
-
-            std::string platinum_icon_file = "TROP";
-            platinum_icon_file.append(platinum_node.attribute("id").value());
-            platinum_icon_file.append(".PNG");
-
-            std::filesystem::path platinum_icon_path =
-                trophy_dir / "trophy00" / "Icons" / platinum_icon_file;
-
-            *platinumId = platinum_trophy_id;
-            AddTrophyToQueue(platinum_icon_path, platinum_trophy_name, "P");
-        }
+    const auto icons_dir = db->GetTrophyDir() / "trophy00" / "Icons";
+    if (result.trophy) {
+        AddTrophyToQueue(icons_dir / ("TROP" + result.trophy->id_text + ".PNG"),
+                         result.trophy->name, std::string_view(&result.trophy->type, 1));
+    }
+    if (result.platinum) {
+        *platinumId = result.platinum->id;
+        AddTrophyToQueue(icons_dir / ("TROP" + result.platinum->id_text + ".PNG"),
+                         result.platinum->name, "P");
     }
-
-    doc.save_file((trophy_dir / "trophy00" / "Xml" / "TROP.XML").native().c_str());
 
     return ORBIS_OK;
 }
@@ -60,6 +60,8 @@ constexpr int ORBIS_NP_TROPHY_GRADE_GOLD = 2;
 constexpr int ORBIS_NP_TROPHY_GRADE_SILVER = 3;
 constexpr int ORBIS_NP_TROPHY_GRADE_BRONZE = 4;
 
+OrbisNpTrophyGrade GetTrophyGradeFromChar(char trophyType);
+
 using OrbisNpTrophyGroupId = s32;
 constexpr int ORBIS_NP_TROPHY_BASE_GAME_GROUP_ID = -1;
 constexpr int ORBIS_NP_TROPHY_INVALID_GROUP_ID = -2;
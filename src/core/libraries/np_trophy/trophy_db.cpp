@@ -0,0 +1,262 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <chrono>
+
+#include "common/logging/log.h"
+#include "core/libraries/error_codes.h"
+#include "core/libraries/np_trophy/np_trophy_error.h"
+#include "core/libraries/np_trophy/trophy_db.h"
+
+namespace Libraries::NpTrophy {
+
+// Unlocks that happen close together, like a trophy and its platinum, share a single write.
+constexpr auto FlushDelay = std::chrono::seconds(1);
+
+static void SetAttribute(pugi::xml_node node, const char* name, const char* value) {
+    auto attribute = node.attribute(name);
+    if (attribute.empty()) {
+        node.append_attribute(name) = value;
+    } else {
+        attribute.set_value(value);
+    }
+}
+
+static void AddToCounts(TrophyCounts& counts, const TrophyEntry& trophy) {
+    counts.num_trophies++;
+    counts.num_by_grade[trophy.grade]++;
+    if (trophy.unlocked) {
+        counts.unlocked_trophies++;
+        counts.unlocked_by_grade[trophy.grade]++;
+    }
+}
+
+TrophyDb::TrophyDb(std::filesystem::path trophy_dir_)
+    : trophy_dir{std::move(trophy_dir_)}, xml_path{trophy_dir / "trophy00" / "Xml" / "TROP.XML"} {
+    index_by_id.fill(-1);
+    Load();
+    if (loaded) {
+        writer = std::jthread([this](std::stop_token stop) { Run(stop); });
+    }
+}
+
+TrophyDb::~TrophyDb() {
+    if (writer.joinable()) {
+        writer.request_stop();
+        writer.join();
+    }
+    Flush();
+}
+
+void TrophyDb::Load() {
+    const pugi::xml_parse_result result = doc.load_file(xml_path.native().c_str());
+    if (!result) {
+        LOG_ERROR(Lib_NpTrophy, "Failed to parse trophy xml : {}", result.description());
+        return;
+    }
+
+    const auto trophyconf = doc.child("trophyconf");
+    for (const pugi::xml_node& node : trophyconf.children()) {
+        const std::string_view node_name = node.name();
+
+        if (node_name == "title-name") {
+            title = node.text().as_string();
+        } else if (node_name == "title-detail") {
+            description = node.text().as_string();
+        } else if (node_name == "group") {
+            num_groups++;
+            const int group_id = node.attribute("id").as_int(ORBIS_NP_TROPHY_INVALID_GROUP_ID);
+            if (group_id != ORBIS_NP_TROPHY_INVALID_GROUP_ID) {
+                auto& group = groups[group_id];
+                group.has_text = true;
+                group.name = node.child("name").text().as_string();
+                group.description = node.child("detail").text().as_string();
+            }
+        } else if (node_name == "trophy") {
+            const std::string_view type = node.attribute("ttype").value();
+            TrophyEntry trophy{
+                .id = node.attribute("id").as_int(ORBIS_NP_TROPHY_INVALID_TROPHY_ID),
+                .group_id = node.attribute("gid").as_int(-1),
+                .grade = type.empty() ? ORBIS_NP_TROPHY_GRADE_UNKNOWN
+                                      : GetTrophyGradeFromChar(type.front()),
+                .type = type.empty() ? '\0' : type.front(),
+                .counts_to_platinum =
+                    node.attribute("pid").as_int(-1) != ORBIS_NP_TROPHY_INVALID_TROPHY_ID,
+                .hidden = node.attribute("hidden").as_bool(),
+                .unlocked = node.attribute("unlockstate").as_bool(),
+                .timestamp = node.attribute("timestamp").as_ullong(),
+                .id_text = node.attribute("id").value(),
+                .name = node.child("name").text().as_string(),
+                .description = node.child("detail").text().as_string(),
+            };
+
+            const s32 index = static_cast<s32>(trophies.size());
+            if (trophy.id >= 0 && trophy.id < ORBIS_NP_TROPHY_NUM_MAX) {
+                index_by_id[trophy.id] = index;
+            }
+            if (trophy.type == 'P') {
+                platinum_index = index;
+            }
+            if (trophy.type != '\0') {
+                AddToCounts(counts, trophy);
+                AddToCounts(groups[trophy.group_id].counts, trophy);
+            }
+            trophies.push_back(std::move(trophy));
+            trophy_nodes.push_back(node);
+        }
+    }
+    loaded = true;
+}
+
+std::string TrophyDb::GetTitle() const {
+    std::scoped_lock lock{mutex};
+    return title;
+}
+
+std::string TrophyDb::GetDescription() const {
+    std::scoped_lock lock{mutex};
+    return description;
+}
+
+u32 TrophyDb::GetNumGroups() const {
+    std::scoped_lock lock{mutex};
+    return num_groups;
+}
+
+TrophyCounts TrophyDb::GetCounts() const {
+    std::scoped_lock lock{mutex};
+    return counts;
+}
+
+TrophyCounts TrophyDb::GetGroupCounts(OrbisNpTrophyGroupId group_id) const {
+    std::scoped_lock lock{mutex};
+    const auto it = groups.find(group_id);
+    return it != groups.end() ? it->second.counts : TrophyCounts{};
+}
+
+bool TrophyDb::GetGroupText(OrbisNpTrophyGroupId group_id, std::string& name,
+                            std::string& group_description) const {
+    std::scoped_lock lock{mutex};
+    const auto it = groups.find(group_id);
+    if (it == groups.end() || !it->second.has_text) {
+        return false;
+    }
+    name = it->second.name;
+    group_description = it->second.description;
+    return true;
+}
+
+std::optional<TrophyEntry> TrophyDb::GetTrophy(OrbisNpTrophyId trophy_id) const {
+    std::scoped_lock lock{mutex};
+    if (trophy_id < 0 || trophy_id >= ORBIS_NP_TROPHY_NUM_MAX || index_by_id[trophy_id] < 0) {
+        return std::nullopt;
+    }
+    return trophies[index_by_id[trophy_id]];
+}
+
+u32 TrophyDb::GetUnlockState(OrbisNpTrophyFlagArray* flags) const {
+    std::scoped_lock lock{mutex};
+    for (const auto& trophy : trophies) {
+        if (trophy.unlocked && trophy.id >= 0 && trophy.id < ORBIS_NP_TROPHY_NUM_MAX) {
+            ORBIS_NP_TROPHY_FLAG_SET(trophy.id, flags);
+        }
+    }
+    return static_cast<u32>(trophies.size());
+}
+
+void TrophyDb::SetUnlocked(TrophyEntry& trophy, u64 timestamp) {
+    trophy.unlocked = true;
+    trophy.timestamp = timestamp;
+    if (trophy.type != '\0') {
+        for (TrophyCounts* target : {&counts, &groups[trophy.group_id].counts}) {
+            target->unlocked_trophies++;
+            target->unlocked_by_grade[trophy.grade]++;
+        }
+    }
+
+    const auto node = trophy_nodes[&trophy - trophies.data()];
+    SetAttribute(node, "unlockstate", "true");
+    SetAttribute(node, "timestamp", std::to_string(timestamp).c_str());
+    dirty = true;
+}
+
+TrophyUnlockResult TrophyDb::Unlock(OrbisNpTrophyId trophy_id) {
+    std::unique_lock lock{mutex};
+    TrophyUnlockResult result{ORBIS_OK};
+    if (trophy_id < 0 || trophy_id >= ORBIS_NP_TROPHY_NUM_MAX || index_by_id[trophy_id] < 0) {
+        return result;
+    }
+
+    auto& trophy = trophies[index_by_id[trophy_id]];
+    if (trophy.type == 'P') {
+        result.error = ORBIS_NP_TROPHY_ERROR_PLATINUM_CANNOT_UNLOCK;
+        return result;
+    }
+    if (trophy.unlocked) {
+        LOG_INFO(Lib_NpTrophy, "Trophy already unlocked");
+        result.error = ORBIS_NP_TROPHY_ERROR_TROPHY_ALREADY_UNLOCKED;
+        return result;
+    }
+
+    const u64 timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+                              std::chrono::system_clock::now().time_since_epoch())
+                              .count();
+    SetUnlocked(trophy, timestamp);
+    result.trophy = trophy;
+
+    if (platinum_index >= 0 && !trophies[platinum_index].unlocked) {
+        const bool all_unlocked = std::ranges::all_of(trophies, [](const TrophyEntry& entry) {
+            return !entry.counts_to_platinum || entry.unlocked;
+        });
+        if (all_unlocked) {
+            SetUnlocked(trophies[platinum_index], timestamp);
+            result.platinum = trophies[platinum_index];
+        }
+    }
+
+    lock.unlock();
+    cv.notify_one();
+    return result;
+}
+
+bool TrophyDb::Flush() {
+    std::scoped_lock lock{mutex};
+    return FlushLocked();
+}
+
+bool TrophyDb::FlushLocked() {
+    if (!dirty) {
+        return true;
+    }
+
+    // Save next to the original and swap it in, so a crash mid-write keeps the old file intact.
+    auto temp_path = xml_path;
+    temp_path += ".tmp";
+    if (!doc.save_file(temp_path.native().c_str())) {
+        LOG_ERROR(Lib_NpTrophy, "Failed to write trophy xml");
+        return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_path, xml_path, ec);
+    if (ec) {
+        LOG_ERROR(Lib_NpTrophy, "Failed to replace trophy xml: {}", ec.message());
+        return false;
+    }
+    dirty = false;
+    return true;
+}
+
+void TrophyDb::Run(std::stop_token stop) {
+    std::unique_lock lock{mutex};
+    while (cv.wait(lock, stop, [this] { return dirty; })) {
+        // Gather further unlocks before writing, the destructor flushes whatever is left.
+        if (cv.wait_for(lock, stop, FlushDelay, [] { return false; }) ||
+            stop.stop_requested()) {
+            return;
+        }
+        FlushLocked();
+    }
+}
+
+} // namespace Libraries::NpTrophy
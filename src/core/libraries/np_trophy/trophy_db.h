@@ -0,0 +1,125 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <pugixml.hpp>
+
+#include "common/types.h"
+#include "core/libraries/np_trophy/np_trophy.h"
+
+namespace Libraries::NpTrophy {
+
+struct TrophyEntry {
+    OrbisNpTrophyId id;
+    OrbisNpTrophyGroupId group_id;
+    OrbisNpTrophyGrade grade;
+    char type;         // Raw ttype attribute, 'B', 'S', 'G' or 'P'.
+    bool counts_to_platinum;
+    bool hidden;
+    bool unlocked;
+    u64 timestamp;
+    std::string id_text; // Id as spelled in TROP.XML, used for the icon file name.
+    std::string name;
+    std::string description;
+};
+
+/// Trophy and unlock counts of the whole game or of one group, indexed by grade.
+struct TrophyCounts {
+    u32 num_trophies;
+    u32 unlocked_trophies;
+    std::array<u32, 5> num_by_grade;
+    std::array<u32, 5> unlocked_by_grade;
+};
+
+struct TrophyUnlockResult {
+    s32 error;
+    std::optional<TrophyEntry> trophy;
+    std::optional<TrophyEntry> platinum;
+};
+
+/**
+ * Trophy state of a game parsed once from TROP.XML. Queries are answered from memory and
+ * unlocks update the document in place; they are written back in batches by a background
+ * thread, through a temporary file so an interrupted write never corrupts the XML.
+ */
+class TrophyDb {
+public:
+    explicit TrophyDb(std::filesystem::path trophy_dir);
+    ~TrophyDb();
+
+    TrophyDb(const TrophyDb&) = delete;
+    TrophyDb& operator=(const TrophyDb&) = delete;
+
+    bool IsLoaded() const {
+        return loaded;
+    }
+
+    const std::filesystem::path& GetTrophyDir() const {
+        return trophy_dir;
+    }
+
+    std::string GetTitle() const;
+    std::string GetDescription() const;
+    u32 GetNumGroups() const;
+    TrophyCounts GetCounts() const;
+    TrophyCounts GetGroupCounts(OrbisNpTrophyGroupId group_id) const;
+
+    /// Returns false when TROP.XML has no group with this id.
+    bool GetGroupText(OrbisNpTrophyGroupId group_id, std::string& name,
+                      std::string& group_description) const;
+    std::optional<TrophyEntry> GetTrophy(OrbisNpTrophyId trophy_id) const;
+
+    /// Fills flags with the unlocked trophies and returns the number of trophies.
+    u32 GetUnlockState(OrbisNpTrophyFlagArray* flags) const;
+
+    /// Unlocks a trophy, and the platinum trophy once every trophy linked to it is unlocked.
+    TrophyUnlockResult Unlock(OrbisNpTrophyId trophy_id);
+
+    /// Writes pending unlocks to disk now.
+    bool Flush();
+
+private:
+    struct Group {
+        bool has_text = false;
+        std::string name;
+        std::string description;
+        TrophyCounts counts{};
+    };
+
+    void Load();
+    void SetUnlocked(TrophyEntry& trophy, u64 timestamp);
+    bool FlushLocked();
+    void Run(std::stop_token stop);
+
+    std::filesystem::path trophy_dir;
+    std::filesystem::path xml_path;
+    bool loaded = false;
+
+    mutable std::mutex mutex;
+    pugi::xml_document doc;
+    std::string title;
+    std::string description;
+    std::vector<TrophyEntry> trophies;
+    std::vector<pugi::xml_node> trophy_nodes;
+    std::array<s32, ORBIS_NP_TROPHY_NUM_MAX> index_by_id;
+    std::unordered_map<OrbisNpTrophyGroupId, Group> groups;
+    TrophyCounts counts{};
+    u32 num_groups = 0;
+    s32 platinum_index = -1;
+
+    bool dirty = false;
+    std::condition_variable_any cv;
+    std::jthread writer; // Declared last so it is joined before the state above is destroyed.
+};
+
+} // namespace Libraries::NpTrophy
@@ -1,17 +1,24 @@
 // SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <deque>
 #include <mutex>
 #include <semaphore>
+#include <thread>
+#include <vector>
 
 #include <magic_enum/magic_enum.hpp>
 
 #include "save_backup.h"
 #include "save_instance.h"
 
+#include "common/io_file.h"
 #include "common/logging/log.h"
 #include "common/logging/log_entry.h"
+#include "common/parallel_for.h"
 #include "common/polyfill_thread.h"
 #include "common/thread.h"
 
@@ -36,6 +43,52 @@ static std::deque<BackupRequest> g_result_queue;
 static std::atomic_int g_backup_progress = 0;
 static std::atomic g_backup_status = WorkerStatus::NotStarted;
 
+// Files written this close to the start of a backup may still change within the same timestamp
+// tick, so their metadata is not trusted and the contents are compared instead.
+constexpr auto racy_window = std::chrono::seconds(2);
+
+// Changed files are copied in parallel once there is enough data to make it worthwhile.
+constexpr u64 parallel_copy_threshold = 4_MB;
+constexpr u32 max_copy_threads = 4;
+
+struct BackupEntry {
+    fs::path relative;
+    u64 size;
+    fs::file_time_type mtime;
+};
+
+static bool SameContents(const fs::path& a, const fs::path& b) {
+    Common::FS::IOFile file_a(a, Common::FS::FileAccessMode::Read);
+    Common::FS::IOFile file_b(b, Common::FS::FileAccessMode::Read);
+    if (!file_a.IsOpen() || !file_b.IsOpen()) {
+        return false;
+    }
+    std::vector<u8> buf_a(64_KB);
+    std::vector<u8> buf_b(64_KB);
+    while (true) {
+        const size_t read_a = file_a.ReadRaw<u8>(buf_a.data(), buf_a.size());
+        const size_t read_b = file_b.ReadRaw<u8>(buf_b.data(), buf_b.size());
+        if (read_a != read_b || std::memcmp(buf_a.data(), buf_b.data(), read_a) != 0) {
+            return false;
+        }
+        if (read_a < buf_a.size()) {
+            return true;
+        }
+    }
+}
+
+// The previous backup serves as the manifest: its files keep the size and modification time of
+// the save file they were taken from.
+static bool IsUnchanged(const fs::path& source, const BackupEntry& entry, const fs::path& previous,
+                        fs::file_time_type start) {
+    std::error_code ec;
+    if (fs::file_size(previous, ec) != entry.size || ec ||
+        fs::last_write_time(previous, ec) != entry.mtime || ec) {
+        return false;
+    }
+    return start - entry.mtime > racy_window || SameContents(source, previous);
+}
+
 static void backup(const std::filesystem::path& dir_name) {
     std::unique_lock lk{g_backup_running_mutex};
     if (!fs::exists(dir_name)) {
@@ -49,24 +102,74 @@ static void backup(const std::filesystem::path& dir_name) {
     fs::remove_all(backup_dir_tmp);
     fs::remove_all(backup_dir_old);
 
-    std::vector<std::filesystem::path> backup_files;
-    for (const auto& entry : fs::directory_iterator(dir_name)) {
-        const auto filename = entry.path().filename();
-        if (filename != ::backup_dir) {
-            backup_files.push_back(entry.path());
+    g_backup_progress = 0;
+    const auto start = fs::file_time_type::clock::now();
+
+    // Mirror the directory layout and collect the files.
+    fs::create_directory(backup_dir_tmp);
+    std::vector<BackupEntry> files;
+    for (auto it = fs::recursive_directory_iterator(dir_name); it != fs::end(it); ++it) {
+        const auto relative = it->path().lexically_relative(dir_name);
+        if (it.depth() == 0 && (relative == ::backup_dir || relative == ::backup_dir_tmp ||
+                                relative == ::backup_dir_old)) {
+            it.disable_recursion_pending();
+            continue;
+        }
+        if (it->is_directory()) {
+            fs::create_directory(backup_dir_tmp / relative);
+        } else if (it->is_regular_file()) {
+            files.push_back({relative, it->file_size(), it->last_write_time()});
         }
     }
 
-    g_backup_progress = 0;
+    // Unchanged files are hard linked from the previous backup. Backup files are never modified
+    // in place, so sharing them between backups is safe.
+    std::vector<const BackupEntry*> changed;
+    u64 changed_bytes = 0;
+    for (const auto& entry : files) {
+        const auto previous = backup_dir / entry.relative;
+        if (IsUnchanged(dir_name / entry.relative, entry, previous, start)) {
+            std::error_code ec;
+            fs::create_hard_link(previous, backup_dir_tmp / entry.relative, ec);
+            if (!ec) {
+                continue;
+            }
+        }
+        changed.push_back(&entry);
+        changed_bytes += entry.size;
+    }
 
-    int total_count = static_cast<int>(backup_files.size());
-    int current_count = 0;
+    const int total_count = static_cast<int>(changed.size());
+    std::atomic_int current_count = 0;
+    std::atomic_bool failed = false;
+    const u32 num_threads =
+        changed_bytes < parallel_copy_threshold
+            ? 1
+            : std::min(max_copy_threads, Common::ParallelThreadCount(changed.size(), 0));
+    Common::ParallelFor(changed.size(), num_threads, [&](size_t i) {
+        const auto& entry = *changed[i];
+        const auto target = backup_dir_tmp / entry.relative;
+        std::error_code ec;
+        fs::copy_file(dir_name / entry.relative, target, ec);
+        if (!ec) {
+            // Keep the source timestamp so the next backup can recognize the file.
+            fs::last_write_time(target, entry.mtime, ec);
+        }
+        if (ec) {
+            LOG_ERROR(Lib_SaveData, "Failed to backup {}: {}",
+                      fmt::UTF(entry.relative.u8string()), ec.message());
+            failed = true;
+        }
+        g_backup_progress = ++current_count * 100 / total_count;
+    });
+    g_backup_progress = 100;
+    LOG_DEBUG(Lib_SaveData, "Backup of {}: {} of {} files changed", fmt::UTF(dir_name.u8string()),
+              changed.size(), files.size());
 
-    fs::create_directory(backup_dir_tmp);
-    for (const auto& file : backup_files) {
-        fs::copy(file, backup_dir_tmp / file.filename(), fs::copy_options::recursive);
-        current_count++;
-        g_backup_progress = current_count * 100 / total_count;
+    if (failed) {
+        // Keep the previous backup rather than replacing it with an incomplete one.
+        fs::remove_all(backup_dir_tmp);
+        return;
     }
     bool has_existing_backup = fs::exists(backup_dir);
     if (has_existing_backup) {
@@ -1,11 +1,16 @@
 // SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <mutex>
 #include <stop_token>
+#include <thread>
 #include <unordered_map>
-#include <queue>
+#include <fmt/format.h>
 #include <zlib.h>
 
 #include "common/logging/log.h"
@@ -30,70 +35,107 @@ struct InflateResult {
     s32 status;
 };
 
-static Kernel::Thread task_thread;
+// Requests are spread over a few workers, leaving the remaining cores to the game.
+static constexpr u32 MaxWorkers = 4;
+static std::array<Kernel::Thread, MaxWorkers> workers;
+static u32 num_workers;
 
-static std::mutex mutex;
-static std::queue<InflateTask> task_queue;
+// Pending requests, served in submission order.
+static std::mutex task_mutex;
+static std::deque<InflateTask> task_queue;
 static std::condition_variable_any task_queue_cv;
-static std::queue<u64> done_queue;
+
+// Finished requests. Kept under their own lock so completions do not contend with submissions.
+static std::mutex done_mutex;
+static std::deque<u64> done_queue;
 static std::condition_variable_any done_queue_cv;
 static std::unordered_map<u64, InflateResult> results;
-static u64 next_request_id;
 
-void ZlibTaskThread(const std::stop_token& stop) {
-    Common::SetCurrentThreadName("shadPS4:ZlibTaskThread");
+static std::atomic<u64> next_request_id;
+
+static bool IsInitialized() {
+    return workers[0].Joinable();
+}
+
+static InflateResult Inflate(z_stream& stream, const InflateTask& task) {
+    // Reuse the worker's inflate state instead of setting up a new one per request.
+    inflateReset(&stream);
+    stream.next_in = static_cast<Bytef*>(const_cast<void*>(task.src));
+    stream.avail_in = task.src_length;
+    stream.next_out = static_cast<Bytef*>(task.dst);
+    stream.avail_out = task.dst_length;
+    const auto ret = inflate(&stream, Z_FINISH);
+
+    // Same result mapping as uncompress().
+    s32 status = ORBIS_ZLIB_ERROR_FATAL;
+    if (ret == Z_STREAM_END) {
+        status = ORBIS_OK;
+    } else if ((ret == Z_BUF_ERROR || ret == Z_OK) && stream.avail_out == 0) {
+        status = ORBIS_ZLIB_ERROR_NOSPACE;
+    }
+    return InflateResult{
+        .length = task.dst_length - stream.avail_out,
+        .status = status,
+    };
+}
+
+void ZlibTaskThread(const std::stop_token& stop, u32 index) {
+    Common::SetCurrentThreadName(fmt::format("shadPS4:ZlibTaskThread{}", index).c_str());
+
+    z_stream stream{};
+    if (inflateInit(&stream) != Z_OK) {
+        LOG_ERROR(Lib_Zlib, "Failed to initialize inflate state");
+        return;
+    }
 
     while (!stop.stop_requested()) {
         InflateTask task;
         {
             // Lock and pop from the task queue, unless stop has been requested.
-            std::unique_lock lock(mutex);
+            std::unique_lock lock(task_mutex);
             if (!task_queue_cv.wait(lock, stop, [&] { return !task_queue.empty(); })) {
                 break;
             }
-            task = task_queue.back();
-            task_queue.pop();
+            task = task_queue.front();
+            task_queue.pop_front();
         }
 
-        uLongf decompressed_length = task.dst_length;
-        const auto ret = uncompress(static_cast<Bytef*>(task.dst), &decompressed_length,
-                                    static_cast<const Bytef*>(task.src), task.src_length);
+        const auto result = Inflate(stream, task);
 
         {
             // Lock, insert the new result, and push the finished request ID to the done queue.
-            std::unique_lock lock(mutex);
-            results[task.request_id] = InflateResult{
-                .length = static_cast<u32>(decompressed_length),
-                .status = ret == Z_BUF_ERROR ? ORBIS_ZLIB_ERROR_NOSPACE
-                          : ret == Z_OK      ? ORBIS_OK
-                                             : ORBIS_ZLIB_ERROR_FATAL,
-            };
-            done_queue.push(task.request_id);
+            std::unique_lock lock(done_mutex);
+            results[task.request_id] = result;
+            done_queue.push_back(task.request_id);
         }
         done_queue_cv.notify_one();
     }
+    inflateEnd(&stream);
 }
 
 s32 PS4_SYSV_ABI sceZlibInitialize(const void* buffer, u32 length) {
     LOG_INFO(Lib_Zlib, "called");
-    if (task_thread.Joinable()) {
+    if (IsInitialized()) {
         return ORBIS_ZLIB_ERROR_ALREADY_INITIALIZED;
     }
 
     // Initialize with empty task data
-    task_queue = std::queue<InflateTask>();
-    done_queue = std::queue<u64>();
+    task_queue.clear();
+    done_queue.clear();
     results.clear();
     next_request_id = 1;
 
-    task_thread.Run([](const std::stop_token& stop) { ZlibTaskThread(stop); });
+    num_workers = std::clamp(std::thread::hardware_concurrency() / 2, 1U, MaxWorkers);
+    for (u32 i = 0; i < num_workers; i++) {
+        workers[i].Run([i](const std::stop_token& stop) { ZlibTaskThread(stop, i); });
+    }
     return ORBIS_OK;
 }
 
 s32 PS4_SYSV_ABI sceZlibInflate(const void* src, u32 src_len, void* dst, u32 dst_len,
                                 u64* request_id) {
     LOG_DEBUG(Lib_Zlib, "(STUBBED) called");
-    if (!task_thread.Joinable()) {
+    if (!IsInitialized()) {
         return ORBIS_ZLIB_ERROR_NOT_INITIALIZED;
     }
     if (!src || !src_len || !dst || !dst_len || !request_id || dst_len > 64_KB ||
@@ -101,24 +143,24 @@ s32 PS4_SYSV_ABI sceZlibInflate(const void* src, u32 src_len, void* dst, u32 dst
         return ORBIS_ZLIB_ERROR_INVALID;
     }
 
+    *request_id = next_request_id++;
     {
-        std::unique_lock lock(mutex);
-        *request_id = next_request_id++;
-        task_queue.emplace(InflateTask{
+        std::unique_lock lock(task_mutex);
+        task_queue.push_back(InflateTask{
             .request_id = *request_id,
             .src = src,
             .src_length = src_len,
             .dst = dst,
             .dst_length = dst_len,
         });
-        task_queue_cv.notify_one();
     }
+    task_queue_cv.notify_one();
     return ORBIS_OK;
 }
 
 s32 PS4_SYSV_ABI sceZlibWaitForDone(u64* request_id, const u32* timeout) {
     LOG_DEBUG(Lib_Zlib, "(STUBBED) called");
-    if (!task_thread.Joinable()) {
+    if (!IsInitialized()) {
         return ORBIS_ZLIB_ERROR_NOT_INITIALIZED;
     }
     if (!request_id) {
@@ -127,7 +169,7 @@ s32 PS4_SYSV_ABI sceZlibWaitForDone(u64* request_id, const u32* timeout) {
 
     {
         // Pop from the done queue, unless the timeout is reached.
-        std::unique_lock lock(mutex);
+        std::unique_lock lock(done_mutex);
         const auto pred = [] { return !done_queue.empty(); };
         if (timeout) {
             if (!done_queue_cv.wait_for(lock, std::chrono::milliseconds(*timeout), pred)) {
@@ -136,15 +178,15 @@ s32 PS4_SYSV_ABI sceZlibWaitForDone(u64* request_id, const u32* timeout) {
         } else {
             done_queue_cv.wait(lock, pred);
         }
-        *request_id = done_queue.back();
-        done_queue.pop();
+        *request_id = done_queue.front();
+        done_queue.pop_front();
     }
     return ORBIS_OK;
 }
 
 s32 PS4_SYSV_ABI sceZlibGetResult(const u64 request_id, u32* dst_length, s32* status) {
     LOG_DEBUG(Lib_Zlib, "(STUBBED) called");
-    if (!task_thread.Joinable()) {
+    if (!IsInitialized()) {
         return ORBIS_ZLIB_ERROR_NOT_INITIALIZED;
     }
     if (!dst_length || !status) {
@@ -152,7 +194,7 @@ s32 PS4_SYSV_ABI sceZlibGetResult(const u64 request_id, u32* dst_length, s32* st
     }
 
     {
-        std::unique_lock lock(mutex);
+        std::unique_lock lock(done_mutex);
         if (!results.contains(request_id)) {
             return ORBIS_ZLIB_ERROR_NOT_FOUND;
         }
@@ -165,10 +207,12 @@ s32 PS4_SYSV_ABI sceZlibGetResult(const u64 request_id, u32* dst_length, s32* st
 
 s32 PS4_SYSV_ABI sceZlibFinalize() {
     LOG_INFO(Lib_Zlib, "called");
-    if (!task_thread.Joinable()) {
+    if (!IsInitialized()) {
         return ORBIS_ZLIB_ERROR_NOT_INITIALIZED;
     }
-    task_thread.Stop();
+    for (u32 i = 0; i < num_workers; i++) {
+        workers[i].Stop();
+    }
     return ORBIS_OK;
 }
 
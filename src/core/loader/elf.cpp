@@ -180,35 +180,48 @@ Elf::~Elf() = default;
 
 void Elf::Open(const std::filesystem::path& file_name) {
     m_f.Open(file_name, FileAccessMode::Read);
-    if (!m_f.ReadObject(m_self)) {
+    OpenHeaders([this](u64 offset, std::span<u8> out) {
+        return m_f.Seek(offset, SeekOrigin::SetOrigin) &&
+               m_f.ReadRaw<u8>(out.data(), out.size()) == out.size();
+    });
+}
+
+bool Elf::OpenHeaders(const Reader& read) {
+    const auto read_object = [&read](u64 offset, auto& object) {
+        return read(offset, {reinterpret_cast<u8*>(&object), sizeof(object)});
+    };
+    const auto read_vector = [&read]<typename T>(u64 offset, std::vector<T>& out) {
+        return read(offset, {reinterpret_cast<u8*>(out.data()), out.size() * sizeof(T)});
+    };
+
+    if (!read_object(0, m_self)) {
         LOG_ERROR(Loader, "Unable to read self header!");
-        return;
+        return false;
     }
 
-    if (is_self = IsSelfFile(); !is_self) {
-        m_f.Seek(0, SeekOrigin::SetOrigin);
-    } else {
+    u64 elf_header_pos = 0;
+    if (is_self = IsSelfFile(); is_self) {
         m_self_segments.resize(m_self.segment_count);
-        m_f.Read(m_self_segments);
+        if (!read_vector(sizeof(self_header), m_self_segments)) {
+            LOG_ERROR(Loader, "Unable to read self segment headers!");
+            return false;
+        }
+        elf_header_pos = sizeof(self_header) + m_self_segments.size() * sizeof(self_segment_header);
     }
 
-    const u64 elf_header_pos = m_f.Tell();
-    m_f.Read(m_elf_header);
-    if (!IsElfFile()) {
-        return;
+    if (!read_object(elf_header_pos, m_elf_header) || !IsElfFile()) {
+        return false;
     }
 
-    const auto load_headers = [this]<typename T>(std::vector<T>& out, u64 offset, u16 num) {
+    const auto load_headers = [&]<typename T>(std::vector<T>& out, u64 offset, u16 num) {
         if (!num) {
             return;
         }
 
         out.resize(num);
-        if (!m_f.Seek(offset, SeekOrigin::SetOrigin)) {
+        if (!read_vector(offset, out)) {
             LOG_CRITICAL(Loader, "Failed to seek to header tables");
-            return;
         }
-        m_f.Read(out);
     };
 
     load_headers(m_elf_phdr, elf_header_pos + m_elf_header.e_phoff, m_elf_header.e_phnum);
@@ -225,10 +238,10 @@ void Elf::Open(const std::filesystem::path& file_name) {
         header_size &= ~15; // Align
 
         if (m_elf_header.e_ehsize - header_size >= sizeof(elf_program_id_header)) {
-            m_f.Seek(header_size, SeekOrigin::SetOrigin);
-            m_f.ReadObject(m_self_id_header);
+            read_object(header_size, m_self_id_header);
         }
     }
+    return true;
 }
 
 bool Elf::IsSelfFile() const {
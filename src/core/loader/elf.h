@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <functional>
 #include <span>
 #include <string>
 #include <vector>
@@ -465,7 +466,13 @@ public:
     Elf() = default;
     ~Elf();
 
+    /// Reads size bytes at offset into out, used to parse headers from sources other than a file.
+    using Reader = std::function<bool(u64 offset, std::span<u8> out)>;
+
     void Open(const std::filesystem::path& file_name);
+
+    /// Parses the SELF and ELF headers only, segments can not be loaded afterwards.
+    bool OpenHeaders(const Reader& read);
     bool IsSelfFile() const;
     bool IsElfFile() const;
 
@@ -485,6 +492,10 @@ public:
         return m_self_segments;
     }
 
+    [[nodiscard]] elf_program_id_header GetProgramIdHeader() const {
+        return m_self_id_header;
+    }
+
     [[nodiscard]] u64 GetElfEntry() const {
         return m_elf_header.e_entry;
     }
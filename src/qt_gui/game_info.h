@@ -7,6 +7,7 @@
 #include <QtConcurrent>
 
 #include "common/config.h"
+#include "core/file_format/game_library.h"
 #include "core/file_format/psf.h"
 #include "game_list_utils.h"
 
@@ -26,60 +27,44 @@ public:
         return name_a < name_b;
     }
 
-    static GameInfo readGameInfo(const std::filesystem::path& filePath) {
+    static GameInfo readGameInfo(const GameLibraryEntry& entry) {
         GameInfo game;
-        game.path = filePath;
-        std::filesystem::path sce_folder_path = filePath / "sce_sys" / "param.sfo";
-        std::filesystem::path game_update_path = filePath;
-        game_update_path += "-UPDATE";
-        if (std::filesystem::exists(game_update_path / "sce_sys" / "param.sfo")) {
-            sce_folder_path = game_update_path / "sce_sys" / "param.sfo";
-        } else {
-            game_update_path = filePath;
-            game_update_path += "-patch";
-            if (std::filesystem::exists(game_update_path / "sce_sys" / "param.sfo")) {
-                sce_folder_path = game_update_path / "sce_sys" / "param.sfo";
-            }
-        }
+        game.path = Common::FS::PathFromQString(QString::fromStdString(entry.path));
+        game.icon_path = Common::FS::PathFromQString(QString::fromStdString(entry.icon_path));
+        QString iconpath;
+        Common::FS::PathToQString(iconpath, game.icon_path);
+        game.icon = QImage(iconpath);
+        game.pic_path = Common::FS::PathFromQString(QString::fromStdString(entry.pic_path));
+        game.snd0_path = Common::FS::PathFromQString(QString::fromStdString(entry.snd0_path));
+        game.size = GameListUtils::FormatSize(static_cast<qint64>(entry.size)).toStdString();
 
-        PSF psf;
-        if (psf.Open(sce_folder_path)) {
-            game.icon_path = game.path / "sce_sys" / "icon0.png";
-            QString iconpath;
-            Common::FS::PathToQString(iconpath, game.icon_path);
-            game.icon = QImage(iconpath);
-            game.pic_path = game.path / "sce_sys" / "pic1.png";
-            game.snd0_path = game.path / "sce_sys" / "snd0.at9";
-
-            if (const auto title = psf.GetString("TITLE"); title.has_value()) {
-                game.name = *title;
-            }
-            if (const auto title_id = psf.GetString("TITLE_ID"); title_id.has_value()) {
-                game.serial = *title_id;
-            }
-            if (const auto content_id = psf.GetString("CONTENT_ID");
-                content_id.has_value() && !content_id->empty()) {
-                game.region = GameListUtils::GetRegion(content_id->at(0)).toStdString();
-            }
-            if (const auto fw_int_opt = psf.GetInteger("SYSTEM_VER"); fw_int_opt.has_value()) {
-                auto fw_int = *fw_int_opt;
-                if (fw_int == 0) {
-                    game.fw = "0.00";
-                } else {
-                    QString fw = QString::number(fw_int, 16);
-                    QString fw_ = fw.length() > 7
-                                      ? QString::number(fw_int, 16).left(3).insert(2, '.')
-                                      : fw.left(3).insert(1, '.');
-                    game.fw = fw_.toStdString();
-                }
-            }
-            if (auto app_ver = psf.GetString("APP_VER"); app_ver.has_value()) {
-                game.version = *app_ver;
-            }
-            if (const auto play_time = psf.GetString("PLAY_TIME"); play_time.has_value()) {
-                game.play_time = *play_time;
+        if (!entry.title.empty()) {
+            game.name = entry.title;
+        }
+        if (!entry.title_id.empty()) {
+            game.serial = entry.title_id;
+        }
+        if (!entry.content_id.empty()) {
+            game.region = GameListUtils::GetRegion(entry.content_id.at(0)).toStdString();
+        }
+        if (entry.has_system_ver) {
+            const auto fw_int = entry.system_ver;
+            if (fw_int == 0) {
+                game.fw = "0.00";
+            } else {
+                QString fw = QString::number(fw_int, 16);
+                QString fw_ = fw.length() > 7
+                                  ? QString::number(fw_int, 16).left(3).insert(2, '.')
+                                  : fw.left(3).insert(1, '.');
+                game.fw = fw_.toStdString();
             }
         }
+        if (!entry.app_ver.empty()) {
+            game.version = entry.app_ver;
+        }
+        if (!entry.play_time.empty()) {
+            game.play_time = entry.play_time;
+        }
         return game;
     }
 };
@@ -728,6 +728,7 @@ void MainWindow::CreateConnects() {
     });
 
     // Package install.
+    CreateInstallService();
     connect(ui->bootInstallPkgAct, &QAction::triggered, this, &MainWindow::InstallPkg);
     connect(ui->bootGameAct, &QAction::triggered, this, &MainWindow::BootGame);
     connect(ui->gameInstallPathAct, &QAction::triggered, this, &MainWindow::InstallDirectory);
@@ -991,6 +992,79 @@ void MainWindow::InstallPkg() {
     }
 }
 
+void MainWindow::CreateInstallService() {
+    m_install_service = new PkgInstallService(this);
+    m_install_dialog = new QProgressDialog(this);
+    m_install_dialog->setWindowTitle(tr("PKG Extraction"));
+    m_install_dialog->setAutoClose(false);
+    m_install_dialog->setAutoReset(false);
+    m_install_dialog->setRange(0, 1000);
+    m_install_dialog->reset();
+    m_install_dialog->hide();
+
+    connect(m_install_dialog, &QProgressDialog::canceled, m_install_service,
+            &PkgInstallService::CancelCurrent);
+
+    connect(m_install_service, &PkgInstallService::JobStarted, this,
+            [this](const PkgInstallJob& job) {
+                m_install_dialog->setLabelText(
+                    QString(tr("Extracting PKG %1/%2")).arg(job.pkg_num).arg(job.pkg_count));
+                m_install_dialog->setValue(0);
+                m_install_dialog->setGeometry(QStyle::alignedRect(
+                    Qt::LeftToRight, Qt::AlignCenter, m_install_dialog->size(),
+                    this->geometry()));
+                m_install_dialog->show();
+            });
+
+    // Progress is tracked in bytes so large files move the bar as much as they take time.
+    connect(m_install_service, &PkgInstallService::ProgressChanged, this,
+            [this](quint64 bytes_written, quint64 bytes_total) {
+                if (bytes_total != 0) {
+                    m_install_dialog->setValue(
+                        static_cast<int>(std::min<quint64>(bytes_written, bytes_total) * 1000 /
+                                         bytes_total));
+                }
+            });
+
+    connect(m_install_service, &PkgInstallService::JobFinished, this,
+            [this](const PkgInstallJob& job, bool success, const QString& error) {
+                m_install_dialog->reset();
+                m_install_dialog->hide();
+                if (!success) {
+                    if (!error.isEmpty()) {
+                        QMessageBox::critical(this, tr("PKG ERROR"), error);
+                    }
+                    return;
+                }
+                if (job.pkg_num != job.pkg_count) {
+                    return;
+                }
+
+                QString path;
+
+                // We want to show the parent path instead of the full path
+                Common::FS::PathToQString(path, job.game_folder_path.parent_path());
+                QIcon windowIcon(
+                    Common::FS::PathToUTF8String(job.game_folder_path / "sce_sys/icon0.png")
+                        .c_str());
+
+                QMessageBox extractMsgBox(this);
+                extractMsgBox.setWindowTitle(tr("Extraction Finished"));
+                if (!windowIcon.isNull()) {
+                    extractMsgBox.setWindowIcon(windowIcon);
+                }
+                extractMsgBox.setText(QString(tr("Game successfully installed at %1")).arg(path));
+                extractMsgBox.addButton(QMessageBox::Ok);
+                extractMsgBox.setDefaultButton(QMessageBox::Ok);
+                extractMsgBox.exec();
+                emit ExtractionFinished();
+            });
+
+    // Connected after the handler above, so the next PKG is checked once it has returned.
+    connect(m_install_service, &PkgInstallService::JobFinished, this,
+            [this] { InstallNextPkg(); });
+}
+
 void MainWindow::BootGame() {
     QFileDialog dialog;
     dialog.setFileMode(QFileDialog::ExistingFile);
@@ -1015,17 +1089,37 @@ void MainWindow::BootGame() {
 }
 
 void MainWindow::InstallDragDropPkg(std::filesystem::path file, int pkgNum, int nPkg) {
+    m_pending_installs.push_back({std::move(file), pkgNum, nPkg});
+    if (!m_install_running) {
+        InstallNextPkg();
+    }
+}
+
+void MainWindow::InstallNextPkg() {
+    // Prompts below run a nested event loop, PKGs dropped meanwhile only join the queue.
+    m_install_running = true;
+    while (!m_pending_installs.empty()) {
+        const PendingInstall next = std::move(m_pending_installs.front());
+        m_pending_installs.pop_front();
+        if (EnqueuePkgInstall(next.file, next.pkg_num, next.pkg_count)) {
+            return; // Continued from JobFinished.
+        }
+    }
+    m_install_running = false;
+}
+
+bool MainWindow::EnqueuePkgInstall(const std::filesystem::path& file, int pkgNum, int nPkg) {
     if (Loader::DetectFileType(file) == Loader::FileTypes::Pkg) {
         std::string failreason;
-        pkg = PKG();
+        PKG pkg;
         if (!pkg.Open(file, failreason)) {
             QMessageBox::critical(this, tr("PKG ERROR"), QString::fromStdString(failreason));
-            return;
+            return false;
         }
         if (!psf.Open(pkg.sfo)) {
             QMessageBox::critical(this, tr("PKG ERROR"),
                                   "Could not read SFO. Check log for details");
-            return;
+            return false;
         }
         auto category = psf.GetString("CATEGORY");
 
@@ -1033,7 +1127,7 @@ void MainWindow::InstallDragDropPkg(std::filesystem::path file, int pkgNum, int
             InstallDirSelect ids;
             const auto selected = ids.exec();
             if (selected == QDialog::Rejected) {
-                return;
+                return false;
             }
 
             last_install_dir = ids.getSelectedDirectory();
@@ -1090,7 +1184,7 @@ void MainWindow::InstallDragDropPkg(std::filesystem::path file, int pkgNum, int
                 content_id = std::string{*value};
             } else {
                 QMessageBox::critical(this, tr("PKG ERROR"), "PSF file there is no CONTENT_ID");
-                return;
+                return false;
             }
             std::string entitlement_label = Common::SplitString(content_id, '-')[2];
 
@@ -1106,7 +1200,7 @@ void MainWindow::InstallDragDropPkg(std::filesystem::path file, int pkgNum, int
                     pkg_app_version = QString::fromStdString(std::string{*app_ver});
                 } else {
                     QMessageBox::critical(this, tr("PKG ERROR"), "PSF file there is no APP_VER");
-                    return;
+                    return false;
                 }
                 std::filesystem::path sce_folder_path =
                     std::filesystem::exists(game_update_path / "sce_sys" / "param.sfo")
@@ -1118,7 +1212,7 @@ void MainWindow::InstallDragDropPkg(std::filesystem::path file, int pkgNum, int
                     game_app_version = QString::fromStdString(std::string{*app_ver});
                 } else {
                     QMessageBox::critical(this, tr("PKG ERROR"), "PSF file there is no APP_VER");
-                    return;
+                    return false;
                 }
                 double appD = game_app_version.toDouble();
                 double pkgD = pkg_app_version.toDouble();
@@ -1148,7 +1242,7 @@ void MainWindow::InstallDragDropPkg(std::filesystem::path file, int pkgNum, int
                 if (result == QMessageBox::Yes) {
                     // Do nothing.
                 } else {
-                    return;
+                    return false;
                 }
             } else if (category == "ac") {
                 if (!addon_dir.exists()) {
@@ -1163,7 +1257,7 @@ void MainWindow::InstallDragDropPkg(std::filesystem::path file, int pkgNum, int
                     if (result == QMessageBox::Yes) {
                         game_update_path = addon_extract_path;
                     } else {
-                        return;
+                        return false;
                     }
                 } else {
                     msgBox.setText(QString(tr("DLC already installed:") + "\n" + addonDirPath +
@@ -1174,7 +1268,7 @@ void MainWindow::InstallDragDropPkg(std::filesystem::path file, int pkgNum, int
                     if (result == QMessageBox::Yes) {
                         game_update_path = addon_extract_path;
                     } else {
-                        return;
+                        return false;
                     }
                 }
             } else {
@@ -1186,7 +1280,7 @@ void MainWindow::InstallDragDropPkg(std::filesystem::path file, int pkgNum, int
                 if (result == QMessageBox::Yes) {
                     // Do nothing.
                 } else {
-                    return;
+                    return false;
                 }
             }
         } else {
@@ -1195,77 +1289,17 @@ void MainWindow::InstallDragDropPkg(std::filesystem::path file, int pkgNum, int
                 QMessageBox::information(
                     this, tr("PKG Extraction"),
                     tr("PKG is a patch or DLC, please install the game first!"));
-                return;
+                return false;
             }
             // what else?
         }
-        if (!pkg.Extract(file, game_update_path, failreason)) {
-            QMessageBox::critical(this, tr("PKG ERROR"), QString::fromStdString(failreason));
-        } else {
-            int nfiles = pkg.GetNumberOfFiles();
-
-            if (nfiles > 0) {
-                QVector<int> indices;
-                for (int i = 0; i < nfiles; i++) {
-                    indices.append(i);
-                }
-
-                QProgressDialog dialog;
-                dialog.setWindowTitle(tr("PKG Extraction"));
-                dialog.setWindowModality(Qt::WindowModal);
-                QString extractmsg = QString(tr("Extracting PKG %1/%2")).arg(pkgNum).arg(nPkg);
-                dialog.setLabelText(extractmsg);
-                dialog.setAutoClose(true);
-                dialog.setRange(0, nfiles);
-
-                dialog.setGeometry(QStyle::alignedRect(Qt::LeftToRight, Qt::AlignCenter,
-                                                       dialog.size(), this->geometry()));
-
-                QFutureWatcher<void> futureWatcher;
-                connect(&futureWatcher, &QFutureWatcher<void>::finished, this, [=, this]() {
-                    if (pkgNum == nPkg) {
-                        QString path;
-
-                        // We want to show the parent path instead of the full path
-                        Common::FS::PathToQString(path, game_folder_path.parent_path());
-                        QIcon windowIcon(
-                            Common::FS::PathToUTF8String(game_folder_path / "sce_sys/icon0.png")
-                                .c_str());
-
-                        QMessageBox extractMsgBox(this);
-                        extractMsgBox.setWindowTitle(tr("Extraction Finished"));
-                        if (!windowIcon.isNull()) {
-                            extractMsgBox.setWindowIcon(windowIcon);
-                        }
-                        extractMsgBox.setText(
-                            QString(tr("Game successfully installed at %1")).arg(path));
-                        extractMsgBox.addButton(QMessageBox::Ok);
-                        extractMsgBox.setDefaultButton(QMessageBox::Ok);
-                        connect(&extractMsgBox, &QMessageBox::buttonClicked, this,
-                                [&](QAbstractButton* button) {
-                                    if (extractMsgBox.button(QMessageBox::Ok) == button) {
-                                        extractMsgBox.close();
-                                        emit ExtractionFinished();
-                                    }
-                                });
-                        extractMsgBox.exec();
-                    }
-                    if (delete_file_on_install) {
-                        std::filesystem::remove(file);
-                    }
-                });
-                connect(&dialog, &QProgressDialog::canceled, [&]() { futureWatcher.cancel(); });
-                connect(&futureWatcher, &QFutureWatcher<void>::progressValueChanged, &dialog,
-                        &QProgressDialog::setValue);
-                futureWatcher.setFuture(
-                    QtConcurrent::map(indices, [&](int index) { pkg.ExtractFiles(index); }));
-                dialog.exec();
-            }
-        }
-    } else {
-        QMessageBox::critical(this, tr("PKG ERROR"),
-                              tr("File doesn't appear to be a valid PKG file"));
+        // Parsing the PFS image and writing the files happens on the install thread.
+        m_install_service->Enqueue({file, game_update_path, game_folder_path, pkgNum, nPkg,
+                                    delete_file_on_install});
+        return true;
     }
+    QMessageBox::critical(this, tr("PKG ERROR"), tr("File doesn't appear to be a valid PKG file"));
+    return false;
 }
 
 void MainWindow::InstallDirectory() {
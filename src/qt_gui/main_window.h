@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <deque>
 #include <QActionGroup>
 #include <QDragEnterEvent>
 #include <QProcess>
@@ -22,9 +23,11 @@
 #include "game_list_utils.h"
 #include "main_window_themes.h"
 #include "main_window_ui.h"
+#include "pkg_install_service.h"
 #include "pkg_viewer.h"
 
 class GameListFrame;
+class QProgressDialog;
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
@@ -73,6 +76,9 @@ private:
     void SetLastIconSizeBullet();
     void SetUiIcons(bool isWhite);
     void InstallPkg();
+    void CreateInstallService();
+    void InstallNextPkg();
+    bool EnqueuePkgInstall(const std::filesystem::path& file, int pkgNum, int nPkg);
     void BootGame();
     void AddRecentFiles(QString filePath);
     void LoadTranslation();
@@ -89,7 +95,17 @@ private:
     QActionGroup* m_list_mode_act_group = nullptr;
     QActionGroup* m_theme_act_group = nullptr;
     QActionGroup* m_recent_files_group = nullptr;
-    PKG pkg;
+    // Package installs run in the background, one PKG at a time
+    PkgInstallService* m_install_service = nullptr;
+    QProgressDialog* m_install_dialog = nullptr;
+    struct PendingInstall {
+        std::filesystem::path file;
+        int pkg_num;
+        int pkg_count;
+    };
+    // Checked against the installed games only once the PKGs before them are extracted
+    std::deque<PendingInstall> m_pending_installs;
+    bool m_install_running = false;
     // Dockable widget frames
     WindowThemes m_window_themes;
     GameListUtils m_game_list_utils;
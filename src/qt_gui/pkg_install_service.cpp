@@ -0,0 +1,101 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <numeric>
+
+#include "core/file_format/game_library.h"
+#include "pkg_install_service.h"
+
+PkgInstallService::PkgInstallService(QObject* parent) : QObject(parent) {
+    m_progress_timer = new QTimer(this);
+    m_progress_timer->setInterval(100);
+    connect(m_progress_timer, &QTimer::timeout, this, &PkgInstallService::PublishProgress);
+    m_worker = std::jthread([this](std::stop_token stop) { Run(stop); });
+}
+
+PkgInstallService::~PkgInstallService() {
+    m_worker.request_stop();
+    m_progress.cancel = true;
+}
+
+void PkgInstallService::Enqueue(PkgInstallJob job) {
+    {
+        std::scoped_lock lock{m_mutex};
+        m_queue.push_back(std::move(job));
+    }
+    m_cv.notify_one();
+}
+
+void PkgInstallService::CancelCurrent() {
+    m_progress.cancel = true;
+}
+
+void PkgInstallService::PublishProgress() {
+    emit ProgressChanged(m_progress.bytes_written, m_bytes_total);
+}
+
+void PkgInstallService::Run(std::stop_token stop) {
+    while (true) {
+        PkgInstallJob job;
+        {
+            std::unique_lock lock{m_mutex};
+            if (!m_cv.wait(lock, stop, [this] { return !m_queue.empty(); }) ||
+                stop.stop_requested()) {
+                return;
+            }
+            job = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+
+        m_progress.bytes_written = 0;
+        m_progress.files_done = 0;
+        m_bytes_total = 0;
+        QMetaObject::invokeMethod(this, [this, job] {
+            emit JobStarted(job);
+            m_progress_timer->start();
+        });
+
+        std::string failreason;
+        const bool success = Install(job, failreason);
+        if (!stop.stop_requested()) {
+            // A cancel is used up by the job it stopped, one from the destructor is kept.
+            m_progress.cancel = false;
+        }
+        QMetaObject::invokeMethod(
+            this, [this, job, success, error = QString::fromStdString(failreason)] {
+                m_progress_timer->stop();
+                PublishProgress();
+                emit JobFinished(job, success, error);
+            });
+    }
+}
+
+bool PkgInstallService::Install(const PkgInstallJob& job, std::string& failreason) {
+    // Cancelled before the job started, or while the PFS image was parsed.
+    PKG pkg;
+    if (m_progress.cancel || !pkg.Open(job.pkg_path, failreason) ||
+        !pkg.Extract(job.pkg_path, job.extract_path, failreason) || m_progress.cancel) {
+        return false;
+    }
+
+    std::vector<int> indices(pkg.GetNumberOfFiles());
+    std::iota(indices.begin(), indices.end(), 0);
+    m_bytes_total = pkg.GetTotalSize(indices);
+
+    const u32 failed = pkg.ExtractFiles(indices, 0, &m_progress);
+    if (m_progress.cancel) {
+        // Cancelled by the user, nothing to report.
+        return false;
+    }
+    if (failed != 0) {
+        failreason = std::to_string(failed) + " files could not be extracted";
+        return false;
+    }
+    WriteExtractManifest(job.extract_path, m_progress.bytes_written, m_progress.files_done);
+
+    if (job.delete_file_on_install) {
+        std::error_code ec;
+        std::filesystem::remove(job.pkg_path, ec);
+    }
+    return true;
+}
@@ -0,0 +1,61 @@
+// SPDX-FileCopyrightText: Copyright 2024 shadPS4 Emulator Project
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <QObject>
+#include <QTimer>
+
+#include "core/file_format/pkg.h"
+
+struct PkgInstallJob {
+    std::filesystem::path pkg_path;
+    std::filesystem::path extract_path;
+    std::filesystem::path game_folder_path;
+    int pkg_num = 1;
+    int pkg_count = 1;
+    bool delete_file_on_install = false;
+};
+
+/**
+ * Installs queued PKGs one after another on a background thread. Each PKG is parsed and
+ * extracted with its own PKG instance, its files spread across all cores. Progress is counted in
+ * bytes written and published to the GUI thread at a fixed rate.
+ */
+class PkgInstallService : public QObject {
+    Q_OBJECT
+
+public:
+    explicit PkgInstallService(QObject* parent = nullptr);
+    ~PkgInstallService();
+
+    void Enqueue(PkgInstallJob job);
+
+    /// Stops the running install, or the next one if none is running. Later jobs are kept.
+    void CancelCurrent();
+
+signals:
+    void JobStarted(const PkgInstallJob& job);
+    void ProgressChanged(quint64 bytes_written, quint64 bytes_total);
+    void JobFinished(const PkgInstallJob& job, bool success, const QString& error);
+
+private:
+    void Run(std::stop_token stop);
+    bool Install(const PkgInstallJob& job, std::string& failreason);
+    void PublishProgress();
+
+    std::mutex m_mutex;
+    std::condition_variable_any m_cv;
+    std::deque<PkgInstallJob> m_queue;
+
+    ExtractProgress m_progress;
+    std::atomic<u64> m_bytes_total{0};
+    QTimer* m_progress_timer;
+
+    std::jthread m_worker; // Declared last so it is joined before the state above is destroyed.
+};
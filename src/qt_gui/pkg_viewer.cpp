@@ -97,37 +97,49 @@ void PKGViewer::ProcessPKGInfo() {
     m_pkg_app_list.clear();
     m_pkg_patch_list.clear();
     m_full_pkg_list.clear();
-    for (int i = 0; i < m_pkg_list.size(); i++) {
-        std::filesystem::path path = Common::FS::PathFromQString(m_pkg_list[i]);
-        std::string failreason;
-        if (!package.Open(path, failreason)) {
-            QMessageBox::critical(this, tr("PKG ERROR"), QString::fromStdString(failreason));
-            return;
+
+    // Only packages that are new or changed since the last refresh are probed.
+    std::vector<std::filesystem::path> pkg_paths;
+    for (const QString& pkg_path : m_pkg_list) {
+        pkg_paths.push_back(Common::FS::PathFromQString(pkg_path));
+    }
+    const auto catalog_path =
+        Common::FS::GetUserPath(Common::FS::PathType::MetaDataDir) / "pkg_catalog.bin";
+    PkgCatalog catalog;
+    catalog.Load(catalog_path);
+    const PkgCatalogStats stats = catalog.Refresh(pkg_paths);
+    catalog.Save(catalog_path);
+    if (!stats.failures.empty()) {
+        QStringList errors;
+        for (const auto& failure : stats.failures) {
+            errors.append(QString::fromStdString(failure.path + ": " + failure.reason));
         }
-        psf.Open(package.sfo);
-        QString title_name = QString::fromStdString(
-            std::string{psf.GetString("TITLE").value_or(std::string{tr("Unknown").toStdString()})});
-        QString title_id = QString::fromStdString(std::string{
-            psf.GetString("TITLE_ID").value_or(std::string{tr("Unknown").toStdString()})});
-        QString app_type = GameListUtils::GetAppType(psf.GetInteger("APP_TYPE").value_or(0));
-        QString app_version = QString::fromStdString(std::string{
-            psf.GetString("APP_VER").value_or(std::string{tr("Unknown").toStdString()})});
-        QString title_category = QString::fromStdString(std::string{
-            psf.GetString("CATEGORY").value_or(std::string{tr("Unknown").toStdString()})});
-        QString pkg_size = GameListUtils::FormatSize(package.GetPkgHeader().pkg_size);
-        pkg_content_flag = package.GetPkgHeader().pkg_content_flags;
+        QMessageBox::critical(this, tr("PKG ERROR"), errors.join('\n'));
+    }
+
+    for (const PkgCatalogEntry& pkg_entry : catalog.GetEntries()) {
+        const QString unknown = tr("Unknown");
+        const auto or_unknown = [&](const std::string& value) {
+            return value.empty() ? unknown : QString::fromStdString(value);
+        };
+        QString title_name = or_unknown(pkg_entry.title);
+        QString title_id = or_unknown(pkg_entry.title_id);
+        QString app_type = GameListUtils::GetAppType(pkg_entry.app_type);
+        QString app_version = or_unknown(pkg_entry.app_ver);
+        QString title_category = or_unknown(pkg_entry.category);
+        QString pkg_size = GameListUtils::FormatSize(pkg_entry.pkg_size);
         QString flagss = "";
-        for (const auto& flag : package.flagNames) {
-            if (package.isFlagSet(pkg_content_flag, flag.first)) {
+        for (const auto& flag : PKG::flagNames) {
+            if (PKG::isFlagSet(pkg_entry.content_flags, flag.first)) {
                 if (!flagss.isEmpty())
                     flagss += (", ");
                 flagss += QString::fromStdString(flag.second.data());
             }
         }
 
-        QString fw_ = tr("Unknown");
-        if (const auto fw_int_opt = psf.GetInteger("SYSTEM_VER"); fw_int_opt.has_value()) {
-            const u32 fw_int = *fw_int_opt;
+        QString fw_ = unknown;
+        if (pkg_entry.has_system_ver) {
+            const u32 fw_int = pkg_entry.system_ver;
             if (fw_int == 0) {
                 fw_ = "0.00";
             } else {
@@ -136,19 +148,20 @@ void PKGViewer::ProcessPKGInfo() {
                                       : fw.left(3).insert(1, '.');
             }
         }
-        char region = package.GetPkgHeader().pkg_content_id[0];
+        const QString pkg_path = QString::fromStdString(pkg_entry.path);
+        char region = pkg_entry.content_id.empty() ? '\0' : pkg_entry.content_id[0];
         QString pkg_info = "";
         if (title_category == "gd" && !flagss.contains("PATCH")) {
             title_category = "App";
             pkg_info = title_name + ";;" + title_id + ";;" + pkg_size + ";;" + title_category +
                        ";;" + app_type + ";;" + app_version + ";;" + fw_ + ";;" +
-                       game_list_util.GetRegion(region) + ";;" + flagss + ";;" + m_pkg_list[i];
+                       game_list_util.GetRegion(region) + ";;" + flagss + ";;" + pkg_path;
             m_pkg_app_list.append(pkg_info);
         } else {
             title_category = "Patch";
             pkg_info = title_name + ";;" + title_id + ";;" + pkg_size + ";;" + title_category +
                        ";;" + app_type + ";;" + app_version + ";;" + fw_ + ";;" +
-                       game_list_util.GetRegion(region) + ";;" + flagss + ";;" + m_pkg_list[i];
+                       game_list_util.GetRegion(region) + ";;" + flagss + ";;" + pkg_path;
             m_pkg_patch_list.append(pkg_info);
         }
     }
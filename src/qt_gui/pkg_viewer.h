@@ -9,6 +9,7 @@
 
 #include "common/io_file.h"
 #include "core/file_format/pkg.h"
+#include "core/file_format/pkg_catalog.h"
 #include "core/file_format/pkg_type.h"
 #include "core/file_format/psf.h"
 #include "game_info.h"